@@ -0,0 +1,495 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_benchmark.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Measures cmdlineflags_parse_r() and help message generation against the synthetic
+ * registry it is linked with (see cmdlineflags_benchmark.h). Where it makes sense,
+ * the same arguments are also parsed with getopt_long() as a baseline.
+ *
+ * usage: cmdlineflags_benchmark_<n> [seconds per measurement]
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "cmdlineflags_benchmark.h"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define BENCHMARK_DEFAULT_SECONDS 0.2
+#define BENCHMARK_MAX_SAMPLES (1U << 20)
+
+#define BENCHMARK_CLUSTER_ARGS 64
+#define BENCHMARK_CLUSTER_LENGTH 32
+#define BENCHMARK_LONG_ARGS 1024
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct benchmark_args {
+    const char* name;
+    int argc;
+    char** argv;
+    /* Whether getopt_long() is able to parse the same arguments. */
+    bool getopt;
+};
+
+struct benchmark_result {
+    double mean;
+    uint64_t p50;
+    uint64_t p99;
+};
+
+typedef void (*benchmark_fn)(void* ctx);
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static uint64_t now(void);
+static int compare_samples(const void* a, const void* b);
+static int measure(benchmark_fn fn, void* ctx, struct benchmark_result* result);
+static void report(const char* name, const struct benchmark_result* result, int n_args);
+static char* format(const char* fmt, unsigned value);
+static int args_init(struct benchmark_args* args, const char* name, int argc, bool getopt);
+static void args_free(struct benchmark_args* args);
+static int build_realistic(struct benchmark_args* args);
+static int build_short_clusters(struct benchmark_args* args);
+static int build_name_value(struct benchmark_args* args);
+static int build_unknown(struct benchmark_args* args);
+static int build_module(struct benchmark_args* args);
+static void run_cmdlineflags(void* ctx);
+static void run_getopt(void* ctx);
+static void run_get_help_msg(void* ctx);
+static void run_get_help_msg_sorted(void* ctx);
+static void run_write_help(void* ctx);
+static void run_complete(void* ctx);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static volatile unsigned benchmark_sink;
+
+static double benchmark_seconds = BENCHMARK_DEFAULT_SECONDS;
+static uint64_t* benchmark_samples;
+
+static struct cmdlineflags_parser benchmark_parser;
+static const struct benchmark_args* benchmark_current_args;
+
+static char* benchmark_help_msg;
+static unsigned benchmark_help_msg_size;
+static int benchmark_null_fd = -1;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int benchmark_handle_option(const struct cmdlineflags_option* option)
+{
+    benchmark_sink++;
+    return 0;
+}
+
+int benchmark_handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument)
+{
+    benchmark_sink += argument[0];
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    struct benchmark_args args[5];
+    unsigned n_args = 0;
+    unsigned i;
+
+    memset(args, 0, sizeof(args));
+
+    do {
+        struct benchmark_result result;
+        uint64_t start;
+        int status;
+
+        if (argc > 1) {
+            benchmark_seconds = strtod(argv[1], NULL);
+            if (benchmark_seconds <= 0.0) {
+                fprintf(stderr, "usage: %s [seconds per measurement]\n", argv[0]);
+                break;
+            }
+        }
+
+        benchmark_samples = malloc(BENCHMARK_MAX_SAMPLES * sizeof(*benchmark_samples));
+        if (benchmark_samples == NULL)
+            break;
+
+        if (cmdlineflags_parser_init(&benchmark_parser, NULL) != 0)
+            break;
+
+        /* Unknown options are measured too, they shall not flood the output. */
+        benchmark_parser.cfg.emit_debug_messages = 0;
+
+        if ((build_realistic(&args[n_args++]) != 0) ||
+            (build_short_clusters(&args[n_args++]) != 0) ||
+            (build_name_value(&args[n_args++]) != 0) ||
+            (build_unknown(&args[n_args++]) != 0))
+            break;
+
+        if (benchmark_n_modules(benchmark_n_options) > 0)
+            if (build_module(&args[n_args++]) != 0)
+                break;
+
+        fprintf(stdout, "registry: %u options (%u global, %u modules)\n\n",
+            benchmark_n_options, benchmark_n_global(benchmark_n_options), benchmark_n_modules(benchmark_n_options));
+
+        /* The very first parse also builds the index of the registry. */
+        start = now();
+        status = cmdlineflags_parse_r(&benchmark_parser, args[0].argc, args[0].argv);
+        fprintf(stdout, "first parse (index build): %" PRIu64 " ns\n\n", now() - start);
+
+        if (status < 0)
+            break;
+
+        fprintf(stdout, "%-32s %12s %12s %12s %10s %14s\n",
+            "benchmark", "mean [ns]", "p50 [ns]", "p99 [ns]", "ns/arg", "args/s");
+
+        for (i = 0; i < n_args; ++i) {
+            char name[64];
+
+            benchmark_current_args = &args[i];
+
+            snprintf(name, sizeof(name), "cmdlineflags %s", args[i].name);
+            if (measure(run_cmdlineflags, NULL, &result) != 0)
+                break;
+            report(name, &result, args[i].argc - 1);
+
+            if (args[i].getopt) {
+                snprintf(name, sizeof(name), "getopt_long %s", args[i].name);
+                if (measure(run_getopt, NULL, &result) != 0)
+                    break;
+                report(name, &result, args[i].argc - 1);
+            }
+        }
+
+        if (i != n_args)
+            break;
+
+        status = cmdlineflags_get_help_msg(NULL, 0, false);
+        if (status < 0)
+            break;
+
+        benchmark_help_msg_size = status + 1;
+        benchmark_help_msg = malloc(benchmark_help_msg_size);
+        if (benchmark_help_msg == NULL)
+            break;
+
+        benchmark_null_fd = open("/dev/null", O_WRONLY);
+        if (benchmark_null_fd < 0)
+            break;
+
+        fprintf(stdout, "\nhelp message: %d bytes\n", status);
+
+        if (measure(run_get_help_msg, NULL, &result) != 0)
+            break;
+        report("cmdlineflags_get_help_msg", &result, 0);
+
+        if (measure(run_get_help_msg_sorted, NULL, &result) != 0)
+            break;
+        report("cmdlineflags_get_help_msg sorted", &result, 0);
+
+        if (measure(run_write_help, NULL, &result) != 0)
+            break;
+        report("cmdlineflags_write_help sorted", &result, 0);
+
+        /* Completions of a (the very first) long option and of a module, as asked for by the shell on each keypress. */
+        fprintf(stdout, "\n");
+
+        if (measure(run_complete, "--global_1", &result) != 0)
+            break;
+        report("cmdlineflags_complete --global_1", &result, 0);
+
+        if (measure(run_complete, "module_1", &result) != 0)
+            break;
+        report("cmdlineflags_complete module_1", &result, 0);
+
+        retval = 0;
+    } while (0);
+
+    if (benchmark_null_fd >= 0)
+        close(benchmark_null_fd);
+
+    for (i = 0; i < n_args; ++i)
+        args_free(&args[i]);
+
+    free(benchmark_help_msg);
+    free(benchmark_samples);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_samples(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Calls 'fn' repeatedly for about 'benchmark_seconds' timing each call on its own. */
+static int measure(benchmark_fn fn, void* ctx, struct benchmark_result* result)
+{
+    uint64_t duration = (uint64_t)(benchmark_seconds * 1e9);
+    uint64_t total = 0;
+    unsigned n = 0;
+
+    /* Warm up, so that the first samples are not skewed by cold caches. */
+    fn(ctx);
+
+    do {
+        uint64_t start = now();
+
+        fn(ctx);
+
+        benchmark_samples[n] = now() - start;
+        total += benchmark_samples[n++];
+    } while ((total < duration) && (n < BENCHMARK_MAX_SAMPLES));
+
+    qsort(benchmark_samples, n, sizeof(*benchmark_samples), compare_samples);
+
+    result->mean = (double)total / n;
+    result->p50 = benchmark_samples[n / 2];
+    result->p99 = benchmark_samples[(uint64_t)n * 99 / 100];
+
+    return 0;
+}
+
+static void report(const char* name, const struct benchmark_result* result, int n_args)
+{
+    if (n_args > 0)
+        fprintf(stdout, "%-32s %12.0f %12" PRIu64 " %12" PRIu64 " %10.1f %14.0f\n",
+            name, result->mean, result->p50, result->p99, result->mean / n_args, n_args * 1e9 / result->mean);
+    else
+        fprintf(stdout, "%-32s %12.0f %12" PRIu64 " %12" PRIu64 " %10s %14s\n",
+            name, result->mean, result->p50, result->p99, "-", "-");
+}
+
+static char* format(const char* fmt, unsigned value)
+{
+    int size = snprintf(NULL, 0, fmt, value);
+    char* str = malloc(size + 1);
+
+    if (str != NULL)
+        snprintf(str, size + 1, fmt, value);
+
+    return str;
+}
+
+static int args_init(struct benchmark_args* args, const char* name, int argc, bool getopt)
+{
+    args->name = name;
+    args->argc = argc;
+    args->getopt = getopt;
+    args->argv = calloc(argc + 1, sizeof(*args->argv));
+
+    return args->argv != NULL ? 0 : -1;
+}
+
+static void args_free(struct benchmark_args* args)
+{
+    int i;
+
+    if (args->argv == NULL)
+        return;
+
+    for (i = 0; i < args->argc; ++i)
+        free(args->argv[i]);
+
+    free(args->argv);
+    args->argv = NULL;
+}
+
+/* Mix of short, clustered, long and --name=value options followed by a couple of positional arguments. */
+static int build_realistic(struct benchmark_args* args)
+{
+    static const char* const realistic[] = {
+        "program", "-a", "-b", "value", "-ce", "--global-4", "--global-5=value", "--global-3", "value",
+        "-dg", "--", "input", "output"
+    };
+    int i;
+
+    if (args_init(args, "realistic", sizeof(realistic) / sizeof(realistic[0]), true) != 0)
+        return -1;
+
+    for (i = 0; i < args->argc; ++i)
+        if ((args->argv[i] = strdup(realistic[i])) == NULL)
+            return -1;
+
+    return 0;
+}
+
+/* Clusters of short options without arguments. */
+static int build_short_clusters(struct benchmark_args* args)
+{
+    unsigned n_short = benchmark_n_global(benchmark_n_options);
+    unsigned k = 0;
+    int i;
+    int j;
+
+    if (n_short > 52)
+        n_short = 52;
+
+    if (args_init(args, "short clusters", BENCHMARK_CLUSTER_ARGS + 1, true) != 0)
+        return -1;
+
+    if ((args->argv[0] = strdup("program")) == NULL)
+        return -1;
+
+    for (i = 1; i < args->argc; ++i) {
+        char* arg = malloc(BENCHMARK_CLUSTER_LENGTH + 2);
+
+        if ((args->argv[i] = arg) == NULL)
+            return -1;
+
+        arg[0] = '-';
+        for (j = 1; j <= BENCHMARK_CLUSTER_LENGTH; ++j, k += 2)
+            arg[j] = benchmark_shortoption(k % n_short & ~1U);
+        arg[j] = '\0';
+    }
+
+    return 0;
+}
+
+/* Long options with arguments attached. */
+static int build_name_value(struct benchmark_args* args)
+{
+    unsigned n_global = benchmark_n_global(benchmark_n_options);
+    int i;
+
+    if (args_init(args, "--name=value", BENCHMARK_LONG_ARGS + 1, true) != 0)
+        return -1;
+
+    if ((args->argv[0] = strdup("program")) == NULL)
+        return -1;
+
+    for (i = 1; i < args->argc; ++i)
+        if ((args->argv[i] = format("--global-%u=value", ((i - 1) * 2) % (n_global & ~1U) | 1U)) == NULL)
+            return -1;
+
+    return 0;
+}
+
+/* Options which are not defined at all. */
+static int build_unknown(struct benchmark_args* args)
+{
+    int i;
+
+    if (args_init(args, "unknown", BENCHMARK_LONG_ARGS + 1, true) != 0)
+        return -1;
+
+    if ((args->argv[0] = strdup("program")) == NULL)
+        return -1;
+
+    for (i = 1; i < args->argc; ++i)
+        if ((args->argv[i] = format("--unknown-%u", i)) == NULL)
+            return -1;
+
+    return 0;
+}
+
+/* Long options of a module, which getopt_long() has no notion of. */
+static int build_module(struct benchmark_args* args)
+{
+    int i;
+
+    if (args_init(args, "module --name=value", BENCHMARK_LONG_ARGS + 2, false) != 0)
+        return -1;
+
+    if (((args->argv[0] = strdup("program")) == NULL) || ((args->argv[1] = strdup("module_0")) == NULL))
+        return -1;
+
+    for (i = 2; i < args->argc; ++i)
+        if ((args->argv[i] = format("--opt-%u=value", ((i - 2) * 2 + 1) % BENCHMARK_MODULE_SIZE)) == NULL)
+            return -1;
+
+    return 0;
+}
+
+static void run_cmdlineflags(void* ctx)
+{
+    benchmark_sink += cmdlineflags_parse_r(&benchmark_parser, benchmark_current_args->argc, benchmark_current_args->argv);
+}
+
+static void run_getopt(void* ctx)
+{
+    int c;
+
+    /* Forces full reinitialization of getopt_long(). */
+    optind = 0;
+    opterr = 0;
+
+    while ((c = getopt_long(benchmark_current_args->argc, benchmark_current_args->argv,
+                benchmark_getopt_shortoptions, benchmark_getopt_longoptions, NULL)) != -1) {
+        if ((c == '?') || (c == ':'))
+            benchmark_sink++;
+        else if (optarg != NULL)
+            benchmark_handle_option_with_argument(NULL, optarg);
+        else
+            benchmark_handle_option(NULL);
+    }
+
+    benchmark_sink += optind;
+}
+
+static void run_get_help_msg(void* ctx)
+{
+    benchmark_sink += cmdlineflags_get_help_msg(benchmark_help_msg, benchmark_help_msg_size, false);
+}
+
+static void run_get_help_msg_sorted(void* ctx)
+{
+    benchmark_sink += cmdlineflags_get_help_msg(benchmark_help_msg, benchmark_help_msg_size, true);
+}
+
+static void run_write_help(void* ctx)
+{
+    benchmark_sink += cmdlineflags_write_help(benchmark_null_fd, true);
+}
+
+static void run_complete(void* ctx)
+{
+    char* argv[] = {"program", ctx, NULL};
+
+    benchmark_sink += cmdlineflags_write_completions(benchmark_null_fd, 2, argv, 1);
+}
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_benchmark.h
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Synthetic registry shared by the registry generator and the benchmark.
+ *
+ * Options of the global module are named global_<i>, those with an odd 'i' require an argument.
+ * First 52 of them also have short names: 'a' + i and 'A' + i - 26 respectively.
+ * All the other options are spread over modules (module_<m>) of BENCHMARK_MODULE_SIZE options
+ * named opt_<j>, again those with an odd 'j' require an argument.
+ */
+
+#ifndef _CMDLINEFLAGS_BENCHMARK_H_
+#define _CMDLINEFLAGS_BENCHMARK_H_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <getopt.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* Smallest registry the benchmark is able to build its arguments for. */
+#define BENCHMARK_MIN_OPTIONS 10
+
+/* Registries of up to that many options have only the global module. */
+#define BENCHMARK_MAX_GLOBAL_ONLY 200
+
+#define BENCHMARK_GLOBAL_SIZE 100
+#define BENCHMARK_MODULE_SIZE 100
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+static inline unsigned benchmark_n_global(unsigned n_options)
+{
+    return n_options <= BENCHMARK_MAX_GLOBAL_ONLY ? n_options : BENCHMARK_GLOBAL_SIZE;
+}
+
+static inline unsigned benchmark_n_modules(unsigned n_options)
+{
+    unsigned n_global = benchmark_n_global(n_options);
+
+    return (n_options - n_global + BENCHMARK_MODULE_SIZE - 1) / BENCHMARK_MODULE_SIZE;
+}
+
+/* Short name of the i-th option of the global module or '\0' if there is none. */
+static inline char benchmark_shortoption(unsigned i)
+{
+    return i < 26 ? 'a' + i : (i < 52 ? 'A' + i - 26 : '\0');
+}
+
+/*===========================================================================*\
+ * global (external linkage) object declarations
+\*===========================================================================*/
+/* Defined by the generated registry. */
+extern const unsigned benchmark_n_options;
+
+/* Options of the global module as seen by getopt_long(). */
+extern const char benchmark_getopt_shortoptions[];
+extern const struct option benchmark_getopt_longoptions[];
+
+/*===========================================================================*\
+ * function forward declarations (external linkage)
+\*===========================================================================*/
+/* Handlers of all the options of the registry. */
+int benchmark_handle_option(const struct cmdlineflags_option* option);
+int benchmark_handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument);
+
+#endif /* _CMDLINEFLAGS_BENCHMARK_H_ */
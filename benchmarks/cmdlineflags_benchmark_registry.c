@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_benchmark_registry.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Writes the source file defining synthetic registry of the given number of options
+ * (see cmdlineflags_benchmark.h).
+ *
+ * usage: cmdlineflags_benchmark_registry <number of options> <output file>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "cmdlineflags_benchmark.h"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static const char* flags(unsigned i);
+static const char* handler(unsigned i);
+static int write_registry(FILE* file, unsigned n_options);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    FILE* file;
+    char* end;
+    unsigned long n_options;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <number of options> <output file>\n", argv[0]);
+        return retval;
+    }
+
+    n_options = strtoul(argv[1], &end, 10);
+    if ((*end != '\0') || (n_options < BENCHMARK_MIN_OPTIONS) || (n_options > 10000000)) {
+        fprintf(stderr, "%s: invalid number of options '%s'\n", argv[0], argv[1]);
+        return retval;
+    }
+
+    file = fopen(argv[2], "w");
+    if (file == NULL) {
+        perror(argv[2]);
+        return retval;
+    }
+
+    retval = write_registry(file, n_options);
+
+    if (fclose(file) != 0)
+        retval = -1;
+
+    if (retval != 0)
+        remove(argv[2]);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static const char* flags(unsigned i)
+{
+    return (i & 1) ? "CMDLINEFLAGS_REQUIRED_ARGUMENT" : "CMDLINEFLAGS_NO_ARGUMENT";
+}
+
+static const char* handler(unsigned i)
+{
+    return (i & 1) ? "benchmark_handle_option_with_argument" : "benchmark_handle_option";
+}
+
+static int write_registry(FILE* file, unsigned n_options)
+{
+    unsigned n_global = benchmark_n_global(n_options);
+    unsigned n_modules = benchmark_n_modules(n_options);
+    unsigned i;
+    unsigned m;
+    int status = 0;
+
+    status |= fprintf(file, "/* Generated by cmdlineflags_benchmark_registry, do not edit. */\n\n");
+    status |= fprintf(file, "#include \"cmdlineflags_benchmark.h\"\n\n");
+    status |= fprintf(file, "const unsigned benchmark_n_options = %u;\n\n", n_options);
+
+    for (i = 0; i < n_global; ++i) {
+        char c = benchmark_shortoption(i);
+
+        if (c != '\0')
+            status |= fprintf(file, "CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, %c, global_%u, %s, %s, \"global option\");\n",
+                c, i, flags(i), handler(i));
+        else
+            status |= fprintf(file, "CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, global_%u, %s, %s, \"global option\");\n",
+                i, flags(i), handler(i));
+    }
+
+    for (m = 0; m < n_modules; ++m) {
+        unsigned n = n_options - n_global - m * BENCHMARK_MODULE_SIZE;
+
+        if (n > BENCHMARK_MODULE_SIZE)
+            n = BENCHMARK_MODULE_SIZE;
+
+        for (i = 0; i < n; ++i)
+            status |= fprintf(file, "CMDLINEFLAGS_DEFINE_LONG_OPTION(module_%u, opt_%u, %s, %s, \"module option\");\n",
+                m, i, flags(i), handler(i));
+    }
+
+    status |= fprintf(file, "\nconst char benchmark_getopt_shortoptions[] = \"+");
+    for (i = 0; i < n_global; ++i)
+        if (benchmark_shortoption(i) != '\0')
+            status |= fprintf(file, "%c%s", benchmark_shortoption(i), (i & 1) ? ":" : "");
+    status |= fprintf(file, "\";\n\n");
+
+    status |= fprintf(file, "const struct option benchmark_getopt_longoptions[] = {\n");
+    for (i = 0; i < n_global; ++i)
+        status |= fprintf(file, "    {\"global-%u\", %s, NULL, %u},\n", i, (i & 1) ? "required_argument" : "no_argument", i);
+    status |= fprintf(file, "    {NULL, 0, NULL, 0}\n};\n");
+
+    return status < 0 ? -1 : 0;
+}
@@ -1,5 +1,10 @@
 # cmdlineflags-config.cmake - package configuration file
 
+include(CMakeFindDependencyMacro)
+find_dependency(Threads)
+
 if(NOT TARGET cmdlineflags)
    include("${CMAKE_CURRENT_LIST_DIR}/cmdlineflags-targets.cmake")
 endif()
+
+include("${CMAKE_CURRENT_LIST_DIR}/cmdlineflags-generate.cmake")
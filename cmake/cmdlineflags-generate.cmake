@@ -0,0 +1,98 @@
+# cmdlineflags-generate.cmake - build time generators
+#
+# All the options of an executable are known once it is linked. The functions below
+# build a twin of the given executable (same sources, same usage requirements),
+# run it so that the cmdlineflags library writes the requested source file instead of
+# running main(), and add the generated source file to the original executable.
+# Only the twins are built with cmdlineflags-generator.c (which does all that),
+# the executables themselves never look at the environment for it.
+
+set(_CMDLINEFLAGS_GENERATOR_SOURCE ${CMAKE_CURRENT_LIST_DIR}/cmdlineflags-generator.c CACHE INTERNAL "")
+
+# Creates (once) the generator twin of 'target' and returns its name in 'generator'.
+function(_cmdlineflags_add_generator target generator)
+    set(name ${target}-cmdlineflags-generator)
+
+    if(NOT TARGET ${name})
+        get_target_property(sources ${target} SOURCES)
+        get_target_property(source_dir ${target} SOURCE_DIR)
+
+        set(absolute_sources)
+        foreach(source ${sources})
+            get_source_file_property(generated ${source} GENERATED)
+            if(NOT generated)
+                get_filename_component(source ${source} ABSOLUTE BASE_DIR ${source_dir})
+                list(APPEND absolute_sources ${source})
+            endif()
+        endforeach()
+
+        add_executable(${name} EXCLUDE_FROM_ALL ${absolute_sources} ${_CMDLINEFLAGS_GENERATOR_SOURCE})
+
+        target_include_directories(${name} PRIVATE $<TARGET_PROPERTY:${target},INCLUDE_DIRECTORIES>)
+        target_compile_definitions(${name} PRIVATE $<TARGET_PROPERTY:${target},COMPILE_DEFINITIONS>)
+        target_compile_options(${name} PRIVATE $<TARGET_PROPERTY:${target},COMPILE_OPTIONS>)
+        target_link_options(${name} PRIVATE $<TARGET_PROPERTY:${target},LINK_OPTIONS>)
+        target_link_libraries(${name} PRIVATE $<TARGET_PROPERTY:${target},LINK_LIBRARIES>)
+
+        foreach(property C_STANDARD CXX_STANDARD)
+            get_target_property(standard ${target} ${property})
+            if(standard)
+                set_target_properties(${name} PROPERTIES ${property} ${standard})
+            endif()
+        endforeach()
+
+        # the records of the options are looked up by their symbols, to tell whether the index may refer to them
+        set_target_properties(${name} PROPERTIES ENABLE_EXPORTS ON)
+    endif()
+
+    set(${generator} ${name} PARENT_SCOPE)
+endfunction()
+
+# cmdlineflags_generate_index(<target>)
+#
+# Precomputes the lookup index (including minimal perfect hash of all long options)
+# of the executable <target> and embeds it into that executable,
+# so that no index has to be built when the program starts.
+function(cmdlineflags_generate_index target)
+    _cmdlineflags_add_generator(${target} generator)
+
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}-cmdlineflags-index.c)
+
+    add_custom_command(OUTPUT ${output}
+        COMMAND ${CMAKE_COMMAND} -E env CMDLINEFLAGS_GENERATE_INDEX=${output} $<TARGET_FILE:${generator}>
+        DEPENDS ${generator}
+        COMMENT "Generating cmdlineflags index of ${target}"
+        VERBATIM)
+
+    target_sources(${target} PRIVATE ${output})
+endfunction()
+
+# cmdlineflags_generate_help(<target> [TEXT <file>])
+#
+# Renders the sorted help message of the executable <target> and embeds it into that
+# executable, so that cmdlineflags_get_help_msg() and friends only copy it when asked
+# for the sorted message. The very same text is also written to <file>
+# (${target}-cmdlineflags-help.txt in the current binary directory by default),
+# which can be checked in to review changes of the command line interface.
+function(cmdlineflags_generate_help target)
+    cmake_parse_arguments(PARSE_ARGV 1 arg "" "TEXT" "")
+
+    _cmdlineflags_add_generator(${target} generator)
+
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}-cmdlineflags-help.c)
+
+    if(arg_TEXT)
+        get_filename_component(text ${arg_TEXT} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_BINARY_DIR})
+    else()
+        set(text ${CMAKE_CURRENT_BINARY_DIR}/${target}-cmdlineflags-help.txt)
+    endif()
+
+    add_custom_command(OUTPUT ${output} ${text}
+        COMMAND ${CMAKE_COMMAND} -E env CMDLINEFLAGS_GENERATE_HELP=${output} CMDLINEFLAGS_GENERATE_HELP_TEXT=${text}
+            $<TARGET_FILE:${generator}>
+        DEPENDS ${generator}
+        COMMENT "Generating cmdlineflags help message of ${target}"
+        VERBATIM)
+
+    target_sources(${target} PRIVATE ${output})
+endfunction()
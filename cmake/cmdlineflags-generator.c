@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags-generator.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Built into the generator twins (see cmdlineflags-generate.cmake) only, never into the programs themselves.
+ * When requested by the environment, the generated files are written and the process terminates before main() is run.
+ */
+
+#if !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE /* secure_getenv() */
+#endif
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+#include <cmdlineflags/cmdlineflags_index.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static void* cmdlineflags_generator_alloc(void* ctx, size_t size);
+static void cmdlineflags_generator_free(void* ctx, void* ptr);
+static void cmdlineflags_generator(void) __attribute__((constructor));
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static void* cmdlineflags_generator_alloc(void* ctx, size_t size)
+{
+    return malloc(size);
+}
+
+static void cmdlineflags_generator_free(void* ctx, void* ptr)
+{
+    free(ptr);
+}
+
+static void cmdlineflags_generator(void)
+{
+    /* Runs at build time only (and exits), so it does not have to do without the heap,
+       even if the library was built with CMDLINEFLAGS_NO_MALLOC. */
+    struct cmdlineflags_allocator allocator = {
+        .alloc = cmdlineflags_generator_alloc,
+        .free = cmdlineflags_generator_free,
+    };
+    const char* index_path;
+    const char* help_path;
+    int status;
+
+    index_path = secure_getenv("CMDLINEFLAGS_GENERATE_INDEX");
+    help_path = secure_getenv("CMDLINEFLAGS_GENERATE_HELP");
+    if ((index_path == NULL) && (help_path == NULL))
+        return;
+
+    status = cmdlineflags_set_allocator(&allocator);
+
+    if ((status == CMDLINEFLAGS_SUCCESS) && (index_path != NULL) &&
+        (cmdlineflags_generate_index_source(index_path) != CMDLINEFLAGS_SUCCESS)) {
+        fprintf(stderr, "cmdlineflags: cannot generate '%s'\n", index_path);
+        status = CMDLINEFLAGS_FAILURE;
+    }
+
+    if ((status == CMDLINEFLAGS_SUCCESS) && (help_path != NULL) &&
+        (cmdlineflags_generate_help_source(help_path, secure_getenv("CMDLINEFLAGS_GENERATE_HELP_TEXT")) != CMDLINEFLAGS_SUCCESS)) {
+        fprintf(stderr, "cmdlineflags: cannot generate '%s'\n", help_path);
+        status = CMDLINEFLAGS_FAILURE;
+    }
+
+    _exit(status == CMDLINEFLAGS_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -14,6 +14,19 @@
  * from multiple threads concurently. But on the other hand,
  * who would like to call for example cmdlineflags_parse() concurently.
  * As in the real live, common sense should prevail.
+ * Well, there is one exception. cmdlineflags_parse_r() keeps all its state
+ * in the 'struct cmdlineflags_parser' passed to it, so many threads may parse
+ * concurently as long as each one uses its own parser (and the handlers
+ * of the options, e.g. those taking the parser, do not share anything either).
+ *
+ * Two layouts of the options registry are available. The default one keeps
+ * everything known about an option in one 'struct cmdlineflags' record.
+ * When CMDLINEFLAGS_COMPACT_LAYOUT is defined (cmake option of the same name
+ * defines it for the library and for everything linked against it),
+ * the records only keep what is needed to look an option up and call its handler,
+ * whereas help messages and sibblings are moved to separate 'struct cmdlineflags_help'
+ * records, which are never touched by cmdlineflags_parse().
+ * Both the library and all the code defining options must use the same layout.
  */
 
 #ifndef _CMDLINEFLAGS_H_
@@ -29,6 +42,8 @@
  * system header files
 \*===========================================================================*/
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 /*===========================================================================*\
  * project header files
@@ -44,13 +59,19 @@
 #define CMDLINEFLAGS_SUCCESS (0)
 #define CMDLINEFLAGS_FAILURE (-1)
 
-#define CMDLINEFLAGS_ALIGN             32
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    /* Explicit alignment keeps the compiler from over-aligning (and thus spacing) the records. */
+    #define CMDLINEFLAGS_ALIGN         8
+#else
+    #define CMDLINEFLAGS_ALIGN         32
+#endif
 #define CMDLINEFLAGS_STRINGIFY(x)      #x
 #define CMDLINEFLAGS_XSTR(x)           CMDLINEFLAGS_STRINGIFY(x)
 #define CMDLINEFLAGS_CONCATENATE(a, b) a##b
 
 #define CMDLINEFLAGS_CONCATENATE_SECTION_SHORTOPTIONS(section) CMDLINEFLAGS_CONCATENATE(section, _shortoptions)
 #define CMDLINEFLAGS_CONCATENATE_SECTION_LONGOPTIONS(section)  CMDLINEFLAGS_CONCATENATE(section, _longoptions)
+#define CMDLINEFLAGS_CONCATENATE_SECTION_HELP(section)         CMDLINEFLAGS_CONCATENATE(section, _help)
 #define CMDLINEFLAGS_CONCATENATE_SECTION_START(section)        CMDLINEFLAGS_CONCATENATE(__start_, section)
 #define CMDLINEFLAGS_CONCATENATE_SECTION_END(section)          CMDLINEFLAGS_CONCATENATE(__stop_, section)
 
@@ -64,13 +85,120 @@
 #define CMDLINEFLAGS_LONGOPTIONS_SECTION_START CMDLINEFLAGS_CONCATENATE_SECTION_START(CMDLINEFLAGS_LONGOPTIONS_SECTION_ID)
 #define CMDLINEFLAGS_LONGOPTIONS_SECTION_END   CMDLINEFLAGS_CONCATENATE_SECTION_END(CMDLINEFLAGS_LONGOPTIONS_SECTION_ID)
 
+#define CMDLINEFLAGS_HELP_SECTION_ID    CMDLINEFLAGS_CONCATENATE_SECTION_HELP(CMDLINEFLAGS_SECTION_PREFIX)
+#define CMDLINEFLAGS_HELP_SECTION_NAME  CMDLINEFLAGS_XSTR(CMDLINEFLAGS_HELP_SECTION_ID)
+#define CMDLINEFLAGS_HELP_SECTION_START CMDLINEFLAGS_CONCATENATE_SECTION_START(CMDLINEFLAGS_HELP_SECTION_ID)
+#define CMDLINEFLAGS_HELP_SECTION_END   CMDLINEFLAGS_CONCATENATE_SECTION_END(CMDLINEFLAGS_HELP_SECTION_ID)
+
 #define CMDLINEFLAGS_GLOBAL_MODULE _
 
+/* Modules may be nested in other modules, in which case their names are the paths of the levels
+   joined with the separator, e.g. options of 'tool cluster node drain' are defined in 'cluster__node__drain' module. */
+#define CMDLINEFLAGS_MODULE_SEPARATOR "__"
+
+/* Maximum number of arguments cmdlineflags_parse_line() splits a line into, when not given an argv. */
+#define CMDLINEFLAGS_LINE_MAX_ARGS 64
+
+/* Environment variable the completion scripts (see cmdlineflags_write_completion_script()) run the program with,
+   set to the index of the word being completed. */
+#define CMDLINEFLAGS_COMPLETE_ENV "CMDLINEFLAGS_COMPLETE"
+
 /* https://www.youtube.com/watch?v=ohDB5gbtaEQ */
 #define CMDLINEFLAGS_NO_ARGUMENT       0
 #define CMDLINEFLAGS_REQUIRED_ARGUMENT 1
 
+/* Same as above, but the handlers are also given the parser (and thus its 'user' data). */
+#define CMDLINEFLAGS_NO_ARGUMENT_R       2
+#define CMDLINEFLAGS_REQUIRED_ARGUMENT_R 3
+
+/* Options bound to a variable (given instead of the handler), which is set by the library itself.
+   CMDLINEFLAGS_BOOL sets its 'bool' to true and takes no argument. The others take an argument converted
+   (regardless of the locale) into an 'int', 'uint64_t', 'double', 'const char*' (the argument itself)
+   or 'uint64_t' number of nanoseconds (e.g. 250ms, 1h30m, 1.5s; plain numbers are seconds) respectively. */
+#define CMDLINEFLAGS_BOOL     4
+#define CMDLINEFLAGS_INT      5
+#define CMDLINEFLAGS_UINT64   9
+#define CMDLINEFLAGS_DOUBLE   13
+#define CMDLINEFLAGS_STRING   17
+#define CMDLINEFLAGS_DURATION 21
+
+/* Options which are delivered only once, when all the arguments have been parsed, however many times they occur.
+   CMDLINEFLAGS_BATCH_NO_ARGUMENT handlers get the number of occurrences, CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT
+   ones get all the arguments (null terminated array, in order), whereas the handlers of CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT
+   (and CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT_R) options get the last argument only.
+   Occurrences of the short and long names of an option (defined together) are delivered together,
+   with the first of them given as the option. Distinct options are delivered separately, even if they share the handler. */
+#define CMDLINEFLAGS_BATCH_NO_ARGUMENT        6
+#define CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT  7
+#define CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT   11
+#define CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT_R 15
+
+/* Same as CMDLINEFLAGS_REQUIRED_ARGUMENT, but the handler is safe to be called concurrently with any other handler
+   (and with itself), so it is called by one of the library's worker threads while the parsing goes on.
+   All such handlers are done by the time cmdlineflags_parse_r() returns (see there). */
+#define CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT 19
+
 // clang-format off
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+#define __CMDLINEFLAGS_DEFINE_HELP(_name_, _cmdlineflags_, _sibbling_, _help_)                                  \
+    const struct cmdlineflags_help cmdlineflags_help_ ## _name_                                                \
+        __attribute__((__section__(CMDLINEFLAGS_HELP_SECTION_NAME)))                                           \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        {                                                                                                      \
+            .cmdlineflags = _cmdlineflags_,                                                                    \
+            .sibbling = _sibbling_,                                                                            \
+            .help = _help_                                                                                     \
+        }
+
+#define __CMDLINEFLAGS_DEFINE_SHORT_OPTION(_module_, _shortoption_, _flags_, _function_)                       \
+    const struct cmdlineflags cmdlineflags_shortoptions_ ## _module_ ## _ ## _shortoption_                     \
+        [sizeof(#_shortoption_) == 2 ? 1 : -1]                                                                 \
+        __attribute__((__section__(CMDLINEFLAGS_SHORTOPTIONS_SECTION_NAME)))                                   \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        {{                                                                                                     \
+            .module = #_module_,                                                                               \
+            .option = {.type = CMDLINEFLAGS_SHORTOPTION, .u = {.shortoption = #_shortoption_[0]}},             \
+            .flags = _flags_,                                                                                  \
+            .u = {.f ## _flags_ = _function_}                                                                  \
+        }}
+
+#define __CMDLINEFLAGS_DEFINE_LONG_OPTION(_module_, _longoption_, _flags_, _function_)                         \
+    const struct cmdlineflags cmdlineflags_longoptions_ ## _module_ ## _ ## _longoption_                       \
+        [sizeof(#_longoption_) > 1 ? 1 : -1]                                                                   \
+        __attribute__((__section__(CMDLINEFLAGS_LONGOPTIONS_SECTION_NAME)))                                    \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        {{                                                                                                     \
+            .module = #_module_,                                                                               \
+            .option = {.type = CMDLINEFLAGS_LONGOPTION, .u = {.longoption = #_longoption_}},                   \
+            .flags = _flags_,                                                                                  \
+            .u = {.f ## _flags_ = _function_}                                                                  \
+        }}
+
+#define __CMDLINEFLAGS_DEFINE_SHORT_OPTION_A(_module_, _shortoption_, _flags_, _function_, _help_)             \
+    __CMDLINEFLAGS_DEFINE_SHORT_OPTION(_module_, _shortoption_, _flags_, _function_);                          \
+    __CMDLINEFLAGS_DEFINE_HELP(shortoptions_ ## _module_ ## _ ## _shortoption_,                                \
+        cmdlineflags_shortoptions_ ## _module_ ## _ ## _shortoption_,                                          \
+        ((const struct cmdlineflags*)0), _help_)
+
+/* The help record of an option pair is attached to its short option. */
+#define __CMDLINEFLAGS_DEFINE_SHORT_OPTION_B(_module_, _shortoption_, _flags_, _function_, _help_, _sibbling_) \
+    __CMDLINEFLAGS_DEFINE_SHORT_OPTION(_module_, _shortoption_, _flags_, _function_);                          \
+    __CMDLINEFLAGS_DEFINE_HELP(shortoptions_ ## _module_ ## _ ## _shortoption_,                                \
+        cmdlineflags_shortoptions_ ## _module_ ## _ ## _shortoption_,                                          \
+        cmdlineflags_longoptions_ ## _module_ ## _ ## _sibbling_, _help_)
+
+#define __CMDLINEFLAGS_DEFINE_LONG_OPTION_A(_module_, _longoption_, _flags_, _function_, _help_)               \
+    __CMDLINEFLAGS_DEFINE_LONG_OPTION(_module_, _longoption_, _flags_, _function_);                            \
+    __CMDLINEFLAGS_DEFINE_HELP(longoptions_ ## _module_ ## _ ## _longoption_,                                  \
+        cmdlineflags_longoptions_ ## _module_ ## _ ## _longoption_,                                            \
+        ((const struct cmdlineflags*)0), _help_)
+
+#define __CMDLINEFLAGS_DEFINE_LONG_OPTION_B(_module_, _longoption_, _flags_, _function_, _help_)               \
+    __CMDLINEFLAGS_DEFINE_LONG_OPTION(_module_, _longoption_, _flags_, _function_)
+#else
 #define __CMDLINEFLAGS_DEFINE_SHORT_OPTION_A(_module_, _shortoption_, _flags_, _function_, _help_)             \
     const struct cmdlineflags cmdlineflags_shortoptions_ ## _module_ ## _ ## _shortoption_                     \
         [sizeof(#_shortoption_) == 2 ? 1 : -1]                                                                 \
@@ -130,6 +258,7 @@
             .help = _help_,                                                                                    \
             .sibbling = cmdlineflags_longoptions_ ## _module_ ## _ ## _longoption_                             \
         }}
+#endif
 // clang-format on
 
 #define CMDLINEFLAGS_DEFINE_SHORT_OPTION(_module_, _shortoption_, _flags_, _function_, _help_) \
@@ -142,6 +271,80 @@
     __CMDLINEFLAGS_DEFINE_LONG_OPTION_B(_module_, _longoption_, _flags_, _function_, _help_);   \
     __CMDLINEFLAGS_DEFINE_SHORT_OPTION_B(_module_, _shortoption_, _flags_, _function_, _help_, _longoption_)
 
+/* Options bound to variables. Short or long only ones are defined with e.g.
+   CMDLINEFLAGS_DEFINE_LONG_OPTION(_module_, _longoption_, CMDLINEFLAGS_INT, &_variable_, _help_). */
+#define CMDLINEFLAGS_DEFINE_BOOL(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_BOOL, &(_variable_), _help_)
+
+#define CMDLINEFLAGS_DEFINE_INT(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_INT, &(_variable_), _help_)
+
+#define CMDLINEFLAGS_DEFINE_UINT64(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_UINT64, &(_variable_), _help_)
+
+#define CMDLINEFLAGS_DEFINE_DOUBLE(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_DOUBLE, &(_variable_), _help_)
+
+#define CMDLINEFLAGS_DEFINE_STRING(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_STRING, &(_variable_), _help_)
+
+#define CMDLINEFLAGS_DEFINE_DURATION(_module_, _shortoption_, _longoption_, _variable_, _help_) \
+    CMDLINEFLAGS_DEFINE(_module_, _shortoption_, _longoption_, CMDLINEFLAGS_DURATION, &(_variable_), _help_)
+
+// clang-format off
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+#define __CMDLINEFLAGS_DEFINE_HELP_SECTION(_name_)                                                             \
+    extern const struct cmdlineflags_help CMDLINEFLAGS_HELP_SECTION_START                                      \
+        __attribute__((visibility("hidden")));                                                                 \
+    extern const struct cmdlineflags_help CMDLINEFLAGS_HELP_SECTION_END                                        \
+        __attribute__((visibility("hidden")));                                                                 \
+    static const struct cmdlineflags_help cmdlineflags_help_ ## _name_ ## _0                                   \
+        __attribute__((__section__(CMDLINEFLAGS_HELP_SECTION_NAME)))                                           \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) = {0}
+#define __CMDLINEFLAGS_HELP_SECTION                                                                            \
+    .help_start = &CMDLINEFLAGS_HELP_SECTION_START,                                                            \
+    .help_end = &CMDLINEFLAGS_HELP_SECTION_END,
+#else
+/* Nothing to define, just consumes the semicolon. */
+#define __CMDLINEFLAGS_DEFINE_HELP_SECTION(_name_)                                                             \
+    extern const struct cmdlineflags CMDLINEFLAGS_LONGOPTIONS_SECTION_END                                      \
+        __attribute__((visibility("hidden")))
+#define __CMDLINEFLAGS_HELP_SECTION
+#endif
+
+/* Defines 'static const struct cmdlineflags_sections _name_' describing the options sections
+   of the image (e.g. a plugin loaded with dlopen()) it is expanded in, to be given to cmdlineflags_register().
+   Shall be expanded once per image, at file scope. Sections are referenced with hidden visibility,
+   so that they are never resolved to the ones of another image. */
+#define CMDLINEFLAGS_DEFINE_SECTIONS(_name_)                                                                   \
+    extern const struct cmdlineflags CMDLINEFLAGS_SHORTOPTIONS_SECTION_START                                   \
+        __attribute__((visibility("hidden")));                                                                 \
+    extern const struct cmdlineflags CMDLINEFLAGS_SHORTOPTIONS_SECTION_END                                     \
+        __attribute__((visibility("hidden")));                                                                 \
+    extern const struct cmdlineflags CMDLINEFLAGS_LONGOPTIONS_SECTION_START                                    \
+        __attribute__((visibility("hidden")));                                                                 \
+    extern const struct cmdlineflags CMDLINEFLAGS_LONGOPTIONS_SECTION_END                                      \
+        __attribute__((visibility("hidden")));                                                                 \
+    /* Makes sure the sections exist even if the image defines no short (or no long) options. */             \
+    static const struct cmdlineflags cmdlineflags_shortoptions_ ## _name_ ## _0                                \
+        __attribute__((__section__(CMDLINEFLAGS_SHORTOPTIONS_SECTION_NAME)))                                   \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) = {0};                                                    \
+    static const struct cmdlineflags cmdlineflags_longoptions_ ## _name_ ## _0                                 \
+        __attribute__((__section__(CMDLINEFLAGS_LONGOPTIONS_SECTION_NAME)))                                    \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) = {0};                                                    \
+    __CMDLINEFLAGS_DEFINE_HELP_SECTION(_name_);                                                                \
+    static const struct cmdlineflags_sections _name_ = {                                                       \
+        .shortoptions_start = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START,                                        \
+        .shortoptions_end = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_END,                                            \
+        .longoptions_start = &CMDLINEFLAGS_LONGOPTIONS_SECTION_START,                                           \
+        .longoptions_end = &CMDLINEFLAGS_LONGOPTIONS_SECTION_END,                                              \
+        __CMDLINEFLAGS_HELP_SECTION                                                                            \
+    }
+// clang-format on
+
 /*===========================================================================*\
  * global type definitions
 \*===========================================================================*/
@@ -149,6 +352,93 @@ struct cmdlineflags_cfg {
     /* == 0 - do not,
         != 0 - do emit debug messages */
     int emit_debug_messages;
+
+    /* == 0 - do not,
+        != 0 - do replace '@file' arguments with the arguments read from the 'file' */
+    int expand_response_files;
+
+    /* Maximum number of arguments after the expansion of response files (0 selects the default bound). */
+    unsigned max_expanded_args;
+
+    /* When not NULL (nor empty), long options are also taken from <env_prefix>_[<MODULE>_]<LONGOPTION>
+       environment variables (matched case insensitively, with '-' spelled as '_'), e.g. MYTOOL_NET_TIMEOUT
+       for 'timeout' option of 'net' module. The string shall outlive the configuration. */
+    const char* env_prefix;
+
+    /* When not NULL, options are also taken from this configuration file (see cmdlineflags_parse_r()).
+       The string shall outlive the configuration. */
+    const char* config_file;
+
+    /* == 0 - do not,
+        != 0 - do count occurrences of the options and time their handlers (see cmdlineflags_get_stats()) */
+    int collect_stats;
+
+    /* == 0 - do not,
+        != 0 - do accept unambiguous prefixes of long options given on the command line (e.g. '--verb' for '--verbose') */
+    int allow_abbreviations;
+
+    /* == 0 - do not,
+        != 0 - do look the options not found in the module up in its ancestors and then in the global module */
+    int inherit_options;
+};
+
+enum cmdlineflags_error {
+    CMDLINEFLAGS_ERROR_NONE,
+    CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION,
+    CMDLINEFLAGS_ERROR_MISSING_ARGUMENT,
+    CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT,
+    /* Handler of an option returned non zero value. */
+    CMDLINEFLAGS_ERROR_HANDLER,
+    /* Response file is malformed, nested too deeply or expands to too many arguments. */
+    CMDLINEFLAGS_ERROR_RESPONSE_FILE,
+    /* Configuration file cannot be read or is malformed. */
+    CMDLINEFLAGS_ERROR_CONFIG_FILE,
+    /* Argument of an option bound to a variable is malformed or out of range. */
+    CMDLINEFLAGS_ERROR_INVALID_ARGUMENT,
+    /* Abbreviated long option matches more than one option. */
+    CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION,
+    /* Memory (e.g. for the lookup index) cannot be allocated (see cmdlineflags_set_allocator()). */
+    CMDLINEFLAGS_ERROR_NO_MEMORY
+};
+
+/* Shells the completion scripts are written for. */
+enum cmdlineflags_shell {
+    CMDLINEFLAGS_SHELL_BASH,
+    CMDLINEFLAGS_SHELL_ZSH,
+    CMDLINEFLAGS_SHELL_FISH
+};
+
+/* Memory kept by the parser on behalf of the caller (see cmdlineflags_parser_release()). */
+struct cmdlineflags_resource;
+
+/* Options to be delivered by cmdlineflags_parse_r() once it is done with the arguments. */
+struct cmdlineflags_occurrences;
+
+/* Handlers called in parallel, to be waited for by cmdlineflags_parse_r(). */
+struct cmdlineflags_jobs;
+
+struct cmdlineflags_parser {
+    struct cmdlineflags_cfg cfg;
+
+    /* Opaque to the library, passed to the handlers along with the parser. */
+    void* user;
+
+    /* Set by cmdlineflags_parse_r(): the first error (in order of the arguments),
+       index (into argv) of the element which caused it and the number of all errors. */
+    enum cmdlineflags_error error;
+    int error_index;
+    unsigned n_errors;
+
+    /* Set by cmdlineflags_parse_r(): arguments which have actually been parsed,
+       i.e. either the ones passed to it or the ones with response files expanded. */
+    int argc;
+    char* const* argv;
+
+    struct cmdlineflags_resource* resources;
+
+    /* Used internally by cmdlineflags_parse_r(). */
+    struct cmdlineflags_occurrences* occurrences;
+    struct cmdlineflags_jobs* jobs;
 };
 
 enum cmdlineflags_type {
@@ -173,11 +463,72 @@ struct cmdlineflags {
     union {
         int (*f0)(const struct cmdlineflags_option* option);
         int (*f1)(const struct cmdlineflags_option* option, const char* argument);
+        int (*f2)(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option);
+        int (*f3)(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option, const char* argument);
+        int (*f6)(const struct cmdlineflags_option* option, unsigned count);
+        int (*f7)(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count);
+        int (*f11)(const struct cmdlineflags_option* option, const char* argument);
+        int (*f15)(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option, const char* argument);
+        int (*f19)(const struct cmdlineflags_option* option, const char* argument);
+
+        /* Variables of the options bound to them, named after the flags as the handlers are. */
+        bool* f4;
+        int* f5;
+        uint64_t* f9;
+        double* f13;
+        const char** f17;
+        uint64_t* f21;
     } u;
 
+#if !defined(CMDLINEFLAGS_COMPACT_LAYOUT)
     const char* help;
     const struct cmdlineflags* sibbling;
+#endif
+} __attribute__((aligned(CMDLINEFLAGS_ALIGN)));
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+/* One per each line of the help message. */
+struct cmdlineflags_help {
+    const struct cmdlineflags* cmdlineflags;
+    const struct cmdlineflags* sibbling;
+    const char* help;
 } __attribute__((aligned(CMDLINEFLAGS_ALIGN)));
+#endif
+
+/* Options sections of a single image (see CMDLINEFLAGS_DEFINE_SECTIONS()). */
+struct cmdlineflags_sections {
+    const struct cmdlineflags* shortoptions_start;
+    const struct cmdlineflags* shortoptions_end;
+    const struct cmdlineflags* longoptions_start;
+    const struct cmdlineflags* longoptions_end;
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    const struct cmdlineflags_help* help_start;
+    const struct cmdlineflags_help* help_end;
+#endif
+};
+
+/* Statistics of a single option, i.e. of a single entry of the options sections. */
+struct cmdlineflags_stats {
+    const struct cmdlineflags* cmdlineflags;
+    /* Number of occurrences of the option. */
+    uint64_t hits;
+    /* Cumulative time (in nanoseconds) spent in the handler of the option (or in the conversion
+       of its argument if it is bound to a variable). */
+    uint64_t handler_ns;
+};
+
+/* Source of all the memory used by the library (see cmdlineflags_set_allocator()). */
+struct cmdlineflags_allocator {
+    /* Returns at least 'size' bytes suitably aligned for any object or NULL. */
+    void* (*alloc)(void* ctx, size_t size);
+    /* Resizes the memory returned by 'alloc', keeping its content, or returns NULL leaving it untouched.
+       May be NULL, the memory is then moved to a new allocation instead. */
+    void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t size);
+    /* Releases the memory returned by 'alloc' or 'realloc'. May be NULL (e.g. for arenas released as a whole). */
+    void (*free)(void* ctx, void* ptr);
+    /* Passed to all the above. */
+    void* ctx;
+};
 
 /*===========================================================================*\
  * static inline (internal linkage) function definitions
@@ -192,6 +543,11 @@ LTS_EXTERN const struct cmdlineflags CMDLINEFLAGS_SHORTOPTIONS_SECTION_END;
 LTS_EXTERN const struct cmdlineflags CMDLINEFLAGS_LONGOPTIONS_SECTION_START;
 LTS_EXTERN const struct cmdlineflags CMDLINEFLAGS_LONGOPTIONS_SECTION_END;
 
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+LTS_EXTERN const struct cmdlineflags_help CMDLINEFLAGS_HELP_SECTION_START;
+LTS_EXTERN const struct cmdlineflags_help CMDLINEFLAGS_HELP_SECTION_END;
+#endif
+
 /*===========================================================================*\
  * function forward declarations (external linkage)
 \*===========================================================================*/
@@ -212,11 +568,152 @@ LTS_EXTERN const char* cmdlineflags_version(void);
  * @param[in] argc Argument count as passed to the main() on program invocation.
  * @param[in,out] argv Argument vector as passed to the main() on program invocation.
  *
+ * When response files are expanded (see 'struct cmdlineflags_cfg'), the returned index
+ * refers to the expanded arguments, which may be retrieved with cmdlineflags_get_args().
+ *
+ * A handler returning non zero value stops the parsing, which then returns a negative value
+ * (see cmdlineflags_parse_r()).
+ *
  * @note Please see also unistd.h, and/or getopt.h.
- * @return Index (into argv) of the first nonoptions argument.
+ * @return Index (into argv) of the first nonoptions argument or a negative value on a fatal error.
  */
 LTS_EXTERN int cmdlineflags_parse(int argc, char* const argv[]);
 
+/**
+ * Retrieves the arguments parsed by the last call to cmdlineflags_parse().
+ *
+ * These are the arguments passed to cmdlineflags_parse() unless some response files
+ * have been expanded, in which case they stay valid until cmdlineflags_release().
+ *
+ * @param[out] argv Pointer to be set to the argument vector (may be NULL).
+ *
+ * @return Argument count.
+ */
+LTS_EXTERN int cmdlineflags_get_args(char* const** argv);
+
+/**
+ * Releases the memory kept by cmdlineflags_parse() (and cmdlineflags_parse_line()
+ * called without a parser) for the arguments read from response files.
+ *
+ * Arguments of the options read from response files, as given to the handlers,
+ * point into that memory, so they shall not be used afterwards.
+ */
+LTS_EXTERN void cmdlineflags_release(void);
+
+/**
+ * Initializes the parser.
+ *
+ * Configuration of the parser is taken from the current cmdlineflags configuration
+ * (see cmdlineflags_set_cfg()), it may be changed afterwards directly in the parser.
+ *
+ * @param[out] parser Pointer to the parser to be initialized.
+ * @param[in] user Data passed to the handlers of the options defined with
+ *                 CMDLINEFLAGS_NO_ARGUMENT_R or CMDLINEFLAGS_REQUIRED_ARGUMENT_R flags.
+ *
+ * @return 0 on success, negative value otherwise.
+ */
+LTS_EXTERN int cmdlineflags_parser_init(struct cmdlineflags_parser* parser, void* user);
+
+/**
+ * Parses the command-line arguments (reentrant version).
+ *
+ * Works exactly as cmdlineflags_parse() does, but uses configuration of the given parser
+ * instead of the global one and records the errors in the parser.
+ *
+ * Response files are expanded into memory kept by the parser until cmdlineflags_parser_release(),
+ * the expanded arguments are available as parser's 'argc' and 'argv' (to which the returned index refers).
+ * A response file may name further response files. Files which cannot be read are left
+ * as ordinary arguments.
+ *
+ * A handler returning non zero value (whichever way it is called, see below) is a fatal error,
+ * recorded as CMDLINEFLAGS_ERROR_HANDLER, which makes this function return a negative value.
+ * The parsing stops right after a failed handler called in order, but goes on after a failed parallel one,
+ * which is only known to have failed once it is waited for. Either way, the error recorded in the parser
+ * is the one of the lowest index, i.e. the first failure in order of the arguments.
+ *
+ * Options defined with CMDLINEFLAGS_BATCH_* or CMDLINEFLAGS_LAST_* flags are delivered last,
+ * in the order of their first occurrences, once all the sources below have been parsed.
+ * Their handlers are not called at all when there was a fatal error (e.g. a failed handler).
+ *
+ * Handlers of the options defined with CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT flag are called by a small
+ * pool of worker threads (or, when there are none, by the parsing thread itself), in no particular order,
+ * while all the other handlers are called in order, as the options are parsed. The parsing waits for all of them
+ * before the delivery of the options mentioned above.
+ *
+ * Options may also be taken from a configuration file and from the environment
+ * (see 'struct cmdlineflags_cfg'). The configuration file is handled first, then the environment
+ * and then the command line, regardless of the module given on the command line.
+ *
+ * The configuration file holds 'key = value' lines, where the key is a long (or short) option
+ * and the value its argument (optionally quoted). Options of the global module come first,
+ * options of other modules follow '[module]' lines. Empty lines and lines starting with '#' or ';'
+ * are ignored. The file is memory mapped and the arguments given to the handlers point into it,
+ * until cmdlineflags_parser_release().
+ *
+ * Options without an argument are called when their value (or environment variable) is 1, true, yes or on
+ * (or missing at all in the configuration file) and skipped when it is empty, 0, false, no or off.
+ * Errors caused by the configuration file or the environment are recorded with the error index of 0
+ * and a failing handler makes this function return a negative value.
+ *
+ * @param[in,out] parser Pointer to the parser initialized with cmdlineflags_parser_init().
+ * @param[in] argc Argument count.
+ * @param[in,out] argv Argument vector.
+ *
+ * @return Index (into argv) of the first nonoptions argument or a negative value on a fatal error.
+ */
+LTS_EXTERN int cmdlineflags_parse_r(struct cmdlineflags_parser* parser, int argc, char* const argv[]);
+
+/**
+ * Releases the memory kept by the parser for the arguments read from response files.
+ *
+ * Arguments of the options read from response files, as given to the handlers,
+ * point into that memory, so they shall not be used afterwards.
+ * The parser may be used again afterwards.
+ *
+ * @param[in,out] parser Pointer to the parser.
+ */
+LTS_EXTERN void cmdlineflags_parser_release(struct cmdlineflags_parser* parser);
+
+/**
+ * Splits the command line into arguments, in place.
+ *
+ * Arguments are separated by whitespaces. Quoting and escaping follows the shell rules:
+ * everything between single quotes is taken literally, between double quotes
+ * a backslash only escapes '"', '\\', '$' and '`', elsewhere it escapes any character.
+ * The 'line' is modified (quotes and escapes are removed and arguments get null terminated)
+ * and the 'argv' is filled with pointers into it, followed by a NULL pointer.
+ * No memory is allocated.
+ *
+ * @param[in,out] line Null terminated command line.
+ * @param[out] argv Array to be filled with the arguments.
+ * @param[in] argv_size Number of elements of the 'argv' (including the one for the terminating NULL).
+ *
+ * @return Number of arguments or a negative value if an error was encountered
+ *         (unterminated quote, trailing backslash or too many arguments).
+ */
+LTS_EXTERN int cmdlineflags_tokenize_line(char* line, char* argv[], int argv_size);
+
+/**
+ * Parses the command line given as a single string.
+ *
+ * Splits the 'line' with cmdlineflags_tokenize_line() and parses the resulting
+ * arguments with cmdlineflags_parse_r(). First argument is the command (program) name,
+ * exactly as argv[0] passed to the main().
+ *
+ * @param[in,out] parser Pointer to the parser, or NULL to use the global configuration.
+ * @param[in,out] line Null terminated command line, modified in place.
+ * @param[out] argv Array to be filled with the arguments, or NULL to use internal
+ *                  one of CMDLINEFLAGS_LINE_MAX_ARGS elements. The internal array does not outlive
+ *                  this call, so the nonoption arguments cannot be reached then (neither through
+ *                  the parser nor with cmdlineflags_get_args()), only the options are handled.
+ * @param[in] argv_size Number of elements of the 'argv' (ignored when 'argv' is NULL).
+ *
+ * @return Index (into argv) of the first nonoptions argument
+ *         or a negative value if the line cannot be split. When 'argv' is NULL only the sign
+ *         of the returned value is meaningful.
+ */
+LTS_EXTERN int cmdlineflags_parse_line(struct cmdlineflags_parser* parser, char* line, char* argv[], int argv_size);
+
 /**
  * Copies help message to the buffer pointed to by 'msg' argument.
  *
@@ -231,9 +728,12 @@ LTS_EXTERN int cmdlineflags_parse(int argc, char* const argv[]);
  * 'size' of 0 to learn the size of overall message first and then in the second call
  * use buffer of sufficient size to be filled with message string.
  *
+ * Options are grouped by modules. Options of the global module come first,
+ * then the options of all other modules ordered by module name.
+ *
  * @param[out] msg Pointer to the output buffer to be filled with message string.
  * @param[in] size Maximum number of bytes that shall be copied to the output buffer.
- * @param[in] sort When true, provides sorted view of all options, when false, no sorting is performed.
+ * @param[in] sort When true, options of each module are sorted, when false, no sorting is performed.
  *
  * @return Number of characters constituting the help message
  *         (excluding the terminating null byte ('\0')) or a negative value
@@ -241,6 +741,214 @@ LTS_EXTERN int cmdlineflags_parse(int argc, char* const argv[]);
  */
 LTS_EXTERN int cmdlineflags_get_help_msg(char* msg, unsigned size, bool sort);
 
+/**
+ * Copies help message of a single module to the buffer pointed to by 'msg' argument.
+ *
+ * Works exactly as cmdlineflags_get_help_msg() does, but only the options
+ * of the given module are listed.
+ *
+ * @param[in] module Name of the module. NULL denotes the global module.
+ * @param[out] msg Pointer to the output buffer to be filled with message string.
+ * @param[in] size Maximum number of bytes that shall be copied to the output buffer.
+ * @param[in] sort When true, options are sorted, when false, no sorting is performed.
+ *
+ * @return Number of characters constituting the help message
+ *         (excluding the terminating null byte ('\0')) or a negative value
+ *         if an error was encountered (e.g. there is no such module).
+ */
+LTS_EXTERN int cmdlineflags_get_module_help_msg(const char* module, char* msg, unsigned size, bool sort);
+
+/**
+ * Writes help message to the file descriptor 'fd'.
+ *
+ * The message is the same as the one produced by cmdlineflags_get_help_msg(),
+ * but it is emitted in one pass, in chunks (with writev()), using bounded amount
+ * of memory regardless of the number of options.
+ *
+ * @param[in] fd File descriptor the help message shall be written to.
+ * @param[in] sort When true, options of each module are sorted, when false, no sorting is performed.
+ *
+ * @return Number of characters written or a negative value if an error was encountered.
+ */
+LTS_EXTERN int cmdlineflags_write_help(int fd, bool sort);
+
+/**
+ * Writes help message to the 'stream'.
+ *
+ * Works exactly as cmdlineflags_write_help() does, but writes with fwrite().
+ *
+ * @param[in] stream Stream the help message shall be written to.
+ * @param[in] sort When true, options of each module are sorted, when false, no sorting is performed.
+ *
+ * @return Number of characters written or a negative value if an error was encountered.
+ */
+LTS_EXTERN int cmdlineflags_fwrite_help(FILE* stream, bool sort);
+
+/**
+ * Prints (to the standard output) the candidates completing the word of the command line at the 'cursor'.
+ *
+ * Meant to be called by the program instead of parsing its arguments, when it is run
+ * by the completion script (see cmdlineflags_write_completion_script()) with CMDLINEFLAGS_COMPLETE_ENV
+ * environment variable set:
+ *
+ *   const char* cursor = getenv(CMDLINEFLAGS_COMPLETE_ENV);
+ *   if (cursor != NULL)
+ *       return cmdlineflags_complete(argc, argv, atoi(cursor)) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+ *
+ * Words preceding the cursor select the module (nested modules included) and are skipped
+ * along with the arguments of their options, as cmdlineflags_parse() would do, but no handler is called.
+ * Then, the word at the cursor is completed with the names of the modules (nested in the selected one),
+ * when it does not start with '-', or the options of the selected module, when it starts with '--'
+ * (or is just '-', in which case the short options are listed too). Options inherited from the ancestors
+ * of the module are listed when 'inherit_options' is set in the configuration. Nothing is listed
+ * for the arguments of the options nor for the words following '--' or the first non-option argument
+ * which does not name a module.
+ *
+ * Candidates are looked up in the sorted modules and in the radix trees of the long options,
+ * so the time taken depends on the number of candidates rather than the number of all the options.
+ * They are printed one per line, in order, with '_' of the long options spelled as '-'.
+ *
+ * @param[in] argc Number of the words of the command line, possibly excluding the one at the cursor (if empty).
+ * @param[in] argv Words of the command line, the first one being the program itself.
+ * @param[in] cursor Index (into argv) of the word being completed.
+ *
+ * @return Number of candidates printed or a negative value if an error was encountered.
+ */
+LTS_EXTERN int cmdlineflags_complete(int argc, char* const argv[], int cursor);
+
+/**
+ * Writes the candidates completing the word of the command line at the 'cursor' to the file descriptor 'fd'.
+ *
+ * Works exactly as cmdlineflags_complete() does, but writes to the given file descriptor.
+ *
+ * @param[in] fd File descriptor the candidates shall be written to.
+ * @param[in] argc Number of the words of the command line, possibly excluding the one at the cursor (if empty).
+ * @param[in] argv Words of the command line, the first one being the program itself.
+ * @param[in] cursor Index (into argv) of the word being completed.
+ *
+ * @return Number of candidates written or a negative value if an error was encountered.
+ */
+LTS_EXTERN int cmdlineflags_write_completions(int fd, int argc, char* const argv[], int cursor);
+
+/**
+ * Writes the script which hooks the program into completion of the shell.
+ *
+ * On every completion the script runs the program with the words of the command line
+ * (up to the one being completed) and CMDLINEFLAGS_COMPLETE_ENV environment variable set to the index
+ * of the word being completed, and offers whatever the program prints (see cmdlineflags_complete()).
+ * The script is meant to be sourced (bash), put into $fpath as _<program> (zsh)
+ * or into ~/.config/fish/completions/<program>.fish (fish).
+ *
+ * @param[in] fd File descriptor the script shall be written to.
+ * @param[in] shell Shell the script is written for.
+ * @param[in] program Name of the program as typed on the command line (its basename is taken if it is a path).
+ *
+ * @return Number of characters written or a negative value if an error was encountered.
+ */
+LTS_EXTERN int cmdlineflags_write_completion_script(int fd, enum cmdlineflags_shell shell, const char* program);
+
+/**
+ * Retrieves statistics of an option.
+ *
+ * Statistics are collected by all the parsers (including the one of cmdlineflags_parse())
+ * with 'collect_stats' set in their configuration. Short and long option defined together
+ * are separate options here, each one counting its own occurrences. Options registered
+ * with cmdlineflags_register() are not covered.
+ *
+ * @param[in] it Option, e.g. as set by cmdlineflags_next_stats() or as defined by CMDLINEFLAGS_DEFINE()
+ *               (&cmdlineflags_longoptions_<module>_<longoption>[0], the global module being '_').
+ * @param[out] stats Pointer to the object to be filled with the statistics of the option.
+ *
+ * @return 0 on success, negative value otherwise (e.g. when 'it' is not an option).
+ */
+LTS_EXTERN int cmdlineflags_get_stats(const struct cmdlineflags* it, struct cmdlineflags_stats* stats);
+
+/**
+ * Iterates over statistics of all the options.
+ *
+ * Iteration starts with 'it' being NULL and continues with 'it' being the option
+ * the statistics have been retrieved for in the previous step, e.g.
+ *
+ *   struct cmdlineflags_stats stats = {0};
+ *   while (cmdlineflags_next_stats(stats.cmdlineflags, &stats) == 0)
+ *       ...
+ *
+ * @param[in] it Option preceding the one the statistics are to be retrieved for or NULL.
+ * @param[out] stats Pointer to the object to be filled with the statistics of the next option.
+ *
+ * @return 0 on success, negative value when there are no more options.
+ */
+LTS_EXTERN int cmdlineflags_next_stats(const struct cmdlineflags* it, struct cmdlineflags_stats* stats);
+
+/**
+ * Zeroes statistics of all the options.
+ */
+LTS_EXTERN void cmdlineflags_reset_stats(void);
+
+/**
+ * Registers options sections of an image loaded at runtime (e.g. a plugin loaded with dlopen()),
+ * so that its options are parsed and listed by help messages along with all the others.
+ *
+ * The parsers running concurrently are never blocked, each one keeps using the options
+ * it started with. This function however waits for them to finish before it returns.
+ * Thus it shall not be called from within the handlers.
+ *
+ * @param[in] sections Sections of the image, as defined by CMDLINEFLAGS_DEFINE_SECTIONS().
+ *                     They shall stay valid until cmdlineflags_unregister() returns.
+ *
+ * @return 0 on success, negative value otherwise (e.g. when the sections are already registered).
+ */
+LTS_EXTERN int cmdlineflags_register(const struct cmdlineflags_sections* sections);
+
+/**
+ * Unregisters options sections registered with cmdlineflags_register().
+ *
+ * Once this function returns, no parser uses the options (nor calls the handlers) of the sections,
+ * so the image they come from may be unloaded. Shall not be called from within the handlers.
+ *
+ * @param[in] sections Sections of the image, as given to cmdlineflags_register().
+ *
+ * @return 0 on success, negative value otherwise (e.g. when the sections are not registered).
+ */
+LTS_EXTERN int cmdlineflags_unregister(const struct cmdlineflags_sections* sections);
+
+/**
+ * Sets the allocator all the memory of the library is taken from.
+ *
+ * Besides the memory needed by a single parse (e.g. for the options delivered last
+ * or the arguments read from response files), the library keeps some memory for good
+ * (e.g. the lookup index built on the first parse when there is no prebuilt one).
+ * Thus the allocator shall be set before any other function of the library is called
+ * and shall not be changed afterwards (except when the memory is not needed any more,
+ * e.g. in a child process about to call exec()).
+ *
+ * By default the memory comes from malloc(). When the library is built with CMDLINEFLAGS_NO_MALLOC
+ * (cmake option of the same name) there is no default allocator at all, nothing is allocated
+ * from the heap and everything requiring memory fails until an allocator or scratch
+ * (see cmdlineflags_set_scratch()) is given. Prebuilt index keeps that memory small.
+ *
+ * @param[in] allocator Pointer to the allocator (copied) or NULL to restore the default one.
+ *
+ * @return 0 on success, negative value otherwise (e.g. when the 'alloc' is NULL).
+ */
+LTS_EXTERN int cmdlineflags_set_allocator(const struct cmdlineflags_allocator* allocator);
+
+/**
+ * Makes the library take all its memory from the caller provided scratch buffer.
+ *
+ * Sets the allocator (see cmdlineflags_set_allocator()) to a bump allocator over the 'scratch'.
+ * Allocations are stacked, released memory is given back once all the memory allocated
+ * after it is released as well. That covers what a single parse allocates, so a scratch
+ * of bounded size is enough to parse over and over again. When the scratch is used up, allocations fail
+ * (and so do the functions requiring them). The same restrictions apply as to cmdlineflags_set_allocator().
+ *
+ * @param[in] scratch Memory to be allocated from. It shall stay valid for as long as the library is used.
+ * @param[in] size Size of the 'scratch' in bytes.
+ *
+ * @return 0 on success, negative value otherwise (e.g. when the 'scratch' is NULL).
+ */
+LTS_EXTERN int cmdlineflags_set_scratch(void* scratch, size_t size);
+
 /**
  * Retrieves current cmdlineflags configuration.
  *
@@ -0,0 +1,481 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags.hpp
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Header only C++ (C++17 or later) front end of cmdlineflags library.
+ *
+ * Options are declared as constexpr 'lts::cmdlineflags::option' objects, named with std::string_view
+ * literals and either bound to a variable (its type selects the conversion of the argument)
+ * or handled by a callable (e.g. a lambda without captures), and then registered with CMDLINEFLAGS_REGISTER().
+ * The handlers are called directly from the functions generated for each option (there is no std::function
+ * in between) and the options land in the very same sections as the ones defined with the C macros,
+ * so C and C++ translation units may define options of the same program (and of the same modules).
+ *
+ *   static int jobs = 1;
+ *   static bool dry_run = false;
+ *
+ *   constexpr lts::cmdlineflags::option jobs_option{"build", 'j', "jobs", &jobs, "sets number of jobs"};
+ *   constexpr lts::cmdlineflags::option dry_run_option{"build", "dry-run", [] { dry_run = true; }, "does not apply any changes"};
+ *
+ *   CMDLINEFLAGS_REGISTER(jobs_option);
+ *   CMDLINEFLAGS_REGISTER(dry_run_option);
+ *
+ * Options of a module may also be gathered into a table sorted at compile time, which rejects duplicated
+ * names at compile time and looks the options up with a binary search (long options)
+ * or a single array access (short options):
+ *
+ *   constexpr lts::cmdlineflags::table<jobs_option, dry_run_option> build_options;
+ *   static_assert(build_options.find("jobs") != build_options.npos);
+ *
+ * Records of the options registered from C++ have no external names, so they cannot be referred to
+ * by the prebuilt index (see cmdlineflags_generate_index()), programs defining them build the index at runtime.
+ */
+
+#ifndef _CMDLINEFLAGS_HPP_
+#define _CMDLINEFLAGS_HPP_
+
+#if !defined(__cplusplus) || (__cplusplus < 201703L)
+    #error "cmdlineflags.hpp requires C++17 or later"
+#endif
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+// clang-format off
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+#define __CMDLINEFLAGS_REGISTER_HELP(_option_)                                                                 \
+    static const struct cmdlineflags_help cmdlineflags_help_cxx_ ## _option_                                   \
+        __attribute__((__section__(CMDLINEFLAGS_HELP_SECTION_NAME)))                                           \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        ::lts::cmdlineflags::detail::help<_option_>(&cmdlineflags_shortoptions_cxx_ ## _option_,               \
+            &cmdlineflags_longoptions_cxx_ ## _option_)
+#else
+/* Nothing to define, just consumes the semicolon. */
+#define __CMDLINEFLAGS_REGISTER_HELP(_option_)                                                                 \
+    static_assert(true, "")
+#endif
+
+/* Registers the option, i.e. the constexpr 'lts::cmdlineflags::option' object named '_option_' (unqualified).
+   Shall be expanded at namespace scope, once per option. Both records (short and long option) are always
+   defined, the one of the name the option does not have is left empty (and thus skipped by the library). */
+#define CMDLINEFLAGS_REGISTER(_option_)                                                                        \
+    static const struct cmdlineflags cmdlineflags_longoptions_cxx_ ## _option_                                 \
+        __attribute__((__section__(CMDLINEFLAGS_LONGOPTIONS_SECTION_NAME)))                                    \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        ::lts::cmdlineflags::detail::longoption<_option_>(&cmdlineflags_longoptions_cxx_ ## _option_);         \
+    static const struct cmdlineflags cmdlineflags_shortoptions_cxx_ ## _option_                                \
+        __attribute__((__section__(CMDLINEFLAGS_SHORTOPTIONS_SECTION_NAME)))                                   \
+        __attribute__((__used__))                                                                              \
+        __attribute__((aligned(CMDLINEFLAGS_ALIGN))) =                                                         \
+        ::lts::cmdlineflags::detail::shortoption<_option_>(&cmdlineflags_longoptions_cxx_ ## _option_);        \
+    __CMDLINEFLAGS_REGISTER_HELP(_option_)
+// clang-format on
+
+namespace lts::cmdlineflags {
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+/* Name of the global module, to be given as the module of its options. */
+inline constexpr std::string_view global_module = CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE);
+
+/* Binding of an option to the 'uint64_t' variable set to the number of nanoseconds (see CMDLINEFLAGS_DURATION). */
+struct duration {
+    uint64_t* ns;
+};
+
+/* Options are bound to the variables given as 'bool*', 'int*', 'uint64_t*', 'double*', 'const char**'
+   or 'duration' (see CMDLINEFLAGS_BOOL and the like) or handled by callables taking nothing, the argument
+   (std::string_view), the parser (struct cmdlineflags_parser&) or the parser and the argument.
+   Handlers return 0 (or nothing at all) on success and non zero value otherwise.
+   All the names shall be string literals, as the library keeps pointers to them. */
+template <typename Binding>
+struct option {
+    std::string_view module;
+    /* '\0' when the option has the long name only. */
+    char shortoption;
+    /* Empty when the option has the short name only. */
+    std::string_view longoption;
+    Binding binding;
+    std::string_view help;
+
+    constexpr option(std::string_view module, char shortoption, std::string_view longoption, Binding binding, std::string_view help)
+        : module(module), shortoption(shortoption), longoption(longoption), binding(binding), help(help)
+    {
+    }
+
+    constexpr option(std::string_view module, char shortoption, Binding binding, std::string_view help)
+        : option(module, shortoption, std::string_view(), binding, help)
+    {
+    }
+
+    constexpr option(std::string_view module, std::string_view longoption, Binding binding, std::string_view help)
+        : option(module, '\0', longoption, binding, help)
+    {
+    }
+};
+
+/* Option as listed by the table. */
+struct entry {
+    char shortoption;
+    std::string_view longoption;
+    std::string_view help;
+    unsigned flags;
+};
+
+namespace detail {
+
+template <typename>
+inline constexpr bool always_false = false;
+
+template <typename Binding>
+constexpr unsigned flags()
+{
+    if constexpr (std::is_same_v<Binding, bool*>)
+        return CMDLINEFLAGS_BOOL;
+    else if constexpr (std::is_same_v<Binding, int*>)
+        return CMDLINEFLAGS_INT;
+    else if constexpr (std::is_same_v<Binding, uint64_t*>)
+        return CMDLINEFLAGS_UINT64;
+    else if constexpr (std::is_same_v<Binding, double*>)
+        return CMDLINEFLAGS_DOUBLE;
+    else if constexpr (std::is_same_v<Binding, const char**>)
+        return CMDLINEFLAGS_STRING;
+    else if constexpr (std::is_same_v<Binding, duration>)
+        return CMDLINEFLAGS_DURATION;
+    else if constexpr (std::is_invocable_v<const Binding&>)
+        return CMDLINEFLAGS_NO_ARGUMENT;
+    else if constexpr (std::is_invocable_v<const Binding&, std::string_view>)
+        return CMDLINEFLAGS_REQUIRED_ARGUMENT;
+    else if constexpr (std::is_invocable_v<const Binding&, struct cmdlineflags_parser&>)
+        return CMDLINEFLAGS_NO_ARGUMENT_R;
+    else if constexpr (std::is_invocable_v<const Binding&, struct cmdlineflags_parser&, std::string_view>)
+        return CMDLINEFLAGS_REQUIRED_ARGUMENT_R;
+    else
+        static_assert(always_false<Binding>, "option shall be bound to a variable of a supported type or to a handler");
+}
+
+template <const auto& Option>
+constexpr unsigned flags()
+{
+    return flags<decltype(Option.binding)>();
+}
+
+/* The library keeps the pointers to the names, so they shall be null terminated. */
+constexpr bool is_terminated(std::string_view str)
+{
+    return (str.data() != nullptr) && (str.data()[str.size()] == '\0');
+}
+
+constexpr char normalize(char c)
+{
+    return c == '_' ? '-' : c;
+}
+
+/* Orders long options treating '_' and '-' as equal, as the library matches them. */
+constexpr int compare(std::string_view l, std::string_view r)
+{
+    for (std::size_t i = 0; (i < l.size()) && (i < r.size()); ++i)
+        if (normalize(l[i]) != normalize(r[i]))
+            return normalize(l[i]) < normalize(r[i]) ? -1 : 1;
+
+    return l.size() < r.size() ? -1 : (l.size() > r.size() ? 1 : 0);
+}
+
+template <const auto& Option>
+constexpr void check()
+{
+    static_assert(!Option.module.empty() && is_terminated(Option.module), "module shall be a non empty string literal");
+    static_assert((Option.shortoption != '\0') || !Option.longoption.empty(), "option shall have a short or a long name");
+    static_assert((Option.shortoption == '\0') || ((Option.shortoption > ' ') && (Option.shortoption <= '~') && (Option.shortoption != '-')),
+        "short option shall be a printable character other than '-'");
+    static_assert(Option.longoption.empty() || (is_terminated(Option.longoption) && (Option.longoption.find('=') == std::string_view::npos)),
+        "long option shall be a string literal without '='");
+    static_assert(is_terminated(Option.help), "help shall be a string literal");
+}
+
+template <typename F>
+int result(F&& f)
+{
+    if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+        f();
+        return 0;
+    } else {
+        return static_cast<int>(f());
+    }
+}
+
+/* Functions the library calls, one set per option, calling the handler of the option directly. */
+template <const auto& Option>
+struct handler {
+    static int f0(const struct cmdlineflags_option*)
+    {
+        return result([] { return Option.binding(); });
+    }
+
+    static int f1(const struct cmdlineflags_option*, const char* argument)
+    {
+        return result([argument] { return Option.binding(std::string_view(argument)); });
+    }
+
+    static int f2(struct cmdlineflags_parser* parser, const struct cmdlineflags_option*)
+    {
+        return result([parser] { return Option.binding(*parser); });
+    }
+
+    static int f3(struct cmdlineflags_parser* parser, const struct cmdlineflags_option*, const char* argument)
+    {
+        return result([parser, argument] { return Option.binding(*parser, std::string_view(argument)); });
+    }
+};
+
+using handler_union = decltype(::cmdlineflags::u);
+
+template <const auto& Option>
+constexpr handler_union handler_of()
+{
+    constexpr unsigned option_flags = flags<Option>();
+
+    if constexpr (option_flags == CMDLINEFLAGS_NO_ARGUMENT)
+        return __extension__ handler_union{.f0 = handler<Option>::f0};
+    else if constexpr (option_flags == CMDLINEFLAGS_REQUIRED_ARGUMENT)
+        return __extension__ handler_union{.f1 = handler<Option>::f1};
+    else if constexpr (option_flags == CMDLINEFLAGS_NO_ARGUMENT_R)
+        return __extension__ handler_union{.f2 = handler<Option>::f2};
+    else if constexpr (option_flags == CMDLINEFLAGS_REQUIRED_ARGUMENT_R)
+        return __extension__ handler_union{.f3 = handler<Option>::f3};
+    else if constexpr (option_flags == CMDLINEFLAGS_BOOL)
+        return __extension__ handler_union{.f4 = Option.binding};
+    else if constexpr (option_flags == CMDLINEFLAGS_INT)
+        return __extension__ handler_union{.f5 = Option.binding};
+    else if constexpr (option_flags == CMDLINEFLAGS_UINT64)
+        return __extension__ handler_union{.f9 = Option.binding};
+    else if constexpr (option_flags == CMDLINEFLAGS_DOUBLE)
+        return __extension__ handler_union{.f13 = Option.binding};
+    else if constexpr (option_flags == CMDLINEFLAGS_STRING)
+        return __extension__ handler_union{.f17 = Option.binding};
+    else
+        return __extension__ handler_union{.f21 = Option.binding.ns};
+}
+
+template <const auto& Option>
+constexpr ::cmdlineflags longoption([[maybe_unused]] const ::cmdlineflags* self)
+{
+    check<Option>();
+
+    if constexpr (Option.longoption.empty()) {
+        return ::cmdlineflags{};
+    } else {
+        return __extension__ ::cmdlineflags{
+            .module = Option.module.data(),
+            .option = {.type = CMDLINEFLAGS_LONGOPTION, .u = {.longoption = Option.longoption.data()}},
+            .flags = flags<Option>(),
+            .u = handler_of<Option>(),
+#if !defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+            .help = Option.help.data(),
+            /* Long option of a pair is its own sibbling, it is listed along with the short one. */
+            .sibbling = Option.shortoption != '\0' ? self : nullptr,
+#endif
+        };
+    }
+}
+
+template <const auto& Option>
+constexpr ::cmdlineflags shortoption([[maybe_unused]] const ::cmdlineflags* longoption)
+{
+    if constexpr (Option.shortoption == '\0') {
+        return ::cmdlineflags{};
+    } else {
+        return __extension__ ::cmdlineflags{
+            .module = Option.module.data(),
+            .option = {.type = CMDLINEFLAGS_SHORTOPTION, .u = {.shortoption = Option.shortoption}},
+            .flags = flags<Option>(),
+            .u = handler_of<Option>(),
+#if !defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+            .help = Option.help.data(),
+            .sibbling = !Option.longoption.empty() ? longoption : nullptr,
+#endif
+        };
+    }
+}
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+/* The help record of an option pair is attached to its short option. */
+template <const auto& Option>
+constexpr struct cmdlineflags_help help(const ::cmdlineflags* shortoption, const ::cmdlineflags* longoption)
+{
+    if constexpr (Option.shortoption == '\0')
+        return {longoption, nullptr, Option.help.data()};
+    else
+        return {shortoption, !Option.longoption.empty() ? longoption : nullptr, Option.help.data()};
+}
+#endif
+
+template <const auto& Option>
+constexpr entry entry_of()
+{
+    check<Option>();
+
+    return {Option.shortoption, Option.longoption, Option.help, flags<Option>()};
+}
+
+/* Options without the long name come first (ordered by the short name), all the others are ordered by the long name. */
+constexpr bool precedes(const entry& l, const entry& r)
+{
+    int order = compare(l.longoption, r.longoption);
+
+    return (order < 0) || ((order == 0) && (l.shortoption < r.shortoption));
+}
+
+template <std::size_t N>
+constexpr std::array<entry, N> sort(std::array<entry, N> entries)
+{
+    for (std::size_t i = 1; i < N; ++i) {
+        entry e = entries[i];
+        std::size_t j = i;
+
+        for (; (j > 0) && precedes(e, entries[j - 1]); --j)
+            entries[j] = entries[j - 1];
+
+        entries[j] = e;
+    }
+
+    return entries;
+}
+
+template <std::size_t N>
+constexpr bool has_duplicated_longoptions(const std::array<entry, N>& sorted)
+{
+    for (std::size_t i = 1; i < N; ++i)
+        if (!sorted[i].longoption.empty() && (compare(sorted[i - 1].longoption, sorted[i].longoption) == 0))
+            return true;
+
+    return false;
+}
+
+template <std::size_t N>
+constexpr bool has_duplicated_shortoptions(const std::array<entry, N>& entries)
+{
+    for (std::size_t i = 0; i < N; ++i)
+        for (std::size_t j = i + 1; j < N; ++j)
+            if ((entries[i].shortoption != '\0') && (entries[i].shortoption == entries[j].shortoption))
+                return true;
+
+    return false;
+}
+
+/* Position (in the sorted entries) of each short option, indexed by the option (N if there is no such option). */
+template <std::size_t N>
+constexpr std::array<std::size_t, UCHAR_MAX + 1> shortoptions(const std::array<entry, N>& sorted)
+{
+    std::array<std::size_t, UCHAR_MAX + 1> positions{};
+
+    for (std::size_t c = 0; c < positions.size(); ++c)
+        positions[c] = N;
+
+    for (std::size_t i = 0; i < N; ++i)
+        if (sorted[i].shortoption != '\0')
+            positions[static_cast<unsigned char>(sorted[i].shortoption)] = i;
+
+    return positions;
+}
+
+} // namespace detail
+
+/* Options of a single module, sorted at compile time (see precedes()). */
+template <const auto& First, const auto&... Options>
+class table {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    static_assert(((Options.module == First.module) && ...), "options of a table shall belong to the same module");
+
+    constexpr std::string_view module() const
+    {
+        return First.module;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return entries.size();
+    }
+
+    constexpr const entry& operator[](std::size_t position) const
+    {
+        return entries[position];
+    }
+
+    constexpr const entry* begin() const
+    {
+        return entries.data();
+    }
+
+    constexpr const entry* end() const
+    {
+        return entries.data() + entries.size();
+    }
+
+    /* Position of the long option (with '_' and '-' treated as equal) or npos if there is no such option. */
+    constexpr std::size_t find(std::string_view longoption) const
+    {
+        std::size_t first = 0;
+        std::size_t last = entries.size();
+
+        if (longoption.empty())
+            return npos;
+
+        while (first < last) {
+            std::size_t middle = first + (last - first) / 2;
+            int order = detail::compare(entries[middle].longoption, longoption);
+
+            if (order == 0)
+                return middle;
+            else if (order < 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        return npos;
+    }
+
+    /* Position of the short option or npos if there is no such option. */
+    constexpr std::size_t find(char shortoption) const
+    {
+        std::size_t position = shortoptions[static_cast<unsigned char>(shortoption)];
+
+        return (shortoption != '\0') && (position < entries.size()) ? position : npos;
+    }
+
+private:
+    static constexpr std::array<entry, 1 + sizeof...(Options)> entries =
+        detail::sort(std::array<entry, 1 + sizeof...(Options)>{detail::entry_of<First>(), detail::entry_of<Options>()...});
+
+    static_assert(!detail::has_duplicated_longoptions(entries), "long options of a table shall be unique");
+    static_assert(!detail::has_duplicated_shortoptions(entries), "short options of a table shall be unique");
+
+    static constexpr std::array<std::size_t, UCHAR_MAX + 1> shortoptions = detail::shortoptions(entries);
+};
+
+} // namespace lts::cmdlineflags
+
+#endif /* _CMDLINEFLAGS_HPP_ */
@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_index.h
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Layout of the lookup index used by cmdlineflags_parse().
+ *
+ * The library builds this index lazily, on the first call which needs it.
+ * Alternatively it can be generated at build time (see cmdlineflags_generate_index()
+ * cmake function), in which case the generated source file includes this header
+ * and defines 'cmdlineflags_prebuilt_index' object.
+ * Similarly, cmdlineflags_generate_help() cmake function defines 'cmdlineflags_prebuilt_help'
+ * object holding the sorted help message rendered at build time.
+ * This header is not meant to be included by any other code.
+ */
+
+#ifndef _CMDLINEFLAGS_INDEX_H_
+#define _CMDLINEFLAGS_INDEX_H_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stddef.h>
+#include <limits.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* Shall be bumped whenever the layout of 'struct cmdlineflags_index' changes. */
+#define CMDLINEFLAGS_INDEX_VERSION 3
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+/* Records listed by the help message: the options themselves or, in the compact layout, their help records. */
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+typedef struct cmdlineflags_help cmdlineflags_index_entry_t;
+#else
+typedef struct cmdlineflags cmdlineflags_index_entry_t;
+#endif
+
+struct cmdlineflags_index_module {
+    const char* name;
+
+    /* This module's shard of cmdlineflags_index.options: [begin, end). */
+    size_t begin;
+    size_t end;
+
+    /* Short options of this module, directly indexed by the option character (UCHAR_MAX + 1 slots). */
+    const struct cmdlineflags* const* shortoptions;
+
+    /* Id of the module this one is nested in or UINT_MAX for the top level modules. */
+    unsigned parent;
+    /* Name of this module within its parent, i.e. the last level of 'name'. */
+    const char* level;
+};
+
+struct cmdlineflags_index_longoption {
+    const struct cmdlineflags* cmdlineflags;
+    unsigned module;
+};
+
+/* Modules are interned into ids (positions in 'modules') ordered as the help message lists them:
+   the global module first, then all other modules sorted by name. Ancestors of the nested modules
+   are there as well, even if they own no options. */
+struct cmdlineflags_index {
+    unsigned version;
+
+    /* Number of entries (including the library's own empty ones) of the options sections
+       the index was built for. */
+    size_t n_shortoptions_entries;
+    size_t n_longoptions_entries;
+
+    const struct cmdlineflags_index_module* modules;
+    size_t n_modules;
+
+    /* Open addressing hash table mapping module name to module id (UINT_MAX marks an empty slot). */
+    const unsigned* modules_hash;
+    size_t modules_mask;
+
+    /* Entries listed by the help message (long options with a short sibbling are skipped)
+       grouped into contiguous per-module shards. */
+    const cmdlineflags_index_entry_t* const* options;
+    size_t n_options;
+
+    /* Table of long options keyed on (module id, normalized long option).
+       When 'displacements' is NULL this is an open addressing hash table of 'n_longoptions' (power of 2) slots,
+       otherwise it is a minimal perfect hash table of exactly 'n_longoptions' slots
+       with one displacement per each of 'n_buckets' buckets. */
+    const struct cmdlineflags_index_longoption* longoptions;
+    size_t n_longoptions;
+    const unsigned* displacements;
+    size_t n_buckets;
+
+    /* Open addressing hash table mapping (parent id, level) to module id (UINT_MAX marks an empty slot). */
+    const unsigned* children_hash;
+    size_t children_mask;
+
+    /* Names of the ancestors which own no options, NULL unless the index is built at runtime. */
+    char* names;
+};
+
+struct cmdlineflags_index_help {
+    unsigned version;
+
+    /* Same as in 'struct cmdlineflags_index'. */
+    size_t n_shortoptions_entries;
+    size_t n_longoptions_entries;
+
+    /* Sorted help message, null terminated, of 'size' characters (excluding the terminating null byte). */
+    const char* msg;
+    size_t size;
+};
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object declarations
+\*===========================================================================*/
+LTS_EXTERN const struct cmdlineflags_index cmdlineflags_prebuilt_index __attribute__((weak));
+LTS_EXTERN const struct cmdlineflags_index_help cmdlineflags_prebuilt_help __attribute__((weak));
+
+/*===========================================================================*\
+ * function forward declarations (external linkage)
+\*===========================================================================*/
+/* Used by the generator twins (see cmake/cmdlineflags-generator.c) only. They write the source file
+   defining 'cmdlineflags_prebuilt_index' or 'cmdlineflags_prebuilt_help' (and the plain text of the help message
+   to 'text_path' unless it is NULL) for the options of the running executable. */
+LTS_EXTERN int cmdlineflags_generate_index_source(const char* path);
+LTS_EXTERN int cmdlineflags_generate_help_source(const char* path, const char* text_path);
+
+#endif /* _CMDLINEFLAGS_INDEX_H_ */
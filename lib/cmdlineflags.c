@@ -8,30 +8,259 @@
 /*===========================================================================*\
  * system header files
 \*===========================================================================*/
+#if !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE /* environ, RTLD_DEFAULT */
+#endif
+
 #include <stddef.h>
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
 #include <version.h>
 #include <cmdlineflags/cmdlineflags.h>
+#include <cmdlineflags/cmdlineflags_index.h>
 
 /*===========================================================================*\
  * preprocessor #define constants and macros
 \*===========================================================================*/
 // clang-format off
-#define PRINT_ERROR(...)                      \
-    if (cmdlineflags_cfg.emit_debug_messages) \
+#define PRINT_ERROR(parser, ...)                \
+    if ((parser)->cfg.emit_debug_messages)      \
         fprintf(stderr, __VA_ARGS__)
 // clang-format on
 
+#define CMDLINEFLAGS_FNV_OFFSET_BASIS UINT64_C(14695981039346656037)
+#define CMDLINEFLAGS_FNV_PRIME        UINT64_C(1099511628211)
+
+/* Average number of keys per bucket of the minimal perfect hash tables. */
+#define CMDLINEFLAGS_MPH_BUCKET_SIZE 4
+
+/* Help messages are formatted into a chunk of that many bytes and flushed with that many iovecs at most. */
+#define CMDLINEFLAGS_HELP_CHUNK_SIZE 4096
+#define CMDLINEFLAGS_HELP_IOVCNT     128
+
+/* Strings (help texts, module names) at least that long are not copied into the chunk, but referenced. */
+#define CMDLINEFLAGS_HELP_MIN_REFERENCE 32
+
+#define CMDLINEFLAGS_HELP_PREFIX_WIDTH 40
+
+/* Response files may include other response files, that deep at most. */
+#define CMDLINEFLAGS_MAX_RESPONSE_FILE_DEPTH 16
+
+/* Default bound of the number of arguments after the expansion of response files. */
+#define CMDLINEFLAGS_MAX_EXPANDED_ARGS (1U << 20)
+
+/* Environment variables with longer names (after the prefix) are never matched against the options. */
+#define CMDLINEFLAGS_ENV_NAME_MAX 256
+
+/* Longer arguments of CMDLINEFLAGS_DOUBLE options are rejected by the slow path of their conversion
+   when the library is built with CMDLINEFLAGS_NO_MALLOC and the decimal point of the locale is not '.'. */
+#define CMDLINEFLAGS_DOUBLE_MAX_LENGTH 128
+
+/* Allocations from the scratch (and thus the blocks preceding them) are aligned for any object. */
+#define CMDLINEFLAGS_SCRATCH_ALIGN _Alignof(max_align_t)
+
+/* Number of the worker threads calling the handlers of the CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT options. */
+#define CMDLINEFLAGS_POOL_SIZE 4
+
+// clang-format off
+#define CMDLINEFLAGS_HEAP_ALLOCATOR {           \
+    .alloc = cmdlineflags_heap_alloc,           \
+    .realloc = cmdlineflags_heap_realloc,       \
+    .free = cmdlineflags_heap_free,             \
+}
+// clang-format on
+
 /*===========================================================================*\
  * local type definitions
 \*===========================================================================*/
+struct cmdlineflags_module_name {
+    const char* name;
+    unsigned id;
+};
+
+struct cmdlineflags_help_writer {
+    /* Consumes (and empties) the pending 'iov'. */
+    int (*flush)(struct cmdlineflags_help_writer* writer);
+
+    union {
+        int fd;
+        FILE* stream;
+        struct {
+            char* msg;
+            size_t remaining;
+        } buffer;
+    } u;
+
+    /* Number of characters produced so far. */
+    size_t n;
+
+    struct iovec iov[CMDLINEFLAGS_HELP_IOVCNT];
+    int iovcnt;
+
+    char chunk[CMDLINEFLAGS_HELP_CHUNK_SIZE];
+    size_t used;
+};
+
+/* Memory handed out to the caller by the parser, either mapped (length != 0) or allocated (length == 0). */
+struct cmdlineflags_resource {
+    struct cmdlineflags_resource* next;
+    void* addr;
+    size_t length;
+};
+
+/* Occurrence of an option delivered at the end of cmdlineflags_parse_r(). */
+struct cmdlineflags_occurrence {
+    const struct cmdlineflags* cmdlineflags;
+    const char* argument;
+    int argv_index;
+    /* Occurrences are grouped by the option (see cmdlineflags_get_identity()), so an option defined with both short
+       and long names is delivered once, and ordered by 'sequence' within groups. */
+    uintptr_t identity;
+    size_t sequence;
+};
+
+struct cmdlineflags_occurrences {
+    /* Index the options were looked up in. */
+    const struct cmdlineflags_index* index;
+    struct cmdlineflags_occurrence* occurrences;
+    size_t n;
+    size_t capacity;
+};
+
+/* Handler of an option called in parallel (see cmdlineflags_submit()). */
+struct cmdlineflags_job {
+    /* Next job in the queue of the pool. */
+    struct cmdlineflags_job* next;
+    /* Next job of the same parser, in order of the options. */
+    struct cmdlineflags_job* sibling;
+    struct cmdlineflags_jobs* jobs;
+    const struct cmdlineflags* cmdlineflags;
+    const char* argument;
+    int argv_index;
+    bool collect_stats;
+    int status;
+};
+
+/* Jobs of a parser, waited for by cmdlineflags_join(). */
+struct cmdlineflags_jobs {
+    struct cmdlineflags_job* first;
+    struct cmdlineflags_job** last;
+    /* Thread of the parser, the only one whose jobs survive fork() (see cmdlineflags_pool_child()). */
+    pthread_t owner;
+    /* Jobs not done yet, guarded by the mutex of the pool. */
+    size_t n_pending;
+};
+
+/* Worker threads shared by all the parsers, started along with the first job. */
+struct cmdlineflags_pool {
+    pthread_mutex_t mutex;
+    /* Signalled when a job is queued and when a job is done respectively. */
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct cmdlineflags_job* head;
+    struct cmdlineflags_job** tail;
+    /* Jobs taken by the workers and not done yet (linked with 'next' as well). */
+    struct cmdlineflags_job* running;
+    bool started;
+};
+
+/* Arguments being expanded. */
+struct cmdlineflags_args {
+    char** argv;
+    size_t argc;
+    size_t capacity;
+    size_t max_argc;
+};
+
+/* Node of the radix tree of the long options of a module, labelled with a fragment of an option's name. */
+struct cmdlineflags_trie_node {
+    const char* label;
+    size_t n_label;
+    /* Long option ending at this node or NULL. */
+    const struct cmdlineflags* cmdlineflags;
+    /* Number of long options ending at this node or below it. */
+    size_t n_options;
+    /* Children ordered by the first (normalized) character of their labels: nodes[children, children + n_children). */
+    size_t children;
+    size_t n_children;
+};
+
+struct cmdlineflags_trie {
+    struct cmdlineflags_trie_node* nodes;
+    size_t n_nodes;
+    /* Root of the tree of each module (indexed by module id) or SIZE_MAX if the module has no long options. */
+    size_t* roots;
+};
+
+/* Index of the main image's sections followed by the registered ones, published (and retired) as a whole.
+   Only the writers (serialized by cmdlineflags_registry_mutex) create and retire the snapshots. */
+struct cmdlineflags_snapshot {
+    const struct cmdlineflags_index* index;
+    /* index->options with each shard sorted, built on the first request for a sorted help message. */
+    const cmdlineflags_index_entry_t** sorted;
+    /* Radix trees of the long options, built on the first request for an abbreviated long option. */
+    struct cmdlineflags_trie* trie;
+    /* Sections registered at runtime, in order of registration. */
+    const struct cmdlineflags_sections* sections;
+    size_t n_sections;
+};
+
+/* Statistics of an option, updated atomically as parsers may run concurrently. */
+struct cmdlineflags_counters {
+    uint64_t hits;
+    uint64_t handler_ns;
+};
+
+/* Bump allocator over the caller provided memory (see cmdlineflags_set_scratch()). Allocations form a stack,
+   the released ones are given back as soon as all the allocations made after them are released too. */
+struct cmdlineflags_scratch {
+    pthread_mutex_t mutex;
+    char* base;
+    size_t size;
+    /* Offset of the first byte not allocated yet. */
+    size_t used;
+    /* Offset of the block of the last allocation or SIZE_MAX if there is none. */
+    size_t last;
+};
+
+/* Precedes each allocation from the scratch. */
+union cmdlineflags_scratch_block {
+    struct {
+        /* Offset of the block of the previous allocation or SIZE_MAX if there is none. */
+        size_t previous;
+        /* Offset of the first byte past the allocation. */
+        size_t end;
+        bool released;
+    } u;
+    max_align_t align;
+};
+
+struct cmdlineflags_mph_bucket {
+    size_t id;
+    /* Position of the first key of this bucket and the number of keys. */
+    size_t first;
+    size_t size;
+};
 
 /*===========================================================================*\
  * global (external linkage) object definitions
@@ -40,10 +269,98 @@
 /*===========================================================================*\
  * local (internal linkage) function declarations
 \*===========================================================================*/
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void* cmdlineflags_heap_alloc(void* ctx, size_t size);
+static void* cmdlineflags_heap_realloc(void* ctx, void* ptr, size_t old_size, size_t size);
+static void cmdlineflags_heap_free(void* ctx, void* ptr);
+#endif
+static void* cmdlineflags_scratch_alloc(void* ctx, size_t size);
+static void* cmdlineflags_scratch_realloc(void* ctx, void* ptr, size_t old_size, size_t size);
+static void cmdlineflags_scratch_free(void* ctx, void* ptr);
+#if defined(CMDLINEFLAGS_NO_MALLOC)
+static void cmdlineflags_sift_down(char* base, size_t i, size_t n, size_t size, int (*compare)(const void*, const void*));
+#endif
+static void cmdlineflags_sort(void* base, size_t n, size_t size, int (*compare)(const void*, const void*));
+static int cmdlineflags_parse_index(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot);
+static int cmdlineflags_parse_argv(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, int argc, char* const argv[]);
+static const struct cmdlineflags* cmdlineflags_find_shortoption(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* global, char shortoption);
+static const struct cmdlineflags* cmdlineflags_find_longoption(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* global, const char* longoption, size_t n, const struct cmdlineflags_trie_node** ambiguous);
+static const struct cmdlineflags* cmdlineflags_get_abbreviation(struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const char* longoption, size_t n, const struct cmdlineflags_trie_node** ambiguous);
+static void cmdlineflags_print_candidates(const struct cmdlineflags_trie* trie, const struct cmdlineflags_trie_node* node);
+static int cmdlineflags_add_occurrence(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index);
+static int cmdlineflags_compare_occurrences(const void* l, const void* r);
+static int cmdlineflags_compare_groups(const void* l, const void* r);
+static int cmdlineflags_deliver_group(struct cmdlineflags_parser* parser, const struct cmdlineflags_occurrence* group, size_t n, const char** arguments);
+static int cmdlineflags_deliver(struct cmdlineflags_parser* parser, struct cmdlineflags_occurrences* occurrences);
+static int cmdlineflags_submit(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index);
+static void cmdlineflags_run_job(struct cmdlineflags_job* job);
+static struct cmdlineflags_job* cmdlineflags_take_job(struct cmdlineflags_job** link);
+static int cmdlineflags_join(struct cmdlineflags_parser* parser, struct cmdlineflags_jobs* jobs);
+static void cmdlineflags_start_pool(void);
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void* cmdlineflags_worker(void* arg);
+static void cmdlineflags_register_atfork(void);
+static void cmdlineflags_pool_prepare(void);
+static void cmdlineflags_pool_parent(void);
+static void cmdlineflags_pool_child(void);
+#endif
+static void cmdlineflags_alloc_counters(void);
+static int cmdlineflags_parse_uint64(const char* str, uint64_t* value);
+static int cmdlineflags_parse_int(const char* str, int* value);
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void cmdlineflags_new_c_locale(void);
+#endif
+static int cmdlineflags_strtod(const char* str, double* value);
+static int cmdlineflags_parse_double(const char* str, double* value);
+static int cmdlineflags_parse_duration(const char* str, uint64_t* value);
+static int cmdlineflags_next_token(char** cursor, char** token);
+static void cmdlineflags_free_resources(struct cmdlineflags_resource* resources);
+static int cmdlineflags_add_resource(struct cmdlineflags_parser* parser, void* addr, size_t length);
+static int cmdlineflags_push_arg(struct cmdlineflags_args* args, char* arg);
+static int cmdlineflags_map_file(struct cmdlineflags_parser* parser, const char* path, char** text);
+static int cmdlineflags_expand_response_file(struct cmdlineflags_parser* parser, struct cmdlineflags_args* args, const char* path, unsigned depth);
+static int cmdlineflags_expand_arg(struct cmdlineflags_parser* parser, struct cmdlineflags_args* args, char* arg, unsigned depth);
+static int cmdlineflags_expand_args(struct cmdlineflags_parser* parser);
+static const struct cmdlineflags* cmdlineflags_get_env_option(const struct cmdlineflags_index* index, char* name, size_t n);
+static const struct cmdlineflags* cmdlineflags_find_env_option(const struct cmdlineflags_index* index, const char* name, size_t n);
+static int cmdlineflags_parse_environ(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, char* const envp[]);
+static int cmdlineflags_parse_config(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const char* path, char* text);
+static int cmdlineflags_parse_config_file(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const char* path);
 static int cmdlineflags_compare(const struct cmdlineflags* l, const struct cmdlineflags* r);
-static void cmdlinefags_add(const struct cmdlineflags** cmdlineflags, size_t n_options, const struct cmdlineflags* it);
-static int cmdlinefags_build_help_msg(const struct cmdlineflags** cmdlineflags, size_t n_options, char* msg, unsigned size);
-static const struct cmdlineflags** cmdlineflags_combine_options(size_t* n_options, bool sort);
+static int cmdlineflags_compare_entries(const void* l, const void* r);
+static const cmdlineflags_index_entry_t** cmdlineflags_sort_options(const struct cmdlineflags_index* index);
+static int cmdlineflags_compare_longoptions(const void* p1, const void* p2);
+static void cmdlineflags_build_trie_node(struct cmdlineflags_trie* trie, size_t node, const struct cmdlineflags_index_longoption* longoptions, size_t n, size_t depth);
+static struct cmdlineflags_trie* cmdlineflags_build_trie(const struct cmdlineflags_index* index);
+static void cmdlineflags_free_trie(struct cmdlineflags_trie* trie);
+static int cmdlineflags_flush_fd(struct cmdlineflags_help_writer* writer);
+static int cmdlineflags_flush_stream(struct cmdlineflags_help_writer* writer);
+static int cmdlineflags_flush_buffer(struct cmdlineflags_help_writer* writer);
+static int cmdlineflags_writer_flush(struct cmdlineflags_help_writer* writer);
+static int cmdlineflags_writer_copy(struct cmdlineflags_help_writer* writer, const char* str, size_t len, bool underscore2dash);
+static int cmdlineflags_writer_reference(struct cmdlineflags_help_writer* writer, const char* str, size_t len);
+static int cmdlineflags_writer_puts(struct cmdlineflags_help_writer* writer, const char* str);
+static int cmdlineflags_writer_put_module(struct cmdlineflags_help_writer* writer, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module);
+static int cmdlinefags_build_help_msg(struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* first, const struct cmdlineflags_index_module* last, struct cmdlineflags_help_writer* writer, bool sort);
+static int cmdlineflags_write_help_msg(struct cmdlineflags_help_writer* writer, bool sort);
+static bool cmdlineflags_select_module(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, char* const argv[], int cursor, const struct cmdlineflags_index_module** module, bool* has_module);
+static int cmdlineflags_compare_prefix(const char* name, const char* const* prefix, size_t n);
+static int cmdlineflags_complete_modules(const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* parent, const char* word, struct cmdlineflags_help_writer* writer, size_t* n_candidates);
+static int cmdlineflags_complete_shortoptions(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, struct cmdlineflags_help_writer* writer, size_t* n_candidates);
+static int cmdlineflags_complete_longoptions(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const char* longoption, size_t n, struct cmdlineflags_help_writer* writer, size_t* n_candidates);
+static int cmdlineflags_complete_trie_node(const struct cmdlineflags_index* index, const struct cmdlineflags_trie* trie, const struct cmdlineflags_trie_node* node, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* owner, struct cmdlineflags_help_writer* writer, size_t* n_candidates);
+static int cmdlineflags_write_candidates(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, int argc, char* const argv[], int cursor, struct cmdlineflags_help_writer* writer);
+static int cmdlineflags_compare_module_names(const void* l, const void* r);
+static unsigned cmdlineflags_intern_module(struct cmdlineflags_index* index, unsigned* modules_hash, struct cmdlineflags_module_name* names, const char* name);
+static void cmdlineflags_free_index(struct cmdlineflags_index* index);
+static struct cmdlineflags_index* cmdlineflags_build_dynamic_index(const struct cmdlineflags_sections* sections, size_t n_sections);
+static void cmdlineflags_build_index(void);
+static void cmdlineflags_synchronize(void);
+static void cmdlineflags_free_snapshot(struct cmdlineflags_snapshot* snapshot);
+static int cmdlineflags_publish(const struct cmdlineflags_sections* sections, size_t n_sections);
+static int cmdlineflags_write_index(FILE* file, const struct cmdlineflags_index* index);
+static const struct cmdlineflags* cmdlineflags_find_unnamed(const struct cmdlineflags_index* index);
+static int cmdlineflags_write_help_source(FILE* file, const char* msg, size_t size);
 
 /*===========================================================================*\
  * local (internal linkage) object definitions
@@ -58,429 +375,4396 @@ static const struct cmdlineflags cmdlineflags_longoptions_0
     __attribute__((__section__(CMDLINEFLAGS_LONGOPTIONS_SECTION_NAME)))
     __attribute__((__used__))
     __attribute__((aligned(CMDLINEFLAGS_ALIGN))) = {0};
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+static const struct cmdlineflags_help cmdlineflags_help_0
+    __attribute__((__section__(CMDLINEFLAGS_HELP_SECTION_NAME)))
+    __attribute__((__used__))
+    __attribute__((aligned(CMDLINEFLAGS_ALIGN))) = {0};
+#endif
 // clang-format on
 
 static struct cmdlineflags_cfg cmdlineflags_cfg = {
     .emit_debug_messages = 1,
 };
 
-/*===========================================================================*\
- * static inline (internal linkage) function definitions
-\*===========================================================================*/
-static inline int cmdlineflags_longoptionscmp(char const* str1, char const* str2)
-{
-    char c1;
-    char c2;
-    int d;
+/* What cmdlineflags_parse() keeps until cmdlineflags_release(). */
+static struct cmdlineflags_resource* cmdlineflags_resources;
+static int cmdlineflags_argc;
+static char* const* cmdlineflags_argv;
 
-    do {
-        c1 = *str1;
-        if (c1 == '_')
-            c1 = '-';
+/* Used (only) by the slow path of cmdlineflags_parse_double(). */
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static pthread_once_t cmdlineflags_c_locale_once = PTHREAD_ONCE_INIT;
+static locale_t cmdlineflags_c_locale;
+#endif
 
-        c2 = *str2;
-        if (c2 == '_')
-            c2 = '-';
+/* All the memory of the library comes from it, there is none by default without the heap. */
+#if defined(CMDLINEFLAGS_NO_MALLOC)
+static struct cmdlineflags_allocator cmdlineflags_allocator;
+#else
+static struct cmdlineflags_allocator cmdlineflags_allocator = CMDLINEFLAGS_HEAP_ALLOCATOR;
+#endif
+/* Set once the memory was requested while there was no allocator to take it from. */
+static int cmdlineflags_no_allocator_reported;
 
-        d = c1 - c2;
-    } while (d == 0 && *str1++ && *str2++);
+static struct cmdlineflags_scratch cmdlineflags_scratch = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .last = SIZE_MAX,
+};
 
-    return d;
-}
+static const struct cmdlineflags_sections cmdlineflags_main_sections = {
+    .shortoptions_start = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START,
+    .shortoptions_end = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_END,
+    .longoptions_start = &CMDLINEFLAGS_LONGOPTIONS_SECTION_START,
+    .longoptions_end = &CMDLINEFLAGS_LONGOPTIONS_SECTION_END,
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    .help_start = &CMDLINEFLAGS_HELP_SECTION_START,
+    .help_end = &CMDLINEFLAGS_HELP_SECTION_END,
+#endif
+};
+
+/* Snapshot of the main image's sections only (with either prebuilt or dynamic index), built once. */
+static pthread_once_t cmdlineflags_index_once = PTHREAD_ONCE_INIT;
+static struct cmdlineflags_snapshot cmdlineflags_main_snapshot;
+
+/* Snapshot the parsers start with, replaced whenever sections are registered or unregistered.
+   Snapshots are retired (freed) only once all the readers (see cmdlineflags_read_lock()),
+   which might have seen them, are gone. */
+static pthread_mutex_t cmdlineflags_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct cmdlineflags_snapshot* cmdlineflags_snapshot;
+
+/* Readers register themselves with the current epoch, writers wait for the readers of the previous one. */
+static unsigned long cmdlineflags_epoch;
+static unsigned long cmdlineflags_readers[2];
+static __thread unsigned cmdlineflags_read_depth;
+
+/* A writer waiting for the readers sleeps on the condition, which the last reader of the epoch signals.
+   Readers take the mutex only when they are the last ones and a writer is (or might be) waiting. */
+static pthread_mutex_t cmdlineflags_readers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cmdlineflags_readers_gone = PTHREAD_COND_INITIALIZER;
+static unsigned cmdlineflags_writer_waiting;
+
+/* One per each entry of the options sections, allocated when statistics are collected for the first time. */
+static pthread_once_t cmdlineflags_counters_once = PTHREAD_ONCE_INIT;
+static struct cmdlineflags_counters* cmdlineflags_counters;
+
+/* Workers are started (by the first parser needing them) once per process, in the child of fork() too. */
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static pthread_once_t cmdlineflags_atfork_once = PTHREAD_ONCE_INIT;
+#endif
+static struct cmdlineflags_pool cmdlineflags_pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .tail = &cmdlineflags_pool.head,
+};
+
+/* Completion scripts, indexed by 'enum cmdlineflags_shell', with @PROGRAM@ and @FUNCTION@ substituted when written.
+   The program is run with the words up to the one being completed and the index of that word. */
+static const char* const cmdlineflags_completion_scripts[] = {
+    [CMDLINEFLAGS_SHELL_BASH] =
+        "# bash completion of @PROGRAM@, generated by cmdlineflags\n"
+        "@FUNCTION@()\n"
+        "{\n"
+        "    local IFS=$'\\n'\n"
+        "    COMPREPLY=($(" CMDLINEFLAGS_COMPLETE_ENV "=$COMP_CWORD \"${COMP_WORDS[0]}\" \"${COMP_WORDS[@]:1:COMP_CWORD}\" 2>/dev/null))\n"
+        "}\n"
+        "complete -o default -F @FUNCTION@ @PROGRAM@\n",
+    [CMDLINEFLAGS_SHELL_ZSH] =
+        "#compdef @PROGRAM@\n"
+        "# zsh completion of @PROGRAM@, generated by cmdlineflags\n"
+        "@FUNCTION@()\n"
+        "{\n"
+        "    local -a candidates\n"
+        "    candidates=(${(f)\"$(" CMDLINEFLAGS_COMPLETE_ENV "=$((CURRENT - 1)) ${words[1]} \"${(@)words[2,CURRENT]}\" 2>/dev/null)\"})\n"
+        "    compadd -a candidates\n"
+        "}\n"
+        "if [ \"$funcstack[1]\" = \"_@PROGRAM@\" ]; then\n"
+        "    @FUNCTION@ \"$@\"\n"
+        "else\n"
+        "    compdef @FUNCTION@ @PROGRAM@\n"
+        "fi\n",
+    [CMDLINEFLAGS_SHELL_FISH] =
+        "# fish completion of @PROGRAM@, generated by cmdlineflags\n"
+        "function @FUNCTION@\n"
+        "    set -l words (commandline -opc)\n"
+        "    env " CMDLINEFLAGS_COMPLETE_ENV "=(count $words) $words (commandline -ct) 2>/dev/null\n"
+        "end\n"
+        "complete -c @PROGRAM@ -a '(@FUNCTION@)'\n",
+};
 
-static inline char* cmdlineflags_underscore2dash(char* dest, const char* src, size_t n)
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+static inline void* cmdlineflags_malloc(size_t size)
 {
-    if (n != 0) {
-        char c;
-        n--;
-        for (size_t i = 0; (i < n) && (*src != '\0'); ++i) {
-            c = *src++;
-            *dest++ = c != '_' ? c : '-'; /* I shouldn't leave it as it is ;-) */
-        }
-        *dest = '\0';
+    if (cmdlineflags_allocator.alloc == NULL) {
+        /* Possible only without the heap. Reported once, as every caller fails (with no more details) anyway. */
+        if (!__atomic_exchange_n(&cmdlineflags_no_allocator_reported, 1, __ATOMIC_RELAXED))
+            fprintf(stderr, "cmdlineflags: cannot allocate %zu bytes, no allocator is set (see cmdlineflags_set_allocator())\n", size);
+        return NULL;
     }
 
-    return dest;
+    return cmdlineflags_allocator.alloc(cmdlineflags_allocator.ctx, size);
 }
 
-static inline const struct cmdlineflags* cmdlineflags_get_shortoption(const char* module, char shortoption)
+static inline void* cmdlineflags_calloc(size_t n, size_t size)
 {
-    const struct cmdlineflags* const cmdlineflags_start_addr = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START;
-    const struct cmdlineflags* const cmdlineflags_end_addr = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_END;
-    const struct cmdlineflags* it;
+    void* ptr;
 
-    if (module == NULL)
-        module = CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE);
+    if ((size != 0) && (n > SIZE_MAX / size))
+        return NULL;
 
-    for (it = cmdlineflags_start_addr; it < cmdlineflags_end_addr; ++it)
-        if ((it->module != NULL) && (!strcmp(it->module, module)))
-            if (it->option.u.shortoption == shortoption)
-                return it;
+    ptr = cmdlineflags_malloc(n * size);
+    if (ptr != NULL)
+        memset(ptr, 0, n * size);
 
-    return NULL;
+    return ptr;
 }
 
-static inline const struct cmdlineflags* cmdlineflags_get_longoption(const char* module, const char* longoption)
+static inline void cmdlineflags_free(void* ptr)
 {
-    const struct cmdlineflags* const cmdlineflags_start_addr = &CMDLINEFLAGS_LONGOPTIONS_SECTION_START;
-    const struct cmdlineflags* const cmdlineflags_end_addr = &CMDLINEFLAGS_LONGOPTIONS_SECTION_END;
-    const struct cmdlineflags* it;
+    if ((ptr != NULL) && (cmdlineflags_allocator.free != NULL))
+        cmdlineflags_allocator.free(cmdlineflags_allocator.ctx, ptr);
+}
 
-    if (module == NULL)
-        module = CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE);
+/* Resizes the memory of 'old_size' bytes, moving it to a new allocation when it cannot be resized in place. */
+static inline void* cmdlineflags_realloc(void* ptr, size_t old_size, size_t size)
+{
+    void* new_ptr;
 
-    for (it = cmdlineflags_start_addr; it < cmdlineflags_end_addr; ++it)
-        if ((it->module != NULL) && (!strcmp(it->module, module)))
-            if (!cmdlineflags_longoptionscmp(it->option.u.longoption, longoption))
-                return it;
+    if (ptr == NULL)
+        return cmdlineflags_malloc(size);
 
-    return NULL;
+    if (cmdlineflags_allocator.realloc != NULL) {
+        new_ptr = cmdlineflags_allocator.realloc(cmdlineflags_allocator.ctx, ptr, old_size, size);
+        if (new_ptr != NULL)
+            return new_ptr;
+    }
+
+    new_ptr = cmdlineflags_malloc(size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        cmdlineflags_free(ptr);
+    }
+
+    return new_ptr;
 }
 
-static inline bool cmdlineflags_is_nonoption(const char* option)
+static inline void cmdlineflags_swap(char* l, char* r, size_t size)
 {
-    return (option[0] != '-') || (option[1] == '\0');
+    char c;
+
+    for (; size != 0; --size, ++l, ++r) {
+        c = *l;
+        *l = *r;
+        *r = c;
+    }
 }
 
-static inline bool cmdlineflags_is_longoption(const char* option)
+static inline size_t cmdlineflags_scratch_align(size_t offset)
 {
-    return (option[1] == '-');
+    return (offset + CMDLINEFLAGS_SCRATCH_ALIGN - 1) & ~(size_t)(CMDLINEFLAGS_SCRATCH_ALIGN - 1);
 }
 
-/*===========================================================================*\
- * global (external linkage) function definitions
-\*===========================================================================*/
-const char* cmdlineflags_version(void)
+/* Long options are matched treating '_' and '-' as equal. */
+static inline char cmdlineflags_normalize(char c)
 {
-    return PROJECT_VER;
+    return c == '_' ? '-' : c;
 }
 
-int cmdlineflags_parse(int argc, char* const argv[])
+/* Compares null terminated 'str1' with the first 'n' characters of 'str2' treating '_' and '-' as equal. */
+static inline bool cmdlineflags_longoptionsequal(const char* str1, const char* str2, size_t n)
 {
-    int argv_index;
-    const char* module;
+    char c1;
+    char c2;
 
-    if (argc < 1)
-        return CMDLINEFLAGS_FAILURE;
+    for (; n != 0; --n) {
+        c1 = *str1++;
+        if (c1 == '_')
+            c1 = '-';
 
-    module = NULL;
+        c2 = *str2++;
+        if (c2 == '_')
+            c2 = '-';
 
-    /* Start with the ARGV[1] and scan until first non-option argument */
-    for (argv_index = 1; argv_index < argc; argv_index++) {
-        const char* arg = argv[argv_index];
+        if (c1 != c2)
+            return false;
+    }
 
-        if (arg == NULL)
-            return CMDLINEFLAGS_FAILURE;
+    return *str1 == '\0';
+}
 
-        if (!strcmp(arg, "--"))
-            return argv_index + 1; /* The special ARGV-element '--' means end of options */
+static inline uint64_t cmdlineflags_hash_string(uint64_t hash, const char* str)
+{
+    for (; *str != '\0'; ++str)
+        hash = (hash ^ (unsigned char)*str) * CMDLINEFLAGS_FNV_PRIME;
 
-        if (cmdlineflags_is_nonoption(arg)) {
-            if (!module) /* First non-option is treated as a module option */
-                module = arg;
-            else
-                return argv_index;
-        } else {
-            bool is_longoption = cmdlineflags_is_longoption(arg);
-            if (is_longoption) {
-                const char* longoption_start = arg + 2; /* Skip the initial '--' */
-                const char* longoption_end;
-                const char* longoption;
-                const struct cmdlineflags* cmdlineflags;
+    return (hash ^ '\0') * CMDLINEFLAGS_FNV_PRIME;
+}
 
-                for (longoption_end = longoption_start; *longoption_end != '\0' && *longoption_end != '='; longoption_end++)
-                    ;
+static inline uint64_t cmdlineflags_hash_longoption(uint64_t hash, const char* str, size_t n)
+{
+    for (; n != 0; --n, ++str)
+        hash = (hash ^ (unsigned char)(*str != '_' ? *str : '-')) * CMDLINEFLAGS_FNV_PRIME;
 
-                longoption = strndup(longoption_start, longoption_end - longoption_start);
-                if (!longoption)
-                    return CMDLINEFLAGS_FAILURE;
+    return hash;
+}
 
-                cmdlineflags = cmdlineflags_get_longoption(module, longoption);
-                if (cmdlineflags) {
-                    if (cmdlineflags->flags == CMDLINEFLAGS_NO_ARGUMENT) {
-                        if (*longoption_end == '\0') {
-                            if (cmdlineflags->u.f0(&cmdlineflags->option) != 0)
-                                return free((void*)longoption), argv_index + 1;
-                        } else
-                            PRINT_ERROR("%s: option '--%s' doesn't allow an argument\n", argv[0], longoption);
-                    } else {
-                        if (*longoption_end != '\0') {
-                            if (cmdlineflags->u.f1(&cmdlineflags->option, longoption_end + 1) != 0)
-                                return free((void*)longoption), argv_index + 1;
-                        } else if ((argv_index + 1) < argc) {
-                            if (cmdlineflags->u.f1(&cmdlineflags->option, argv[++argv_index]) != 0)
-                                return free((void*)longoption), argv_index + 1;
-                        } else
-                            PRINT_ERROR("%s: option '--%s' requires an argument\n", argv[0], longoption);
-                    }
-                } else {
-                    if (module) {
-                        PRINT_ERROR("%s: unrecognized option '--%s' for '%s' module\n", argv[0], longoption, module);
-                    } else {
-                        PRINT_ERROR("%s: unrecognized option '--%s'\n", argv[0], longoption);
-                    }
-                }
+static inline uint64_t cmdlineflags_hash_key(unsigned module, const char* longoption, size_t n)
+{
+    return cmdlineflags_hash_longoption((CMDLINEFLAGS_FNV_OFFSET_BASIS ^ module) * CMDLINEFLAGS_FNV_PRIME, longoption, n);
+}
 
-                free((void*)longoption);
-            } else {
-                const char* nextchar = arg + 1; /* Skip the initial '-' */
-                const struct cmdlineflags* cmdlineflags;
-                char c;
+static inline uint64_t cmdlineflags_hash_child(unsigned parent, const char* level)
+{
+    return cmdlineflags_hash_string((CMDLINEFLAGS_FNV_OFFSET_BASIS ^ parent) * CMDLINEFLAGS_FNV_PRIME, level);
+}
 
-                while ((c = *nextchar++) != '\0') {
-                    cmdlineflags = cmdlineflags_get_shortoption(module, c);
-                    if (cmdlineflags) {
-                        if (cmdlineflags->flags == CMDLINEFLAGS_NO_ARGUMENT) {
-                            if (cmdlineflags->u.f0(&cmdlineflags->option) != 0)
-                                return argv_index + 1;
-                        } else {
-                            /* This is an option that requires an argument. */
-                            if (*nextchar != '\0') {
-                                if (cmdlineflags->u.f1(&cmdlineflags->option, nextchar) != 0)
-                                    return argv_index + 1;
-                                /* If we end this ARGV-element by taking the rest as an argument,
-                                   we must advance to the next element now. */
-                                break;
-                            } else if ((argv_index + 1) < argc) {
-                                if (cmdlineflags->u.f1(&cmdlineflags->option, argv[++argv_index]) != 0)
-                                    return argv_index + 1;
-                            } else
-                                PRINT_ERROR("%s: option '-%c' requires an argument\n", argv[0], c);
-                        }
-                    } else {
-                        if (module) {
-                            PRINT_ERROR("%s: unrecognized option '-%c' for '%s' module\n", argv[0], c, module);
-                        } else {
-                            PRINT_ERROR("%s: unrecognized option '-%c'\n", argv[0], c);
-                        }
-                    }
-                }
-            }
-        }
-    }
+/* Separator between the name of the parent and the last level of the nested module's name or NULL if the module is not nested. */
+static inline const char* cmdlineflags_get_parent_separator(const char* module)
+{
+    const char* separator = NULL;
+    const char* it;
 
-    return argv_index;
+    if (module[0] == '\0')
+        return NULL;
+
+    for (it = module + 1; (it = strstr(it, CMDLINEFLAGS_MODULE_SEPARATOR)) != NULL; ++it)
+        if ((it[2] != '\0') && (it[2] != '_'))
+            separator = it;
+
+    return separator;
 }
 
-int cmdlineflags_get_help_msg(char* msg, unsigned size, bool sort)
+/* Final mixing step of the splitmix64 generator. */
+static inline uint64_t cmdlineflags_mix(uint64_t hash)
 {
-    int n;
-    size_t n_options;
-    char null_msg_buffer[1];
-    const struct cmdlineflags** cmdlineflags;
+    hash = (hash ^ (hash >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    hash = (hash ^ (hash >> 27)) * UINT64_C(0x94d049bb133111eb);
 
-    if (msg == NULL)
-        msg = null_msg_buffer;
-
-    cmdlineflags = cmdlineflags_combine_options(&n_options, sort);
-    if (cmdlineflags == NULL)
-        return CMDLINEFLAGS_FAILURE;
+    return hash ^ (hash >> 31);
+}
 
-    n = cmdlinefags_build_help_msg(cmdlineflags, n_options, msg, size);
+static inline size_t cmdlineflags_mph_bucket(uint64_t hash, size_t n_buckets)
+{
+    return (hash >> 32) % n_buckets;
+}
 
-    free(cmdlineflags);
+static inline size_t cmdlineflags_mph_slot(uint64_t hash, unsigned displacement, size_t n_slots)
+{
+    return cmdlineflags_mix(hash + displacement) % n_slots;
+}
 
-    return n;
+/* Leaves the epoch, waking up the writer (see cmdlineflags_synchronize()) if that was the last reader of it. */
+static inline void cmdlineflags_read_leave(unsigned long epoch)
+{
+    if ((__atomic_sub_fetch(&cmdlineflags_readers[epoch & 1], 1, __ATOMIC_SEQ_CST) == 0) &&
+        __atomic_load_n(&cmdlineflags_writer_waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&cmdlineflags_readers_mutex);
+        pthread_cond_broadcast(&cmdlineflags_readers_gone);
+        pthread_mutex_unlock(&cmdlineflags_readers_mutex);
+    }
 }
 
-int cmdlineflags_get_cfg(struct cmdlineflags_cfg* cfg)
+/* Never blocks. Returns the epoch to be given to cmdlineflags_read_unlock(). */
+static inline unsigned long cmdlineflags_read_lock(void)
 {
-    int retval = CMDLINEFLAGS_FAILURE;
+    unsigned long epoch;
 
-    do {
-        if (cfg == NULL)
+    /* The epoch may change between the load and the increment, in which case the writer
+       might have missed this reader, so it registers again with the new epoch. */
+    for (;;) {
+        epoch = __atomic_load_n(&cmdlineflags_epoch, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&cmdlineflags_readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&cmdlineflags_epoch, __ATOMIC_SEQ_CST) == epoch)
             break;
+        cmdlineflags_read_leave(epoch);
+    }
 
-        *cfg = cmdlineflags_cfg;
-
-        retval = CMDLINEFLAGS_SUCCESS;
-    } while (0);
+    cmdlineflags_read_depth++;
 
-    return retval;
+    return epoch;
 }
 
-int cmdlineflags_set_cfg(const struct cmdlineflags_cfg* cfg)
+static inline void cmdlineflags_read_unlock(unsigned long epoch)
 {
-    int retval = CMDLINEFLAGS_FAILURE;
+    cmdlineflags_read_depth--;
+    cmdlineflags_read_leave(epoch);
+}
 
-    do {
-        if (cfg == NULL)
-            break;
+/* Shall be called with the read lock held, the snapshot stays valid until it is released. */
+static inline struct cmdlineflags_snapshot* cmdlineflags_get_snapshot(void)
+{
+    struct cmdlineflags_snapshot* snapshot = __atomic_load_n(&cmdlineflags_snapshot, __ATOMIC_ACQUIRE);
 
-        cmdlineflags_cfg = *cfg;
+    if (snapshot != NULL)
+        return snapshot;
 
-        retval = CMDLINEFLAGS_SUCCESS;
-    } while (0);
+    pthread_once(&cmdlineflags_index_once, cmdlineflags_build_index);
 
-    return retval;
+    return __atomic_load_n(&cmdlineflags_snapshot, __ATOMIC_ACQUIRE);
 }
 
-/*===========================================================================*\
- * local (internal linkage) function definitions
-\*===========================================================================*/
-static int cmdlineflags_compare(const struct cmdlineflags* l, const struct cmdlineflags* r)
+static inline const cmdlineflags_index_entry_t* const* cmdlineflags_get_sorted_options(struct cmdlineflags_snapshot* snapshot)
 {
-    int status;
+    const cmdlineflags_index_entry_t** sorted = __atomic_load_n(&snapshot->sorted, __ATOMIC_ACQUIRE);
+    const cmdlineflags_index_entry_t** expected = NULL;
 
-    status = strcmp(l->module, r->module);
-    if (status) {
-        if (!strcmp(l->module, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE)))
-            return -1;
-        else if (!strcmp(r->module, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE)))
-            return +1;
-        else
-            return status;
-    }
+    if (sorted != NULL)
+        return sorted;
 
-    if ((l->option.type == CMDLINEFLAGS_SHORTOPTION) && ((r->option.type == CMDLINEFLAGS_LONGOPTION)))
-        status = l->option.u.shortoption - r->option.u.longoption[0];
-    else if ((l->option.type == CMDLINEFLAGS_LONGOPTION) && ((r->option.type == CMDLINEFLAGS_SHORTOPTION))) {
-        status = l->option.u.longoption[0] - r->option.u.shortoption;
-    } else if ((l->option.type == CMDLINEFLAGS_LONGOPTION) && ((r->option.type == CMDLINEFLAGS_LONGOPTION)))
-        status = strcmp(l->option.u.longoption, r->option.u.longoption);
-    else
-        status = l->option.u.shortoption - r->option.u.shortoption;
+    /* Concurrent readers may sort the options at the same time, only one of them publishes the result. */
+    sorted = cmdlineflags_sort_options(snapshot->index);
+    if ((sorted != NULL) && !__atomic_compare_exchange_n(&snapshot->sorted, &expected, sorted, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        cmdlineflags_free(sorted);
+        sorted = expected;
+    }
 
-    return status;
+    return sorted;
 }
 
-static void cmdlinefags_add(const struct cmdlineflags** cmdlineflags, size_t n_options, const struct cmdlineflags* it)
+static inline const struct cmdlineflags_trie* cmdlineflags_get_trie(struct cmdlineflags_snapshot* snapshot)
 {
-    size_t i;
+    struct cmdlineflags_trie* trie = __atomic_load_n(&snapshot->trie, __ATOMIC_ACQUIRE);
+    struct cmdlineflags_trie* expected = NULL;
 
-    for (i = 0; i < n_options; ++i)
-        if (cmdlineflags_compare(it, cmdlineflags[i]) < 0)
-            break;
+    if (trie != NULL)
+        return trie;
+
+    /* Same as with the sorted options, only one of the concurrent builders publishes its trie. */
+    trie = cmdlineflags_build_trie(snapshot->index);
+    if ((trie != NULL) && !__atomic_compare_exchange_n(&snapshot->trie, &expected, trie, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        cmdlineflags_free_trie(trie);
+        trie = expected;
+    }
 
-    memmove(cmdlineflags + i + 1, cmdlineflags + i, (n_options - i) * sizeof(struct cmdlineflags*));
-    cmdlineflags[i] = it;
+    return trie;
 }
 
-static int cmdlinefags_build_help_msg(const struct cmdlineflags** cmdlineflags, size_t n_options, char* msg, unsigned size)
+/* Node of the module's radix tree of all the long options starting with the first 'n' characters of 'longoption'
+   or NULL if there are none. */
+static inline const struct cmdlineflags_trie_node* cmdlineflags_get_trie_node(const struct cmdlineflags_trie* trie, size_t module, const char* longoption, size_t n)
 {
-    int n;
-    char prefix[128];
-    char longoption[sizeof(prefix)];
-    int status;
-    size_t remaining;
+    const struct cmdlineflags_trie_node* node;
     size_t i;
-    const char* module;
 
-    n = 0;
-    remaining = size;
-    module = NULL;
+    if (trie->roots[module] == SIZE_MAX)
+        return NULL;
 
-    for (i = 0; i < n_options; ++i) {
-        const struct cmdlineflags* it = cmdlineflags[i];
+    node = &trie->nodes[trie->roots[module]];
 
-        if (strcmp(it->module, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE))) {
-            if ((module == NULL) || (strcmp(module, it->module))) {
-                module = it->module;
-                status = snprintf(msg, remaining, "\n%s\n", it->module);
-                if (status < 0)
-                    return CMDLINEFLAGS_FAILURE;
+    for (;;) {
+        for (i = 0; (i < node->n_label) && (n > 0); ++i, ++longoption, --n)
+            if (cmdlineflags_normalize(node->label[i]) != cmdlineflags_normalize(*longoption))
+                return NULL;
 
-                n += status;
-                if (n < size) {
-                    remaining -= status;
-                    msg += status;
-                } else
-                    remaining = 0;
-            }
-        }
+        if (n == 0)
+            return node;
 
-        if (it->option.type == CMDLINEFLAGS_SHORTOPTION) {
-            const struct cmdlineflags* sibbling = it->sibbling;
-            if (sibbling == NULL) {
-                if (it->flags == CMDLINEFLAGS_NO_ARGUMENT)
-                    status = snprintf(prefix, sizeof(prefix), "-%c", it->option.u.shortoption);
-                else
-                    status = snprintf(prefix, sizeof(prefix), "-%c <arg>", it->option.u.shortoption);
+        for (i = 0; i < node->n_children; ++i)
+            if (cmdlineflags_normalize(trie->nodes[node->children + i].label[0]) == cmdlineflags_normalize(*longoption))
+                break;
+
+        if (i == node->n_children)
+            return NULL;
+
+        node = &trie->nodes[node->children + i];
+    }
+}
+
+static inline const struct cmdlineflags_index_module* cmdlineflags_get_module(const struct cmdlineflags_index* index, const char* module)
+{
+    unsigned id;
+    size_t i;
+
+    if (module == NULL)
+        module = CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE);
+
+    for (i = cmdlineflags_hash_string(CMDLINEFLAGS_FNV_OFFSET_BASIS, module) & index->modules_mask;
+         (id = index->modules_hash[i]) != UINT_MAX;
+         i = (i + 1) & index->modules_mask)
+        if (!strcmp(index->modules[id].name, module))
+            return &index->modules[id];
+
+    return NULL;
+}
+
+/* Module nested in the 'parent' (or the top level module if 'parent' is NULL) named 'level' on the command line. */
+static inline const struct cmdlineflags_index_module* cmdlineflags_get_child(const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* parent, const char* level)
+{
+    unsigned parent_id = parent != NULL ? (unsigned)(parent - index->modules) : UINT_MAX;
+    unsigned id;
+    size_t i;
+
+    for (i = cmdlineflags_hash_child(parent_id, level) & index->children_mask;
+         (id = index->children_hash[i]) != UINT_MAX;
+         i = (i + 1) & index->children_mask)
+        if ((index->modules[id].parent == parent_id) && !strcmp(index->modules[id].level, level))
+            return &index->modules[id];
+
+    return NULL;
+}
+
+/* Module the options not found in the 'module' are inherited from: its parent, the global module
+   for the top level modules or NULL for the global module itself. */
+static inline const struct cmdlineflags_index_module* cmdlineflags_get_ancestor(const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* global)
+{
+    if ((module == NULL) || (module == global))
+        return NULL;
+
+    return module->parent != UINT_MAX ? &index->modules[module->parent] : global;
+}
+
+static inline const struct cmdlineflags* cmdlineflags_get_shortoption(const struct cmdlineflags_index_module* module, char shortoption)
+{
+    return module != NULL ? module->shortoptions[(unsigned char)shortoption] : NULL;
+}
+
+static inline const struct cmdlineflags* cmdlineflags_get_longoption(const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, const char* longoption, size_t n)
+{
+    const struct cmdlineflags_index_longoption* slot;
+    uint64_t hash;
+    unsigned id;
+    size_t i;
+
+    if (module == NULL)
+        return NULL;
+
+    id = module - index->modules;
+    hash = cmdlineflags_hash_key(id, longoption, n);
+
+    if (index->displacements != NULL) {
+        slot = &index->longoptions[cmdlineflags_mph_slot(hash, index->displacements[cmdlineflags_mph_bucket(hash, index->n_buckets)], index->n_longoptions)];
+        if ((slot->module == id) && (cmdlineflags_longoptionsequal(slot->cmdlineflags->option.u.longoption, longoption, n)))
+            return slot->cmdlineflags;
+
+        return NULL;
+    }
+
+    for (i = hash & (index->n_longoptions - 1);
+         (slot = &index->longoptions[i])->cmdlineflags != NULL;
+         i = (i + 1) & (index->n_longoptions - 1))
+        if ((slot->module == id) && (cmdlineflags_longoptionsequal(slot->cmdlineflags->option.u.longoption, longoption, n)))
+            return slot->cmdlineflags;
+
+    return NULL;
+}
+
+static inline size_t cmdlineflags_get_n_shortoptions(const struct cmdlineflags_sections* sections)
+{
+    return sections->shortoptions_end - sections->shortoptions_start;
+}
+
+/* Position of the option within the short options section followed by the long options section. */
+static inline size_t cmdlineflags_get_position(const struct cmdlineflags_sections* sections, const struct cmdlineflags* it)
+{
+    if ((it >= sections->shortoptions_start) && (it < sections->shortoptions_end))
+        return it - sections->shortoptions_start;
+
+    return cmdlineflags_get_n_shortoptions(sections) + (it - sections->longoptions_start);
+}
+
+static inline size_t cmdlineflags_get_n_positions(const struct cmdlineflags_sections* sections)
+{
+    return cmdlineflags_get_n_shortoptions(sections) + (sections->longoptions_end - sections->longoptions_start);
+}
+
+/* Reverse of cmdlineflags_get_position(). */
+static inline const struct cmdlineflags* cmdlineflags_get_option(const struct cmdlineflags_sections* sections, size_t position)
+{
+    size_t n_shortoptions = cmdlineflags_get_n_shortoptions(sections);
+
+    if (position < n_shortoptions)
+        return sections->shortoptions_start + position;
+
+    return sections->longoptions_start + (position - n_shortoptions);
+}
+
+/* Whether 'it' points at an option defined within the options sections. */
+static inline bool cmdlineflags_is_option(const struct cmdlineflags_sections* sections, const struct cmdlineflags* it)
+{
+    if ((it >= sections->shortoptions_start) && (it < sections->shortoptions_end))
+        return it->module != NULL;
+
+    if ((it >= sections->longoptions_start) && (it < sections->longoptions_end))
+        return it->module != NULL;
+
+    return false;
+}
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+static inline size_t cmdlineflags_get_n_entries(const struct cmdlineflags_sections* sections)
+{
+    return sections->help_end - sections->help_start;
+}
+
+static inline const struct cmdlineflags_help* cmdlineflags_get_entry(const struct cmdlineflags_sections* sections, size_t position)
+{
+    return sections->help_start + position;
+}
+
+static inline const struct cmdlineflags* cmdlineflags_get_entry_option(const struct cmdlineflags_help* entry)
+{
+    return entry->cmdlineflags;
+}
+
+static inline bool cmdlineflags_is_listed(const struct cmdlineflags_help* entry)
+{
+    return entry->cmdlineflags != NULL;
+}
+#else
+static inline size_t cmdlineflags_get_n_entries(const struct cmdlineflags_sections* sections)
+{
+    return cmdlineflags_get_n_positions(sections);
+}
+
+static inline const struct cmdlineflags* cmdlineflags_get_entry(const struct cmdlineflags_sections* sections, size_t position)
+{
+    return cmdlineflags_get_option(sections, position);
+}
+
+static inline const struct cmdlineflags* cmdlineflags_get_entry_option(const struct cmdlineflags* entry)
+{
+    return entry;
+}
+
+/* Long options with a short sibbling are listed together with it. */
+static inline bool cmdlineflags_is_listed(const struct cmdlineflags* entry)
+{
+    return (entry->module != NULL) && (entry->sibbling != entry);
+}
+#endif
+
+static inline struct cmdlineflags_counters* cmdlineflags_get_counters(void)
+{
+    pthread_once(&cmdlineflags_counters_once, cmdlineflags_alloc_counters);
+    return cmdlineflags_counters;
+}
+
+static inline uint64_t cmdlineflags_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Adds to the statistics of the option 'it', which were started (by cmdlineflags_now()) at 'start'. */
+static inline void cmdlineflags_count(const struct cmdlineflags* it, uint64_t hits, uint64_t start)
+{
+    struct cmdlineflags_counters* counters = cmdlineflags_get_counters();
+    uint64_t handler_ns = cmdlineflags_now() - start;
+
+    /* Options of the registered sections are not counted. */
+    if ((counters != NULL) && cmdlineflags_is_option(&cmdlineflags_main_sections, it)) {
+        counters += cmdlineflags_get_position(&cmdlineflags_main_sections, it);
+        __atomic_fetch_add(&counters->hits, hits, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&counters->handler_ns, handler_ns, __ATOMIC_RELAXED);
+    }
+}
+
+/* Only the first error is kept, the others are just counted. Returns 'argv_index'. */
+static inline int cmdlineflags_set_error(struct cmdlineflags_parser* parser, enum cmdlineflags_error error, int argv_index)
+{
+    if (parser->n_errors++ == 0) {
+        parser->error = error;
+        parser->error_index = argv_index;
+    }
+
+    return argv_index;
+}
+
+/* Same as cmdlineflags_set_error(), but for the errors found out of order of the arguments (e.g. failures
+   of the parallel handlers): the error of the lowest index is kept, whichever was found first. */
+static inline int cmdlineflags_set_earlier_error(struct cmdlineflags_parser* parser, enum cmdlineflags_error error, int argv_index)
+{
+    if ((parser->n_errors++ == 0) || (argv_index < parser->error_index)) {
+        parser->error = error;
+        parser->error_index = argv_index;
+    }
+
+    return argv_index;
+}
+
+/* Identifies the option 'it' by the record it is listed with in the help message, which is the same for the short
+   and the long name of an option: the long sibbling (or the option itself) or, in the compact layout, the help record.
+   The latter is looked up in the whole module, thus once per record (see cmdlineflags_deliver()). */
+static inline uintptr_t cmdlineflags_get_identity(const struct cmdlineflags_index* index, const struct cmdlineflags* it)
+{
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    const struct cmdlineflags_index_module* module = cmdlineflags_get_module(index, it->module);
+    size_t i;
+
+    if (module != NULL)
+        for (i = module->begin; i < module->end; ++i)
+            if ((index->options[i]->cmdlineflags == it) || (index->options[i]->sibbling == it))
+                return (uintptr_t)index->options[i];
+
+    return (uintptr_t)it;
+#else
+    return (uintptr_t)(it->sibbling != NULL ? it->sibbling : it);
+#endif
+}
+
+/* Occurrences of the same option (whichever of its names was given) are delivered together. */
+static inline int cmdlineflags_compare_identities(const struct cmdlineflags_occurrence* l, const struct cmdlineflags_occurrence* r)
+{
+    if (l->identity != r->identity)
+        return l->identity < r->identity ? -1 : 1;
+
+    return 0;
+}
+
+static inline bool cmdlineflags_has_argument(const struct cmdlineflags* it)
+{
+    return (it->flags & CMDLINEFLAGS_REQUIRED_ARGUMENT) != 0;
+}
+
+/* Returns non zero value when the handler fails. Invalid arguments of the options bound to variables
+   are not failures of the handlers, they are recorded (at 'argv_index') right away. */
+static inline int cmdlineflags_call_handler(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index)
+{
+    int status;
+
+    switch (it->flags) {
+        case CMDLINEFLAGS_NO_ARGUMENT:
+            return it->u.f0(&it->option);
+        case CMDLINEFLAGS_REQUIRED_ARGUMENT:
+            return it->u.f1(&it->option, argument);
+        case CMDLINEFLAGS_NO_ARGUMENT_R:
+            return it->u.f2(parser, &it->option);
+        case CMDLINEFLAGS_REQUIRED_ARGUMENT_R:
+            return it->u.f3(parser, &it->option, argument);
+        case CMDLINEFLAGS_BOOL:
+            *it->u.f4 = true;
+            return CMDLINEFLAGS_SUCCESS;
+        case CMDLINEFLAGS_INT:
+            status = cmdlineflags_parse_int(argument, it->u.f5);
+            break;
+        case CMDLINEFLAGS_UINT64:
+            status = cmdlineflags_parse_uint64(argument, it->u.f9);
+            break;
+        case CMDLINEFLAGS_DOUBLE:
+            status = cmdlineflags_parse_double(argument, it->u.f13);
+            break;
+        case CMDLINEFLAGS_STRING:
+            *it->u.f17 = argument;
+            return CMDLINEFLAGS_SUCCESS;
+        case CMDLINEFLAGS_DURATION:
+            status = cmdlineflags_parse_duration(argument, it->u.f21);
+            break;
+        case CMDLINEFLAGS_BATCH_NO_ARGUMENT:
+        case CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT:
+        case CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT:
+        case CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT_R:
+            return cmdlineflags_add_occurrence(parser, it, argument, argv_index);
+        case CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT:
+            if (cmdlineflags_submit(parser, it, argument, argv_index) == CMDLINEFLAGS_SUCCESS)
+                return CMDLINEFLAGS_SUCCESS;
+            return it->u.f19(&it->option, argument); /* Called in place, when it cannot be queued */
+        default:
+            return CMDLINEFLAGS_FAILURE;
+    }
+
+    if (status != CMDLINEFLAGS_SUCCESS) {
+        argument = argument != NULL ? argument : "";
+        cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_INVALID_ARGUMENT, argv_index);
+        if (it->option.type == CMDLINEFLAGS_SHORTOPTION) {
+            PRINT_ERROR(parser, "%s: invalid argument '%s' for option '-%c'\n", parser->argv[0], argument, it->option.u.shortoption);
+        } else {
+            PRINT_ERROR(parser, "%s: invalid argument '%s' for option '--%s'\n", parser->argv[0], argument, it->option.u.longoption);
+        }
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Same as cmdlineflags_call_handler(), but also collects the statistics if asked to. */
+static inline int cmdlineflags_call(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index)
+{
+    uint64_t start;
+    int status;
+
+    if (!parser->cfg.collect_stats)
+        return cmdlineflags_call_handler(parser, it, argument, argv_index);
+
+    start = cmdlineflags_now();
+    status = cmdlineflags_call_handler(parser, it, argument, argv_index);
+    cmdlineflags_count(it, 1, start);
+
+    return status;
+}
+
+static inline char cmdlineflags_tolower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? c - 'A' + 'a' : c;
+}
+
+/* Case insensitive comparison of null terminated 'str1' with null terminated 'str2' which is all lower case. */
+static inline bool cmdlineflags_caseequal(const char* str1, const char* str2)
+{
+    for (; *str2 != '\0'; ++str1, ++str2)
+        if (cmdlineflags_tolower(*str1) != *str2)
+            return false;
+
+    return *str1 == '\0';
+}
+
+/* Case insensitive comparison of null terminated 'str' with the first 'n' characters of 'name' which is all lower case,
+   treating '_' and '-' as equal. */
+static inline bool cmdlineflags_envnameequal(const char* str, const char* name, size_t n)
+{
+    for (; n != 0; --n, ++str, ++name)
+        if ((*str == '\0') || (cmdlineflags_normalize(cmdlineflags_tolower(*str)) != cmdlineflags_normalize(*name)))
+            return false;
+
+    return *str == '\0';
+}
+
+/* Returns 1 for 1, true, yes or on, 0 for an empty string, 0, false, no or off and -1 for anything else. */
+static inline int cmdlineflags_parse_bool(const char* value)
+{
+    if ((value[0] == '\0') || !strcmp(value, "0") || cmdlineflags_caseequal(value, "false") ||
+        cmdlineflags_caseequal(value, "no") || cmdlineflags_caseequal(value, "off"))
+        return 0;
+
+    if (!strcmp(value, "1") || cmdlineflags_caseequal(value, "true") ||
+        cmdlineflags_caseequal(value, "yes") || cmdlineflags_caseequal(value, "on"))
+        return 1;
+
+    return -1;
+}
+
+static inline bool cmdlineflags_is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+static inline bool cmdlineflags_is_nonoption(const char* option)
+{
+    return (option[0] != '-') || (option[1] == '\0');
+}
+
+static inline bool cmdlineflags_is_longoption(const char* option)
+{
+    return (option[1] == '-');
+}
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+const char* cmdlineflags_version(void)
+{
+    return PROJECT_VER;
+}
+
+int cmdlineflags_parse(int argc, char* const argv[])
+{
+    struct cmdlineflags_parser parser;
+    int status;
+
+    cmdlineflags_parser_init(&parser, NULL);
+
+    status = cmdlineflags_parse_r(&parser, argc, argv);
+
+    /* Expanded arguments shall stay valid until cmdlineflags_release(). */
+    cmdlineflags_argc = parser.argc;
+    cmdlineflags_argv = parser.argv;
+
+    if (parser.resources != NULL) {
+        struct cmdlineflags_resource* last = parser.resources;
+
+        while (last->next != NULL)
+            last = last->next;
+
+        last->next = cmdlineflags_resources;
+        cmdlineflags_resources = parser.resources;
+    }
+
+    return status;
+}
+
+int cmdlineflags_get_args(char* const** argv)
+{
+    if (argv != NULL)
+        *argv = cmdlineflags_argv;
+
+    return cmdlineflags_argc;
+}
+
+void cmdlineflags_release(void)
+{
+    cmdlineflags_free_resources(cmdlineflags_resources);
+
+    cmdlineflags_resources = NULL;
+    cmdlineflags_argc = 0;
+    cmdlineflags_argv = NULL;
+}
+
+int cmdlineflags_parser_init(struct cmdlineflags_parser* parser, void* user)
+{
+    if (parser == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    memset(parser, 0, sizeof(*parser));
+    parser->cfg = cmdlineflags_cfg;
+    parser->user = user;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+void cmdlineflags_parser_release(struct cmdlineflags_parser* parser)
+{
+    if (parser != NULL) {
+        cmdlineflags_free_resources(parser->resources);
+
+        parser->resources = NULL;
+        parser->argc = 0;
+        parser->argv = NULL;
+    }
+}
+
+int cmdlineflags_parse_r(struct cmdlineflags_parser* parser, int argc, char* const argv[])
+{
+    struct cmdlineflags_snapshot* snapshot;
+    unsigned long epoch;
+    int status = CMDLINEFLAGS_FAILURE;
+
+    if ((parser == NULL) || (argc < 1))
+        return CMDLINEFLAGS_FAILURE;
+
+    parser->error = CMDLINEFLAGS_ERROR_NONE;
+    parser->error_index = 0;
+    parser->n_errors = 0;
+    parser->argc = argc;
+    parser->argv = argv;
+
+    /* Options (and thus the handlers) stay the same throughout the whole parse,
+       even if some sections are registered or unregistered meanwhile. */
+    epoch = cmdlineflags_read_lock();
+
+    snapshot = cmdlineflags_get_snapshot();
+    if (snapshot != NULL) {
+        status = cmdlineflags_parse_index(parser, snapshot);
+    } else {
+        /* There is no lookup without the index, all the lookups go through it. */
+        cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_NO_MEMORY, 0);
+        PRINT_ERROR(parser, "%s: cannot build the lookup index of the options (out of memory)\n", argv[0]);
+    }
+
+    cmdlineflags_read_unlock(epoch);
+
+    return status;
+}
+
+int cmdlineflags_tokenize_line(char* line, char* argv[], int argv_size)
+{
+    char* token;
+    int status;
+    int argc;
+
+    if ((line == NULL) || (argv == NULL) || (argv_size < 1))
+        return CMDLINEFLAGS_FAILURE;
+
+    for (argc = 0; (status = cmdlineflags_next_token(&line, &token)) > 0; argv[argc++] = token)
+        /* One slot is always left for the terminating NULL. */
+        if (argc + 1 >= argv_size)
+            return CMDLINEFLAGS_FAILURE;
+
+    if (status < 0)
+        return CMDLINEFLAGS_FAILURE;
+
+    argv[argc] = NULL;
+
+    return argc;
+}
+
+int cmdlineflags_parse_line(struct cmdlineflags_parser* parser, char* line, char* argv[], int argv_size)
+{
+    char* default_argv[CMDLINEFLAGS_LINE_MAX_ARGS + 1];
+    int argc;
+    int status;
+
+    if (argv == NULL) {
+        argv = default_argv;
+        argv_size = sizeof(default_argv) / sizeof(default_argv[0]);
+    }
+
+    argc = cmdlineflags_tokenize_line(line, argv, argv_size);
+    if (argc < 1)
+        return CMDLINEFLAGS_FAILURE;
+
+    status = parser != NULL ? cmdlineflags_parse_r(parser, argc, argv) : cmdlineflags_parse(argc, argv);
+
+    /* The internal argv is gone once this function returns, nothing may be left pointing to it. */
+    if ((parser != NULL) && (parser->argv == default_argv)) {
+        parser->argc = 0;
+        parser->argv = NULL;
+    }
+
+    if ((parser == NULL) && (cmdlineflags_argv == default_argv)) {
+        cmdlineflags_argc = 0;
+        cmdlineflags_argv = NULL;
+    }
+
+    return status;
+}
+
+int cmdlineflags_get_help_msg(char* msg, unsigned size, bool sort)
+{
+    struct cmdlineflags_help_writer writer;
+    int n;
+
+    writer.flush = cmdlineflags_flush_buffer;
+    writer.u.buffer.msg = msg;
+    writer.u.buffer.remaining = (msg != NULL) && (size > 0) ? size - 1 : 0;
+
+    n = cmdlineflags_write_help_msg(&writer, sort);
+
+    if ((msg != NULL) && (size > 0))
+        *writer.u.buffer.msg = '\0';
+
+    return n;
+}
+
+int cmdlineflags_get_module_help_msg(const char* module, char* msg, unsigned size, bool sort)
+{
+    struct cmdlineflags_help_writer writer;
+    struct cmdlineflags_snapshot* snapshot;
+    const struct cmdlineflags_index_module* options = NULL;
+    unsigned long epoch;
+    int n = CMDLINEFLAGS_FAILURE;
+
+    epoch = cmdlineflags_read_lock();
+
+    snapshot = cmdlineflags_get_snapshot();
+    if (snapshot != NULL)
+        options = cmdlineflags_get_module(snapshot->index, module);
+
+    if (options != NULL) {
+        writer.flush = cmdlineflags_flush_buffer;
+        writer.u.buffer.msg = msg;
+        writer.u.buffer.remaining = (msg != NULL) && (size > 0) ? size - 1 : 0;
+        writer.n = 0;
+        writer.iovcnt = 0;
+        writer.used = 0;
+
+        n = cmdlinefags_build_help_msg(snapshot, options, options + 1, &writer, sort);
+
+        if ((msg != NULL) && (size > 0))
+            *writer.u.buffer.msg = '\0';
+    }
+
+    cmdlineflags_read_unlock(epoch);
+
+    return n;
+}
+
+int cmdlineflags_write_help(int fd, bool sort)
+{
+    struct cmdlineflags_help_writer writer;
+
+    writer.flush = cmdlineflags_flush_fd;
+    writer.u.fd = fd;
+
+    return cmdlineflags_write_help_msg(&writer, sort);
+}
+
+int cmdlineflags_fwrite_help(FILE* stream, bool sort)
+{
+    struct cmdlineflags_help_writer writer;
+
+    if (stream == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    writer.flush = cmdlineflags_flush_stream;
+    writer.u.stream = stream;
+
+    return cmdlineflags_write_help_msg(&writer, sort);
+}
+
+int cmdlineflags_complete(int argc, char* const argv[], int cursor)
+{
+    return cmdlineflags_write_completions(STDOUT_FILENO, argc, argv, cursor);
+}
+
+int cmdlineflags_write_completions(int fd, int argc, char* const argv[], int cursor)
+{
+    struct cmdlineflags_help_writer writer;
+    struct cmdlineflags_parser parser;
+    struct cmdlineflags_snapshot* snapshot;
+    unsigned long epoch;
+    int n = CMDLINEFLAGS_FAILURE;
+
+    if ((argc < 1) || (argv == NULL) || (cursor < 1) || (cursor > argc))
+        return CMDLINEFLAGS_FAILURE;
+
+    /* Only the configuration of the parser is used. */
+    cmdlineflags_parser_init(&parser, NULL);
+
+    writer.flush = cmdlineflags_flush_fd;
+    writer.u.fd = fd;
+    writer.n = 0;
+    writer.iovcnt = 0;
+    writer.used = 0;
+
+    epoch = cmdlineflags_read_lock();
+
+    snapshot = cmdlineflags_get_snapshot();
+    if (snapshot != NULL)
+        n = cmdlineflags_write_candidates(&parser, snapshot, argc, argv, cursor, &writer);
+
+    cmdlineflags_read_unlock(epoch);
+
+    return n;
+}
+
+int cmdlineflags_write_completion_script(int fd, enum cmdlineflags_shell shell, const char* program)
+{
+    struct cmdlineflags_help_writer writer;
+    const char* script;
+    const char* it;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if ((shell < CMDLINEFLAGS_SHELL_BASH) || (shell > CMDLINEFLAGS_SHELL_FISH) || (program == NULL))
+        return CMDLINEFLAGS_FAILURE;
+
+    if (strrchr(program, '/') != NULL)
+        program = strrchr(program, '/') + 1;
+
+    /* The name is put into the scripts as it is, so it shall not need any quoting. */
+    if ((program[0] == '\0') || (program[strspn(program, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._+-")] != '\0'))
+        return CMDLINEFLAGS_FAILURE;
+
+    writer.flush = cmdlineflags_flush_fd;
+    writer.u.fd = fd;
+    writer.n = 0;
+    writer.iovcnt = 0;
+    writer.used = 0;
+
+    for (script = cmdlineflags_completion_scripts[shell]; (*script != '\0') && (status == CMDLINEFLAGS_SUCCESS);) {
+        if (!strncmp(script, "@PROGRAM@", 9)) {
+            status |= cmdlineflags_writer_copy(&writer, program, strlen(program), false);
+            script += 9;
+        } else if (!strncmp(script, "@FUNCTION@", 10)) {
+            /* Named after the program, with the characters not allowed in the names of the functions replaced. */
+            status |= cmdlineflags_writer_copy(&writer, "_cmdlineflags_", 14, false);
+            for (it = program; *it != '\0'; ++it)
+                status |= cmdlineflags_writer_copy(&writer, strchr("._+-", *it) == NULL ? it : "_", 1, false);
+            script += 10;
+        } else {
+            it = strchr(script + 1, '@');
+            if (it == NULL)
+                it = script + strlen(script);
+            status |= cmdlineflags_writer_copy(&writer, script, it - script, false);
+            script = it;
+        }
+    }
+
+    status |= cmdlineflags_writer_flush(&writer);
+
+    if ((status != CMDLINEFLAGS_SUCCESS) || (writer.n > INT_MAX))
+        return CMDLINEFLAGS_FAILURE;
+
+    return writer.n;
+}
+
+int cmdlineflags_get_stats(const struct cmdlineflags* it, struct cmdlineflags_stats* stats)
+{
+    struct cmdlineflags_counters* counters;
+
+    if ((it == NULL) || (stats == NULL) || !cmdlineflags_is_option(&cmdlineflags_main_sections, it))
+        return CMDLINEFLAGS_FAILURE;
+
+    counters = cmdlineflags_get_counters();
+
+    stats->cmdlineflags = it;
+    stats->hits = 0;
+    stats->handler_ns = 0;
+
+    if (counters != NULL) {
+        counters += cmdlineflags_get_position(&cmdlineflags_main_sections, it);
+        stats->hits = __atomic_load_n(&counters->hits, __ATOMIC_RELAXED);
+        stats->handler_ns = __atomic_load_n(&counters->handler_ns, __ATOMIC_RELAXED);
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+int cmdlineflags_next_stats(const struct cmdlineflags* it, struct cmdlineflags_stats* stats)
+{
+    size_t n_positions = cmdlineflags_get_n_positions(&cmdlineflags_main_sections);
+    size_t position = 0;
+
+    if (it != NULL) {
+        if (!cmdlineflags_is_option(&cmdlineflags_main_sections, it))
+            return CMDLINEFLAGS_FAILURE;
+
+        position = cmdlineflags_get_position(&cmdlineflags_main_sections, it) + 1;
+    }
+
+    /* Skips the library's own empty entries. */
+    for (; position < n_positions; ++position)
+        if (cmdlineflags_is_option(&cmdlineflags_main_sections, cmdlineflags_get_option(&cmdlineflags_main_sections, position)))
+            return cmdlineflags_get_stats(cmdlineflags_get_option(&cmdlineflags_main_sections, position), stats);
+
+    return CMDLINEFLAGS_FAILURE;
+}
+
+void cmdlineflags_reset_stats(void)
+{
+    struct cmdlineflags_counters* counters = cmdlineflags_get_counters();
+    size_t n_positions = cmdlineflags_get_n_positions(&cmdlineflags_main_sections);
+    size_t i;
+
+    if (counters != NULL)
+        for (i = 0; i < n_positions; ++i) {
+            __atomic_store_n(&counters[i].hits, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&counters[i].handler_ns, 0, __ATOMIC_RELAXED);
+        }
+}
+
+int cmdlineflags_register(const struct cmdlineflags_sections* sections)
+{
+    struct cmdlineflags_snapshot* snapshot;
+    struct cmdlineflags_sections* all;
+    int status = CMDLINEFLAGS_FAILURE;
+    size_t i;
+
+    /* Handlers run with the read lock held (or on behalf of a parser holding it), waiting for the readers would never end. */
+    if ((sections == NULL) || (cmdlineflags_read_depth > 0))
+        return CMDLINEFLAGS_FAILURE;
+
+    pthread_mutex_lock(&cmdlineflags_registry_mutex);
+
+    do {
+        snapshot = cmdlineflags_get_snapshot();
+        if (snapshot == NULL)
+            break;
+
+        if (sections->shortoptions_start == cmdlineflags_main_sections.shortoptions_start)
+            break;
+
+        for (i = 0; i < snapshot->n_sections; ++i)
+            if (sections->shortoptions_start == snapshot->sections[i].shortoptions_start)
+                break;
+
+        if (i < snapshot->n_sections)
+            break;
+
+        all = cmdlineflags_malloc((snapshot->n_sections + 1) * sizeof(struct cmdlineflags_sections));
+        if (all == NULL)
+            break;
+
+        memcpy(all, snapshot->sections, snapshot->n_sections * sizeof(struct cmdlineflags_sections));
+        all[snapshot->n_sections] = *sections;
+
+        status = cmdlineflags_publish(all, snapshot->n_sections + 1);
+
+        cmdlineflags_free(all);
+    } while (0);
+
+    pthread_mutex_unlock(&cmdlineflags_registry_mutex);
+
+    return status;
+}
+
+int cmdlineflags_unregister(const struct cmdlineflags_sections* sections)
+{
+    struct cmdlineflags_snapshot* snapshot;
+    struct cmdlineflags_sections* all;
+    int status = CMDLINEFLAGS_FAILURE;
+    size_t i;
+
+    if ((sections == NULL) || (cmdlineflags_read_depth > 0))
+        return CMDLINEFLAGS_FAILURE;
+
+    pthread_mutex_lock(&cmdlineflags_registry_mutex);
+
+    do {
+        snapshot = cmdlineflags_get_snapshot();
+        if (snapshot == NULL)
+            break;
+
+        for (i = 0; i < snapshot->n_sections; ++i)
+            if (sections->shortoptions_start == snapshot->sections[i].shortoptions_start)
+                break;
+
+        if (i == snapshot->n_sections)
+            break;
+
+        all = cmdlineflags_malloc(snapshot->n_sections * sizeof(struct cmdlineflags_sections));
+        if (all == NULL)
+            break;
+
+        memcpy(all, snapshot->sections, i * sizeof(struct cmdlineflags_sections));
+        memcpy(all + i, snapshot->sections + i + 1, (snapshot->n_sections - i - 1) * sizeof(struct cmdlineflags_sections));
+
+        status = cmdlineflags_publish(all, snapshot->n_sections - 1);
+
+        cmdlineflags_free(all);
+    } while (0);
+
+    pthread_mutex_unlock(&cmdlineflags_registry_mutex);
+
+    return status;
+}
+
+int cmdlineflags_set_allocator(const struct cmdlineflags_allocator* allocator)
+{
+#if defined(CMDLINEFLAGS_NO_MALLOC)
+    static const struct cmdlineflags_allocator default_allocator = {0};
+#else
+    static const struct cmdlineflags_allocator default_allocator = CMDLINEFLAGS_HEAP_ALLOCATOR;
+#endif
+    int retval = CMDLINEFLAGS_FAILURE;
+
+    do {
+        if (allocator == NULL)
+            allocator = &default_allocator;
+        else if (allocator->alloc == NULL)
+            break;
+
+        cmdlineflags_allocator = *allocator;
+
+        retval = CMDLINEFLAGS_SUCCESS;
+    } while (0);
+
+    return retval;
+}
+
+int cmdlineflags_set_scratch(void* scratch, size_t size)
+{
+    struct cmdlineflags_allocator allocator = {
+        .alloc = cmdlineflags_scratch_alloc,
+        .realloc = cmdlineflags_scratch_realloc,
+        .free = cmdlineflags_scratch_free,
+        .ctx = &cmdlineflags_scratch,
+    };
+    size_t padding;
+
+    if (scratch == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    padding = cmdlineflags_scratch_align((uintptr_t)scratch) - (uintptr_t)scratch;
+    if (size < padding)
+        return CMDLINEFLAGS_FAILURE;
+
+    pthread_mutex_lock(&cmdlineflags_scratch.mutex);
+    cmdlineflags_scratch.base = (char*)scratch + padding;
+    cmdlineflags_scratch.size = (size - padding) & ~(size_t)(CMDLINEFLAGS_SCRATCH_ALIGN - 1);
+    cmdlineflags_scratch.used = 0;
+    cmdlineflags_scratch.last = SIZE_MAX;
+    pthread_mutex_unlock(&cmdlineflags_scratch.mutex);
+
+    return cmdlineflags_set_allocator(&allocator);
+}
+
+int cmdlineflags_get_cfg(struct cmdlineflags_cfg* cfg)
+{
+    int retval = CMDLINEFLAGS_FAILURE;
+
+    do {
+        if (cfg == NULL)
+            break;
+
+        *cfg = cmdlineflags_cfg;
+
+        retval = CMDLINEFLAGS_SUCCESS;
+    } while (0);
+
+    return retval;
+}
+
+int cmdlineflags_set_cfg(const struct cmdlineflags_cfg* cfg)
+{
+    int retval = CMDLINEFLAGS_FAILURE;
+
+    do {
+        if (cfg == NULL)
+            break;
+
+        cmdlineflags_cfg = *cfg;
+
+        retval = CMDLINEFLAGS_SUCCESS;
+    } while (0);
+
+    return retval;
+}
+
+int cmdlineflags_generate_index_source(const char* path)
+{
+    struct cmdlineflags_index* index;
+    const struct cmdlineflags* unnamed;
+    FILE* file;
+    int status = CMDLINEFLAGS_FAILURE;
+
+    index = cmdlineflags_build_dynamic_index(&cmdlineflags_main_sections, 1);
+    if (index != NULL) {
+        unnamed = cmdlineflags_find_unnamed(index);
+        if (unnamed != NULL) {
+            if (unnamed->option.type == CMDLINEFLAGS_SHORTOPTION)
+                fprintf(stderr, "cmdlineflags: option '-%c' of module '%s'", unnamed->option.u.shortoption, unnamed->module);
+            else
+                fprintf(stderr, "cmdlineflags: option '--%s' of module '%s'", unnamed->option.u.longoption, unnamed->module);
+            fprintf(stderr, " has no symbol to be referred to with (e.g. it is defined in C++), "
+                            "the lookup index will be built at runtime\n");
+        }
+
+        file = fopen(path, "w");
+        if (file != NULL) {
+            if (unnamed != NULL) {
+                /* Leaves the weak 'cmdlineflags_prebuilt_index' undefined. */
+                fprintf(file, "/* Generated by cmdlineflags %s, do not edit. */\n", PROJECT_VER);
+                fprintf(file, "#include <cmdlineflags/cmdlineflags_index.h>\n\n");
+                fprintf(file, "/* No lookup index, not all the options can be referred to. */\n");
+                status = CMDLINEFLAGS_SUCCESS;
+            } else {
+                status = cmdlineflags_write_index(file, index);
+            }
+            if (fclose(file) != 0)
+                status = CMDLINEFLAGS_FAILURE;
+        }
+        cmdlineflags_free_index(index);
+    }
+
+    return status;
+}
+
+int cmdlineflags_generate_help_source(const char* path, const char* text_path)
+{
+    char* msg = NULL;
+    FILE* file;
+    int status = CMDLINEFLAGS_FAILURE;
+    int n;
+
+    do {
+        n = cmdlineflags_get_help_msg(NULL, 0, true);
+        if (n < 0)
+            break;
+
+        msg = cmdlineflags_malloc(n + 1);
+        if (msg == NULL)
+            break;
+
+        if (cmdlineflags_get_help_msg(msg, n + 1, true) != n)
+            break;
+
+        file = fopen(path, "w");
+        if (file == NULL)
+            break;
+
+        status = cmdlineflags_write_help_source(file, msg, n);
+        if (fclose(file) != 0)
+            status = CMDLINEFLAGS_FAILURE;
+
+        if ((status != CMDLINEFLAGS_SUCCESS) || (text_path == NULL))
+            break;
+
+        status = CMDLINEFLAGS_FAILURE;
+
+        file = fopen(text_path, "w");
+        if (file == NULL)
+            break;
+
+        if (fwrite(msg, 1, n, file) == (size_t)n)
+            status = CMDLINEFLAGS_SUCCESS;
+        if (fclose(file) != 0)
+            status = CMDLINEFLAGS_FAILURE;
+    } while (0);
+
+    cmdlineflags_free(msg);
+
+    return status;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void* cmdlineflags_heap_alloc(void* ctx, size_t size)
+{
+    return malloc(size);
+}
+
+static void* cmdlineflags_heap_realloc(void* ctx, void* ptr, size_t old_size, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void cmdlineflags_heap_free(void* ctx, void* ptr)
+{
+    free(ptr);
+}
+#endif
+
+static void* cmdlineflags_scratch_alloc(void* ctx, size_t size)
+{
+    struct cmdlineflags_scratch* scratch = ctx;
+    union cmdlineflags_scratch_block* block = NULL;
+    size_t begin;
+
+    pthread_mutex_lock(&scratch->mutex);
+
+    begin = cmdlineflags_scratch_align(scratch->used);
+    if ((scratch->size - begin >= sizeof(*block)) && (scratch->size - begin - sizeof(*block) >= size)) {
+        block = (union cmdlineflags_scratch_block*)(scratch->base + begin);
+        block->u.previous = scratch->last;
+        block->u.end = begin + sizeof(*block) + size;
+        block->u.released = false;
+
+        scratch->used = block->u.end;
+        scratch->last = begin;
+    }
+
+    pthread_mutex_unlock(&scratch->mutex);
+
+    return block != NULL ? block + 1 : NULL;
+}
+
+/* Only the last allocation may be resized in place. */
+static void* cmdlineflags_scratch_realloc(void* ctx, void* ptr, size_t old_size, size_t size)
+{
+    struct cmdlineflags_scratch* scratch = ctx;
+    union cmdlineflags_scratch_block* block = (union cmdlineflags_scratch_block*)ptr - 1;
+    size_t begin = (char*)block - scratch->base;
+
+    pthread_mutex_lock(&scratch->mutex);
+
+    if ((begin == scratch->last) && (scratch->size - begin - sizeof(*block) >= size)) {
+        block->u.end = begin + sizeof(*block) + size;
+        scratch->used = block->u.end;
+    } else {
+        ptr = NULL;
+    }
+
+    pthread_mutex_unlock(&scratch->mutex);
+
+    return ptr;
+}
+
+static void cmdlineflags_scratch_free(void* ctx, void* ptr)
+{
+    struct cmdlineflags_scratch* scratch = ctx;
+    union cmdlineflags_scratch_block* block = (union cmdlineflags_scratch_block*)ptr - 1;
+
+    pthread_mutex_lock(&scratch->mutex);
+
+    block->u.released = true;
+
+    /* Gives back the last allocation, and the ones released before it which are the last ones now. */
+    while (scratch->last != SIZE_MAX) {
+        block = (union cmdlineflags_scratch_block*)(scratch->base + scratch->last);
+        if (!block->u.released)
+            break;
+
+        scratch->used = scratch->last;
+        scratch->last = block->u.previous;
+    }
+
+    pthread_mutex_unlock(&scratch->mutex);
+}
+
+#if defined(CMDLINEFLAGS_NO_MALLOC)
+static void cmdlineflags_sift_down(char* base, size_t i, size_t n, size_t size, int (*compare)(const void*, const void*))
+{
+    size_t child;
+
+    for (; (child = 2 * i + 1) < n; i = child) {
+        if ((child + 1 < n) && (compare(base + child * size, base + (child + 1) * size) < 0))
+            child++;
+
+        if (compare(base + i * size, base + child * size) >= 0)
+            break;
+
+        cmdlineflags_swap(base + i * size, base + child * size, size);
+    }
+}
+#endif
+
+/* qsort() may allocate, so without the heap it is replaced by the heapsort. */
+static void cmdlineflags_sort(void* base, size_t n, size_t size, int (*compare)(const void*, const void*))
+{
+#if defined(CMDLINEFLAGS_NO_MALLOC)
+    char* elements = base;
+    size_t i;
+
+    for (i = n / 2; i-- > 0;)
+        cmdlineflags_sift_down(elements, i, n, size, compare);
+
+    for (i = n; i-- > 1;) {
+        cmdlineflags_swap(elements, elements + i * size, size);
+        cmdlineflags_sift_down(elements, 0, i, size, compare);
+    }
+#else
+    qsort(base, n, size, compare);
+#endif
+}
+
+static int cmdlineflags_parse_index(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot)
+{
+    const struct cmdlineflags_index* index = snapshot->index;
+    struct cmdlineflags_occurrences occurrences = {.index = index};
+    struct cmdlineflags_jobs jobs = {.last = &jobs.first, .owner = pthread_self()};
+    int status;
+
+    if (parser->cfg.expand_response_files)
+        if (cmdlineflags_expand_args(parser) != CMDLINEFLAGS_SUCCESS)
+            return CMDLINEFLAGS_FAILURE;
+
+    /* Occurrences of the batched and last-wins options gathered from all the sources below. */
+    parser->occurrences = &occurrences;
+    /* Same for the handlers called in parallel. */
+    parser->jobs = &jobs;
+
+    do {
+        /* Configuration file goes first, then the environment, so the command line overrides both. */
+        status = CMDLINEFLAGS_FAILURE;
+
+        if (parser->cfg.config_file != NULL)
+            if (cmdlineflags_parse_config_file(parser, index, parser->cfg.config_file) != CMDLINEFLAGS_SUCCESS)
+                break;
+
+        if ((parser->cfg.env_prefix != NULL) && (parser->cfg.env_prefix[0] != '\0'))
+            if (cmdlineflags_parse_environ(parser, index, environ) != CMDLINEFLAGS_SUCCESS)
+                break;
+
+        status = cmdlineflags_parse_argv(parser, snapshot, parser->argc, parser->argv);
+    } while (0);
+
+    /* Handlers already submitted are waited for whatever happened, the deferred ones are called after them. */
+    if ((cmdlineflags_join(parser, &jobs) != CMDLINEFLAGS_SUCCESS) && (status >= 0))
+        status = CMDLINEFLAGS_FAILURE;
+
+    if ((status >= 0) && (occurrences.n > 0) && (cmdlineflags_deliver(parser, &occurrences) != CMDLINEFLAGS_SUCCESS))
+        status = CMDLINEFLAGS_FAILURE;
+
+    parser->occurrences = NULL;
+    parser->jobs = NULL;
+    cmdlineflags_free(occurrences.occurrences);
+
+    return status;
+}
+
+static int cmdlineflags_parse_argv(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, int argc, char* const argv[])
+{
+    const struct cmdlineflags_index* index = snapshot->index;
+    int argv_index;
+    const char* module;
+    const struct cmdlineflags_index_module* options;
+    const struct cmdlineflags_index_module* global;
+    const struct cmdlineflags_index_module* nested;
+
+    module = NULL;
+    options = global = cmdlineflags_get_module(index, module);
+
+    /* Start with the ARGV[1] and scan until first non-option argument */
+    for (argv_index = 1; argv_index < argc; argv_index++) {
+        const char* arg = argv[argv_index];
+
+        if (arg == NULL)
+            return CMDLINEFLAGS_FAILURE;
+
+        if (!strcmp(arg, "--"))
+            return argv_index + 1; /* The special ARGV-element '--' means end of options */
+
+        if (cmdlineflags_is_nonoption(arg)) {
+            if (!module) { /* First non-option is treated as a module option */
+                module = arg;
+                options = cmdlineflags_get_child(index, NULL, module);
+            } else if (options && (nested = cmdlineflags_get_child(index, options, arg))) {
+                /* and the following ones as long as they name modules nested in it. */
+                module = arg;
+                options = nested;
+            } else
+                return argv_index;
+        } else {
+            bool is_longoption = cmdlineflags_is_longoption(arg);
+            if (is_longoption) {
+                const char* longoption = arg + 2; /* Skip the initial '--' */
+                const char* longoption_end;
+                int n;
+                const struct cmdlineflags* cmdlineflags;
+                const struct cmdlineflags_trie_node* ambiguous = NULL;
+
+                for (longoption_end = longoption; *longoption_end != '\0' && *longoption_end != '='; longoption_end++)
+                    ;
+
+                n = longoption_end - longoption;
+
+                cmdlineflags = cmdlineflags_find_longoption(parser, snapshot, options, global, longoption, n, &ambiguous);
+
+                if (cmdlineflags) {
+                    if (!cmdlineflags_has_argument(cmdlineflags)) {
+                        if (*longoption_end == '\0') {
+                            if (cmdlineflags_call(parser, cmdlineflags, NULL, argv_index) != 0)
+                                return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                        } else {
+                            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT, argv_index);
+                            PRINT_ERROR(parser, "%s: option '--%.*s' doesn't allow an argument\n", argv[0], n, longoption);
+                        }
+                    } else {
+                        if (*longoption_end != '\0') {
+                            if (cmdlineflags_call(parser, cmdlineflags, longoption_end + 1, argv_index) != 0)
+                                return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                        } else if ((argv_index + 1) < argc) {
+                            argv_index++;
+                            if (cmdlineflags_call(parser, cmdlineflags, argv[argv_index], argv_index) != 0)
+                                return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                        } else {
+                            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_MISSING_ARGUMENT, argv_index);
+                            PRINT_ERROR(parser, "%s: option '--%.*s' requires an argument\n", argv[0], n, longoption);
+                        }
+                    }
+                } else if (ambiguous) {
+                    cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION, argv_index);
+                    if (parser->cfg.emit_debug_messages) {
+                        fprintf(stderr, "%s: option '--%.*s' is ambiguous; possibilities:", argv[0], n, longoption);
+                        cmdlineflags_print_candidates(snapshot->trie, ambiguous);
+                        fprintf(stderr, "\n");
+                    }
+                } else {
+                    cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION, argv_index);
+                    if (module) {
+                        PRINT_ERROR(parser, "%s: unrecognized option '--%.*s' for '%s' module\n", argv[0], n, longoption, module);
+                    } else {
+                        PRINT_ERROR(parser, "%s: unrecognized option '--%.*s'\n", argv[0], n, longoption);
+                    }
+                }
+            } else {
+                const char* nextchar = arg + 1; /* Skip the initial '-' */
+                const struct cmdlineflags* cmdlineflags;
+                char c;
+
+                while ((c = *nextchar++) != '\0') {
+                    cmdlineflags = cmdlineflags_find_shortoption(parser, index, options, global, c);
+                    if (cmdlineflags) {
+                        if (!cmdlineflags_has_argument(cmdlineflags)) {
+                            if (cmdlineflags_call(parser, cmdlineflags, NULL, argv_index) != 0)
+                                return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                        } else {
+                            /* This is an option that requires an argument. */
+                            if (*nextchar != '\0') {
+                                if (cmdlineflags_call(parser, cmdlineflags, nextchar, argv_index) != 0)
+                                    return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                                /* If we end this ARGV-element by taking the rest as an argument,
+                                   we must advance to the next element now. */
+                                break;
+                            } else if ((argv_index + 1) < argc) {
+                                argv_index++;
+                                if (cmdlineflags_call(parser, cmdlineflags, argv[argv_index], argv_index) != 0)
+                                    return cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, argv_index), CMDLINEFLAGS_FAILURE;
+                            } else {
+                                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_MISSING_ARGUMENT, argv_index);
+                                PRINT_ERROR(parser, "%s: option '-%c' requires an argument\n", argv[0], c);
+                            }
+                        }
+                    } else {
+                        cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION, argv_index);
+                        if (module) {
+                            PRINT_ERROR(parser, "%s: unrecognized option '-%c' for '%s' module\n", argv[0], c, module);
+                        } else {
+                            PRINT_ERROR(parser, "%s: unrecognized option '-%c'\n", argv[0], c);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return argv_index;
+}
+
+/* Short option of the module or, if the options are inherited, of its nearest ancestor defining it. */
+static const struct cmdlineflags* cmdlineflags_find_shortoption(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* global, char shortoption)
+{
+    const struct cmdlineflags* cmdlineflags = cmdlineflags_get_shortoption(module, shortoption);
+
+    if (parser->cfg.inherit_options)
+        while ((cmdlineflags == NULL) && ((module = cmdlineflags_get_ancestor(index, module, global)) != NULL))
+            cmdlineflags = cmdlineflags_get_shortoption(module, shortoption);
+
+    return cmdlineflags;
+}
+
+/* Long option of the module or, if the options are inherited, of its nearest ancestor defining it.
+   Abbreviations are only looked at when none of them defines the option given in full. */
+static const struct cmdlineflags* cmdlineflags_find_longoption(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* global, const char* longoption, size_t n, const struct cmdlineflags_trie_node** ambiguous)
+{
+    const struct cmdlineflags_index* index = snapshot->index;
+    const struct cmdlineflags_index_module* it;
+    const struct cmdlineflags* cmdlineflags = cmdlineflags_get_longoption(index, module, longoption, n);
+
+    if (parser->cfg.inherit_options)
+        for (it = module; (cmdlineflags == NULL) && ((it = cmdlineflags_get_ancestor(index, it, global)) != NULL);)
+            cmdlineflags = cmdlineflags_get_longoption(index, it, longoption, n);
+
+    if (parser->cfg.allow_abbreviations)
+        for (it = module; (cmdlineflags == NULL) && (*ambiguous == NULL) && (it != NULL);
+             it = parser->cfg.inherit_options ? cmdlineflags_get_ancestor(index, it, global) : NULL)
+            cmdlineflags = cmdlineflags_get_abbreviation(snapshot, it, longoption, n, ambiguous);
+
+    return cmdlineflags;
+}
+
+/* Long option of the module uniquely identified by its first 'n' characters given in 'longoption'.
+   If there are more such options, NULL is returned and 'ambiguous' is set to the node listing all of them. */
+static const struct cmdlineflags* cmdlineflags_get_abbreviation(struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const char* longoption, size_t n, const struct cmdlineflags_trie_node** ambiguous)
+{
+    const struct cmdlineflags_trie* trie;
+    const struct cmdlineflags_trie_node* node;
+
+    if ((module == NULL) || (n == 0))
+        return NULL;
+
+    trie = cmdlineflags_get_trie(snapshot);
+    if (trie == NULL)
+        return NULL;
+
+    node = cmdlineflags_get_trie_node(trie, module - snapshot->index->modules, longoption, n);
+    if (node == NULL)
+        return NULL;
+
+    if (node->n_options > 1) {
+        *ambiguous = node;
+        return NULL;
+    }
+
+    while (node->cmdlineflags == NULL)
+        node = &trie->nodes[node->children];
+
+    return node->cmdlineflags;
+}
+
+static void cmdlineflags_print_candidates(const struct cmdlineflags_trie* trie, const struct cmdlineflags_trie_node* node)
+{
+    size_t i;
+
+    if (node->cmdlineflags != NULL)
+        fprintf(stderr, " '--%s'", node->cmdlineflags->option.u.longoption);
+
+    for (i = 0; i < node->n_children; ++i)
+        cmdlineflags_print_candidates(trie, &trie->nodes[node->children + i]);
+}
+
+static int cmdlineflags_add_occurrence(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index)
+{
+    struct cmdlineflags_occurrences* occurrences = parser->occurrences;
+    struct cmdlineflags_occurrence* occurrence;
+
+    if (occurrences->n == occurrences->capacity) {
+        size_t capacity = occurrences->capacity > 0 ? 2 * occurrences->capacity : 16;
+
+        occurrence = cmdlineflags_realloc(occurrences->occurrences, occurrences->capacity * sizeof(struct cmdlineflags_occurrence),
+            capacity * sizeof(struct cmdlineflags_occurrence));
+        if (occurrence == NULL)
+            return CMDLINEFLAGS_FAILURE;
+
+        occurrences->occurrences = occurrence;
+        occurrences->capacity = capacity;
+    }
+
+    occurrence = &occurrences->occurrences[occurrences->n];
+    occurrence->cmdlineflags = it;
+    occurrence->argument = argument;
+    occurrence->argv_index = argv_index;
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    occurrence->identity = (uintptr_t)it; /* Resolved by cmdlineflags_deliver() */
+#else
+    occurrence->identity = cmdlineflags_get_identity(occurrences->index, it);
+#endif
+    occurrence->sequence = occurrences->n++;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_compare_occurrences(const void* l, const void* r)
+{
+    const struct cmdlineflags_occurrence* lo = l;
+    const struct cmdlineflags_occurrence* ro = r;
+    int status;
+
+    status = cmdlineflags_compare_identities(lo, ro);
+    if (status != 0)
+        return status;
+
+    return lo->sequence < ro->sequence ? -1 : (lo->sequence > ro->sequence ? 1 : 0);
+}
+
+/* Groups (their first occurrences) are ordered by the sequence. */
+static int cmdlineflags_compare_groups(const void* l, const void* r)
+{
+    const struct cmdlineflags_occurrence* lo = *(const struct cmdlineflags_occurrence* const*)l;
+    const struct cmdlineflags_occurrence* ro = *(const struct cmdlineflags_occurrence* const*)r;
+
+    return lo->sequence < ro->sequence ? -1 : (lo->sequence > ro->sequence ? 1 : 0);
+}
+
+static int cmdlineflags_deliver_group(struct cmdlineflags_parser* parser, const struct cmdlineflags_occurrence* group, size_t n, const char** arguments)
+{
+    const struct cmdlineflags* it = group->cmdlineflags;
+    size_t i;
+
+    switch (it->flags) {
+        case CMDLINEFLAGS_BATCH_NO_ARGUMENT:
+            return it->u.f6(&it->option, n);
+        case CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT:
+            for (i = 0; i < n; ++i)
+                arguments[i] = group[i].argument;
+            arguments[n] = NULL;
+            return it->u.f7(&it->option, arguments, n);
+        case CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT:
+            return it->u.f11(&it->option, group[n - 1].argument);
+        case CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT_R:
+            return it->u.f15(parser, &it->option, group[n - 1].argument);
+        default:
+            return CMDLINEFLAGS_FAILURE;
+    }
+}
+
+/* Calls the handler of each option which occurred once, in the order of the first occurrences of the options.
+   Delivery stops at the first failing handler. */
+static int cmdlineflags_deliver(struct cmdlineflags_parser* parser, struct cmdlineflags_occurrences* occurrences)
+{
+    struct cmdlineflags_occurrence* occurrence = occurrences->occurrences;
+    struct cmdlineflags_occurrence** groups;
+    const char** arguments;
+    size_t n_groups;
+    size_t i;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    groups = cmdlineflags_malloc(occurrences->n * sizeof(struct cmdlineflags_occurrence*));
+    arguments = cmdlineflags_malloc((occurrences->n + 1) * sizeof(const char*));
+    if ((groups == NULL) || (arguments == NULL)) {
+        cmdlineflags_free(arguments);
+        cmdlineflags_free(groups);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    /* Occurrences keyed on their records so far, sorted to resolve the identity once per record. */
+    cmdlineflags_sort(occurrence, occurrences->n, sizeof(struct cmdlineflags_occurrence), cmdlineflags_compare_occurrences);
+
+    for (i = 0; i < occurrences->n; ++i)
+        if ((i > 0) && (occurrence[i].cmdlineflags == occurrence[i - 1].cmdlineflags))
+            occurrence[i].identity = occurrence[i - 1].identity;
+        else
+            occurrence[i].identity = cmdlineflags_get_identity(occurrences->index, occurrence[i].cmdlineflags);
+#endif
+
+    cmdlineflags_sort(occurrence, occurrences->n, sizeof(struct cmdlineflags_occurrence), cmdlineflags_compare_occurrences);
+
+    for (n_groups = 0, i = 0; i < occurrences->n; ++i)
+        if ((i == 0) || cmdlineflags_compare_identities(&occurrence[i], &occurrence[i - 1]))
+            groups[n_groups++] = &occurrence[i];
+
+    cmdlineflags_sort(groups, n_groups, sizeof(struct cmdlineflags_occurrence*), cmdlineflags_compare_groups);
+
+    for (i = 0; i < n_groups; ++i) {
+        const struct cmdlineflags_occurrence* group = groups[i];
+        uint64_t start = 0;
+        size_t n;
+        int delivered;
+
+        for (n = 1; (group + n < occurrence + occurrences->n) && !cmdlineflags_compare_identities(&group[n], group); ++n)
+            ;
+
+        if (parser->cfg.collect_stats)
+            start = cmdlineflags_now();
+
+        delivered = cmdlineflags_deliver_group(parser, group, n, arguments);
+
+        /* Occurrences have already been counted, the handler is timed only. */
+        if (parser->cfg.collect_stats)
+            cmdlineflags_count(group->cmdlineflags, 0, start);
+
+        if (delivered != 0) {
+            /* Reported at the last occurrence. */
+            cmdlineflags_set_earlier_error(parser, CMDLINEFLAGS_ERROR_HANDLER, group[n - 1].argv_index);
+            status = CMDLINEFLAGS_FAILURE;
+            break;
+        }
+    }
+
+    cmdlineflags_free(arguments);
+    cmdlineflags_free(groups);
+
+    return status;
+}
+
+/* Queues the handler of the option 'it' for the workers of the pool. Failures of the handler are reported
+   by cmdlineflags_join(), the ones of this function (no memory for the job) by the return value. */
+static int cmdlineflags_submit(struct cmdlineflags_parser* parser, const struct cmdlineflags* it, const char* argument, int argv_index)
+{
+    struct cmdlineflags_jobs* jobs = parser->jobs;
+    struct cmdlineflags_job* job;
+
+    job = cmdlineflags_malloc(sizeof(struct cmdlineflags_job));
+    if (job == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    job->next = NULL;
+    job->sibling = NULL;
+    job->jobs = jobs;
+    job->cmdlineflags = it;
+    job->argument = argument;
+    job->argv_index = argv_index;
+    job->collect_stats = parser->cfg.collect_stats;
+    job->status = CMDLINEFLAGS_SUCCESS;
+
+    *jobs->last = job;
+    jobs->last = &job->sibling;
+
+    pthread_mutex_lock(&cmdlineflags_pool.mutex);
+
+    cmdlineflags_start_pool();
+
+    jobs->n_pending++;
+    *cmdlineflags_pool.tail = job;
+    cmdlineflags_pool.tail = &job->next;
+    pthread_cond_signal(&cmdlineflags_pool.work);
+
+    pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static void cmdlineflags_run_job(struct cmdlineflags_job* job)
+{
+    const struct cmdlineflags* it = job->cmdlineflags;
+    uint64_t start = 0;
+
+    if (job->collect_stats)
+        start = cmdlineflags_now();
+
+    /* On behalf of the parser, which holds the read lock and waits for the job (see cmdlineflags_register()). */
+    cmdlineflags_read_depth++;
+    job->status = it->u.f19(&it->option, job->argument);
+    cmdlineflags_read_depth--;
+
+    /* The occurrence has already been counted, the handler is timed only. */
+    if (job->collect_stats)
+        cmdlineflags_count(it, 0, start);
+}
+
+/* Removes the job '*link' from the queue of the pool, which must be locked. */
+static struct cmdlineflags_job* cmdlineflags_take_job(struct cmdlineflags_job** link)
+{
+    struct cmdlineflags_job* job = *link;
+
+    *link = job->next;
+    if (cmdlineflags_pool.tail == &job->next)
+        cmdlineflags_pool.tail = link;
+
+    return job;
+}
+
+/* Waits for all the jobs of the parser, calling the ones no worker has taken yet by itself,
+   then records the failed ones in order of the options and frees them all. */
+static int cmdlineflags_join(struct cmdlineflags_parser* parser, struct cmdlineflags_jobs* jobs)
+{
+    struct cmdlineflags_job* job;
+    struct cmdlineflags_job** link;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (jobs->first == NULL)
+        return CMDLINEFLAGS_SUCCESS;
+
+    pthread_mutex_lock(&cmdlineflags_pool.mutex);
+
+    while (jobs->n_pending > 0) {
+        for (link = &cmdlineflags_pool.head; (*link != NULL) && ((*link)->jobs != jobs); link = &(*link)->next)
+            ;
+
+        if (*link == NULL) {
+            pthread_cond_wait(&cmdlineflags_pool.done, &cmdlineflags_pool.mutex);
+            continue;
+        }
+
+        job = cmdlineflags_take_job(link);
+
+        pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+        cmdlineflags_run_job(job);
+        pthread_mutex_lock(&cmdlineflags_pool.mutex);
+
+        jobs->n_pending--;
+    }
+
+    pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+
+    while ((job = jobs->first) != NULL) {
+        if (job->status != CMDLINEFLAGS_SUCCESS) {
+            cmdlineflags_set_earlier_error(parser, CMDLINEFLAGS_ERROR_HANDLER, job->argv_index);
+            status = CMDLINEFLAGS_FAILURE;
+        }
+
+        jobs->first = job->sibling;
+        cmdlineflags_free(job);
+    }
+
+    jobs->last = &jobs->first;
+
+    return status;
+}
+
+/* Called with the pool locked. Without the heap, or when the threads cannot be created,
+   there are no (or fewer) workers and the jobs are left to cmdlineflags_join(). */
+static void cmdlineflags_start_pool(void)
+{
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t signals;
+    sigset_t mask;
+    unsigned i;
+
+    if (cmdlineflags_pool.started)
+        return;
+
+    cmdlineflags_pool.started = true;
+
+    pthread_once(&cmdlineflags_atfork_once, cmdlineflags_register_atfork);
+
+    if (pthread_attr_init(&attr) != 0)
+        return;
+
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    /* Signals are left to the threads of the program. */
+    sigfillset(&signals);
+    pthread_sigmask(SIG_SETMASK, &signals, &mask);
+
+    for (i = 0; i < CMDLINEFLAGS_POOL_SIZE; ++i)
+        if (pthread_create(&thread, &attr, cmdlineflags_worker, NULL) != 0)
+            break;
+
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+    pthread_attr_destroy(&attr);
+#endif
+}
+
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void* cmdlineflags_worker(void* arg)
+{
+    struct cmdlineflags_job* job;
+    struct cmdlineflags_job** link;
+
+    pthread_mutex_lock(&cmdlineflags_pool.mutex);
+
+    for (;;) {
+        while (cmdlineflags_pool.head == NULL)
+            pthread_cond_wait(&cmdlineflags_pool.work, &cmdlineflags_pool.mutex);
+
+        job = cmdlineflags_take_job(&cmdlineflags_pool.head);
+        job->next = cmdlineflags_pool.running;
+        cmdlineflags_pool.running = job;
+
+        pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+        cmdlineflags_run_job(job);
+        pthread_mutex_lock(&cmdlineflags_pool.mutex);
+
+        for (link = &cmdlineflags_pool.running; *link != job; link = &(*link)->next)
+            ;
+        *link = job->next;
+
+        /* The job may be freed as soon as the mutex is released. */
+        if (--job->jobs->n_pending == 0)
+            pthread_cond_broadcast(&cmdlineflags_pool.done);
+    }
+
+    return NULL;
+}
+
+static void cmdlineflags_register_atfork(void)
+{
+    pthread_atfork(cmdlineflags_pool_prepare, cmdlineflags_pool_parent, cmdlineflags_pool_child);
+}
+
+static void cmdlineflags_pool_prepare(void)
+{
+    pthread_mutex_lock(&cmdlineflags_pool.mutex);
+}
+
+static void cmdlineflags_pool_parent(void)
+{
+    pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+}
+
+/* Only the thread which called fork() is there in the child, neither the workers nor the other parsers.
+   Its queued jobs are left to cmdlineflags_join() (or to the workers started again), the ones the workers were
+   running never finish here, so they are failed. Jobs of the other parsers are dropped (never joined, nor freed). */
+static void cmdlineflags_pool_child(void)
+{
+    struct cmdlineflags_job** link = &cmdlineflags_pool.head;
+    struct cmdlineflags_job* job;
+    pthread_t self = pthread_self();
+
+    while (*link != NULL) {
+        if (pthread_equal((*link)->jobs->owner, self))
+            link = &(*link)->next;
+        else
+            cmdlineflags_take_job(link);
+    }
+
+    for (job = cmdlineflags_pool.running; job != NULL; job = job->next) {
+        job->status = CMDLINEFLAGS_FAILURE;
+        job->jobs->n_pending--;
+    }
+
+    cmdlineflags_pool.running = NULL;
+    cmdlineflags_pool.started = false;
+
+    /* Still counting the workers of the parent as their waiters, which would take the signals. */
+    pthread_cond_init(&cmdlineflags_pool.work, NULL);
+    pthread_cond_init(&cmdlineflags_pool.done, NULL);
+
+    pthread_mutex_unlock(&cmdlineflags_pool.mutex);
+}
+#endif
+
+static void cmdlineflags_alloc_counters(void)
+{
+    /* Statistics are not collected at all when this fails. */
+    cmdlineflags_counters = cmdlineflags_calloc(cmdlineflags_get_n_positions(&cmdlineflags_main_sections), sizeof(struct cmdlineflags_counters));
+}
+
+/* Decimal or (0x prefixed) hexadecimal number without a sign. */
+static int cmdlineflags_parse_uint64(const char* str, uint64_t* value)
+{
+    uint64_t result = 0;
+    unsigned base = 10;
+    unsigned digit;
+    const char* p = str;
+
+    if ((p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X'))) {
+        base = 16;
+        p += 2;
+    }
+
+    if (*p == '\0')
+        return CMDLINEFLAGS_FAILURE;
+
+    for (; *p != '\0'; ++p) {
+        if ((*p >= '0') && (*p <= '9'))
+            digit = *p - '0';
+        else if ((base == 16) && (*p >= 'a') && (*p <= 'f'))
+            digit = *p - 'a' + 10;
+        else if ((base == 16) && (*p >= 'A') && (*p <= 'F'))
+            digit = *p - 'A' + 10;
+        else
+            return CMDLINEFLAGS_FAILURE;
+
+        if (__builtin_mul_overflow(result, base, &result) || __builtin_add_overflow(result, digit, &result))
+            return CMDLINEFLAGS_FAILURE;
+    }
+
+    *value = result;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_parse_int(const char* str, int* value)
+{
+    bool negative = false;
+    uint64_t magnitude;
+
+    if ((*str == '-') || (*str == '+'))
+        negative = (*str++ == '-');
+
+    if (cmdlineflags_parse_uint64(str, &magnitude) != CMDLINEFLAGS_SUCCESS)
+        return CMDLINEFLAGS_FAILURE;
+
+    if (magnitude > (negative ? (uint64_t)INT_MAX + 1 : (uint64_t)INT_MAX))
+        return CMDLINEFLAGS_FAILURE;
+
+    *value = negative ? (int)(-(int64_t)magnitude) : (int)magnitude;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+#if !defined(CMDLINEFLAGS_NO_MALLOC)
+static void cmdlineflags_new_c_locale(void)
+{
+    cmdlineflags_c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+/* Converts the whole 'str' with strtod() in the "C" locale. */
+static int cmdlineflags_strtod(const char* str, double* value)
+{
+    char* end;
+    double result;
+
+    pthread_once(&cmdlineflags_c_locale_once, cmdlineflags_new_c_locale);
+    if (cmdlineflags_c_locale == (locale_t)0)
+        return CMDLINEFLAGS_FAILURE;
+
+    errno = 0;
+    result = strtod_l(str, &end, cmdlineflags_c_locale);
+    if ((*end != '\0') || ((errno == ERANGE) && isinf(result)))
+        return CMDLINEFLAGS_FAILURE;
+
+    *value = result;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+#else
+/* Converts the whole 'str' with strtod() as if it was in the "C" locale. newlocale() allocates,
+   so the current locale is used instead, with the '.' replaced by its decimal point. */
+static int cmdlineflags_strtod(const char* str, double* value)
+{
+    const char* decimal_point = localeconv()->decimal_point;
+    size_t n_decimal_point = strlen(decimal_point);
+    char buffer[CMDLINEFLAGS_DOUBLE_MAX_LENGTH];
+    size_t n = 0;
+    char* end;
+    double result;
+
+    if (strcmp(decimal_point, ".") != 0) {
+        /* Would be taken for the decimal point, which it is not in the "C" locale. */
+        if ((n_decimal_point == 0) || (strstr(str, decimal_point) != NULL))
+            return CMDLINEFLAGS_FAILURE;
+
+        for (; *str != '\0'; ++str) {
+            if (*str != '.') {
+                if (n + 1 >= sizeof(buffer))
+                    return CMDLINEFLAGS_FAILURE;
+                buffer[n++] = *str;
             } else {
-                cmdlineflags_underscore2dash(longoption, sibbling->option.u.longoption, sizeof(longoption));
-                if (it->flags == CMDLINEFLAGS_NO_ARGUMENT)
-                    status = snprintf(prefix, sizeof(prefix), "-%c, --%s", it->option.u.shortoption, longoption);
-                else
-                    status = snprintf(prefix, sizeof(prefix), "-%c, --%s <arg>", it->option.u.shortoption, longoption);
+                if (n + n_decimal_point >= sizeof(buffer))
+                    return CMDLINEFLAGS_FAILURE;
+                memcpy(buffer + n, decimal_point, n_decimal_point);
+                n += n_decimal_point;
+            }
+        }
+
+        buffer[n] = '\0';
+        str = buffer;
+    }
+
+    errno = 0;
+    result = strtod(str, &end);
+    if ((*end != '\0') || ((errno == ERANGE) && isinf(result)))
+        return CMDLINEFLAGS_FAILURE;
+
+    *value = result;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+#endif
+
+/* Plain decimal numbers of up to 19 significant digits and small exponents are converted exactly
+   (and thus correctly rounded) with a single multiplication or division, everything else
+   (long mantissas, large exponents, hexadecimal floats, infinities, ...) by strtod() in the "C" locale. */
+static int cmdlineflags_parse_double(const char* str, double* value)
+{
+    static const double powers_of_10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* p = str;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    int n_digits = 0;
+    int exponent = 0;
+    bool fast = true;
+    double result;
+
+    if ((*p == '-') || (*p == '+'))
+        negative = (*p++ == '-');
+
+    for (; (*p >= '0') && (*p <= '9'); ++p, ++n_digits) {
+        if (n_digits < 19)
+            mantissa = 10 * mantissa + (*p - '0');
+        else
+            fast = false;
+    }
+
+    if (*p == '.') {
+        for (++p; (*p >= '0') && (*p <= '9'); ++p, ++n_digits, --exponent) {
+            if (n_digits < 19)
+                mantissa = 10 * mantissa + (*p - '0');
+            else
+                fast = false;
+        }
+    }
+
+    if ((n_digits > 0) && ((*p == 'e') || (*p == 'E'))) {
+        bool negative_exponent = false;
+        int e = 0;
+
+        ++p;
+        if ((*p == '-') || (*p == '+'))
+            negative_exponent = (*p++ == '-');
+
+        if ((*p < '0') || (*p > '9'))
+            fast = false;
+
+        for (; (*p >= '0') && (*p <= '9'); ++p)
+            if (e < 10000)
+                e = 10 * e + (*p - '0');
+
+        exponent += negative_exponent ? -e : e;
+    }
+
+    if (fast && (n_digits > 0) && (*p == '\0') && (mantissa <= (UINT64_C(1) << 53)) &&
+        (exponent >= -22) && (exponent <= 22)) {
+        result = (double)mantissa;
+        result = exponent < 0 ? result / powers_of_10[-exponent] : result * powers_of_10[exponent];
+        *value = negative ? -result : result;
+        return CMDLINEFLAGS_SUCCESS;
+    }
+
+    /* strtod() would skip the leading white space. */
+    if ((*str == '\0') || (*str == ' ') || ((*str >= '\t') && (*str <= '\r')))
+        return CMDLINEFLAGS_FAILURE;
+
+    return cmdlineflags_strtod(str, value);
+}
+
+/* Sequence of numbers (optionally with a fraction) followed by ns, us, ms, s, m, h or d units (e.g. 1h30m),
+   or a single number of seconds. */
+static int cmdlineflags_parse_duration(const char* str, uint64_t* value)
+{
+    static const struct {
+        const char* name;
+        uint64_t ns;
+    } units[] = {
+        {"ns", UINT64_C(1)},
+        {"us", UINT64_C(1000)},
+        {"ms", UINT64_C(1000000)},
+        {"s", UINT64_C(1000000000)},
+        {"m", UINT64_C(60000000000)},
+        {"h", UINT64_C(3600000000000)},
+        {"d", UINT64_C(86400000000000)},
+    };
+    const char* p = str;
+    uint64_t result = 0;
+
+    if (*p == '\0')
+        return CMDLINEFLAGS_FAILURE;
+
+    while (*p != '\0') {
+        uint64_t integer = 0;
+        uint64_t fraction = 0;
+        uint64_t scale = 1;
+        uint64_t ns = 0;
+        uint64_t component;
+        const char* digits = p;
+        size_t i;
+        size_t n;
+
+        for (; (*p >= '0') && (*p <= '9'); ++p)
+            if (__builtin_mul_overflow(integer, 10, &integer) || __builtin_add_overflow(integer, *p - '0', &integer))
+                return CMDLINEFLAGS_FAILURE;
+
+        /* Digits of the fraction beyond the ninth one are ignored. */
+        if (*p == '.') {
+            for (++p; (*p >= '0') && (*p <= '9'); ++p) {
+                if (scale < UINT64_C(1000000000)) {
+                    fraction = 10 * fraction + (*p - '0');
+                    scale *= 10;
+                }
+            }
+        }
+
+        if ((p == digits) || ((p - digits == 1) && (*digits == '.')))
+            return CMDLINEFLAGS_FAILURE;
+
+        for (n = 0; (p[n] >= 'a') && (p[n] <= 'z'); ++n)
+            ;
+
+        if (n == 0) {
+            /* Plain number of seconds, but only on its own. */
+            if ((digits != str) || (*p != '\0'))
+                return CMDLINEFLAGS_FAILURE;
+            ns = UINT64_C(1000000000);
+        } else {
+            for (i = 0; i < sizeof(units) / sizeof(units[0]); ++i)
+                if ((strlen(units[i].name) == n) && !strncmp(units[i].name, p, n))
+                    ns = units[i].ns;
+
+            if (ns == 0)
+                return CMDLINEFLAGS_FAILURE;
+
+            p += n;
+        }
+
+        /* 'fraction' < 'scale' <= 10^9, so none of the products of the fractional part may overflow. */
+        if (__builtin_mul_overflow(integer, ns, &component) ||
+            __builtin_add_overflow(component, ns / scale * fraction + ns % scale * fraction / scale, &component) ||
+            __builtin_add_overflow(result, component, &result))
+            return CMDLINEFLAGS_FAILURE;
+    }
+
+    *value = result;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Unquotes and null terminates (in place) the next token of '*cursor' and advances the cursor past it.
+   Returns 1 when a token was found, 0 at the end of the string or a negative value on error. */
+static int cmdlineflags_next_token(char** cursor, char** token)
+{
+    char* src = *cursor;
+    char* dest;
+    char quote;
+
+    while ((*src == ' ') || (*src == '\t') || (*src == '\n') || (*src == '\r'))
+        src++;
+
+    if (*src == '\0') {
+        *cursor = src;
+        return 0;
+    }
+
+    /* 'dest' never overtakes 'src'. */
+    *token = dest = src;
+    quote = '\0';
+
+    for (; *src != '\0'; ++src) {
+        char c = *src;
+
+        if (quote == '\'') {
+            if (c == '\'')
+                quote = '\0';
+            else
+                *dest++ = c;
+        } else if (quote == '"') {
+            if (c == '"')
+                quote = '\0';
+            else if ((c == '\\') && ((src[1] == '"') || (src[1] == '\\') || (src[1] == '$') || (src[1] == '`')))
+                *dest++ = *++src;
+            else
+                *dest++ = c;
+        } else if ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')) {
+            break;
+        } else if ((c == '\'') || (c == '"')) {
+            quote = c;
+        } else if (c == '\\') {
+            if (src[1] == '\0')
+                return CMDLINEFLAGS_FAILURE;
+            *dest++ = *++src;
+        } else
+            *dest++ = c;
+    }
+
+    if (quote != '\0')
+        return CMDLINEFLAGS_FAILURE;
+
+    /* Separator (if any) has already been consumed, so it can be overwritten. */
+    if (*src != '\0')
+        src++;
+    *dest = '\0';
+
+    *cursor = src;
+
+    return 1;
+}
+
+static void cmdlineflags_free_resources(struct cmdlineflags_resource* resources)
+{
+    struct cmdlineflags_resource* next;
+
+    for (; resources != NULL; resources = next) {
+        next = resources->next;
+        if (resources->length != 0)
+            munmap(resources->addr, resources->length);
+        else
+            cmdlineflags_free(resources->addr);
+        cmdlineflags_free(resources);
+    }
+}
+
+static int cmdlineflags_add_resource(struct cmdlineflags_parser* parser, void* addr, size_t length)
+{
+    struct cmdlineflags_resource* resource = cmdlineflags_malloc(sizeof(struct cmdlineflags_resource));
+
+    if (resource == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    resource->next = parser->resources;
+    resource->addr = addr;
+    resource->length = length;
+    parser->resources = resource;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_push_arg(struct cmdlineflags_args* args, char* arg)
+{
+    /* One slot is always left for the terminating NULL. */
+    if (args->argc + 1 >= args->capacity) {
+        size_t capacity = 2 * args->capacity;
+        char** argv;
+
+        if (args->argc + 1 >= args->max_argc)
+            return CMDLINEFLAGS_FAILURE;
+
+        if (capacity > args->max_argc)
+            capacity = args->max_argc;
+
+        argv = cmdlineflags_realloc(args->argv, args->capacity * sizeof(char*), capacity * sizeof(char*));
+        if (argv == NULL)
+            return CMDLINEFLAGS_FAILURE;
+
+        args->argv = argv;
+        args->capacity = capacity;
+    }
+
+    args->argv[args->argc++] = arg;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Maps the file privately (so it can be modified in place) as a null terminated string kept by the parser.
+   Returns 1 when the file cannot be read. */
+static int cmdlineflags_map_file(struct cmdlineflags_parser* parser, const char* path, char** text)
+{
+    static char empty[1];
+    struct stat st;
+    char* addr;
+    size_t length;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 1;
+
+    if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return 1;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        *text = empty;
+        return CMDLINEFLAGS_SUCCESS;
+    }
+
+    /* The file is mapped right in front of a zeroed byte, which terminates
+       the string even if the file ends exactly at a page boundary. */
+    length = st.st_size + 1;
+    addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    if ((mmap(addr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+        (cmdlineflags_add_resource(parser, addr, length) != CMDLINEFLAGS_SUCCESS)) {
+        munmap(addr, length);
+        close(fd);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    close(fd);
+    *text = addr;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Returns 1 when the file cannot be read (so the argument shall be kept as it is). */
+static int cmdlineflags_expand_response_file(struct cmdlineflags_parser* parser, struct cmdlineflags_args* args, const char* path, unsigned depth)
+{
+    char* cursor;
+    char* token;
+    int status;
+
+    if (depth >= CMDLINEFLAGS_MAX_RESPONSE_FILE_DEPTH) {
+        PRINT_ERROR(parser, "response file '%s' nested too deeply\n", path);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    /* Tokens are unquoted and null terminated in place. */
+    status = cmdlineflags_map_file(parser, path, &cursor);
+    if (status != CMDLINEFLAGS_SUCCESS)
+        return status;
+
+    while ((status = cmdlineflags_next_token(&cursor, &token)) > 0)
+        if (cmdlineflags_expand_arg(parser, args, token, depth + 1) != CMDLINEFLAGS_SUCCESS)
+            return CMDLINEFLAGS_FAILURE;
+
+    if (status < 0) {
+        PRINT_ERROR(parser, "response file '%s' is malformed\n", path);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_expand_arg(struct cmdlineflags_parser* parser, struct cmdlineflags_args* args, char* arg, unsigned depth)
+{
+    int status;
+
+    if ((arg[0] == '@') && (arg[1] != '\0')) {
+        status = cmdlineflags_expand_response_file(parser, args, arg + 1, depth);
+        if (status <= 0)
+            return status;
+    }
+
+    if (cmdlineflags_push_arg(args, arg) != CMDLINEFLAGS_SUCCESS) {
+        PRINT_ERROR(parser, "too many arguments (more than %zu)\n", args->max_argc - 1);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Replaces parser's arguments with the ones having all '@file' arguments replaced with the contents of the files. */
+static int cmdlineflags_expand_args(struct cmdlineflags_parser* parser)
+{
+    struct cmdlineflags_args args;
+    int i;
+
+    for (i = 1; i < parser->argc; ++i)
+        if ((parser->argv[i][0] == '@') && (parser->argv[i][1] != '\0'))
+            break;
+
+    if (i == parser->argc)
+        return CMDLINEFLAGS_SUCCESS;
+
+    args.argc = 0;
+    args.capacity = parser->argc + 1;
+    args.max_argc = (parser->cfg.max_expanded_args > 0 ? parser->cfg.max_expanded_args : CMDLINEFLAGS_MAX_EXPANDED_ARGS) + 1;
+    if (args.max_argc > INT_MAX)
+        args.max_argc = INT_MAX;
+    if (args.capacity > args.max_argc)
+        args.capacity = args.max_argc;
+    args.argv = cmdlineflags_malloc(args.capacity * sizeof(char*));
+    if (args.argv == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    /* The command (program) name is never expanded.
+       Even if the expansion fails, whatever has been mapped is released together with the parser. */
+    args.argv[args.argc++] = parser->argv[0];
+
+    for (i = 1; i < parser->argc; ++i) {
+        if (cmdlineflags_expand_arg(parser, &args, parser->argv[i], 0) != CMDLINEFLAGS_SUCCESS) {
+            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_RESPONSE_FILE, i);
+            cmdlineflags_free(args.argv);
+            return CMDLINEFLAGS_FAILURE;
+        }
+    }
+
+    args.argv[args.argc] = NULL;
+
+    if (cmdlineflags_add_resource(parser, args.argv, 0) != CMDLINEFLAGS_SUCCESS) {
+        cmdlineflags_free(args.argv);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    parser->argc = args.argc;
+    parser->argv = args.argv;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Looks the lower cased name of an environment variable (prefix already skipped) up as a long option
+   of the global module first and then as a long option of every module the name may start with
+   ('_' separates module from the option). */
+static const struct cmdlineflags* cmdlineflags_get_env_option(const struct cmdlineflags_index* index, char* name, size_t n)
+{
+    const struct cmdlineflags_index_module* global;
+    const struct cmdlineflags_index_module* module;
+    const struct cmdlineflags* cmdlineflags;
+    size_t i;
+
+    global = cmdlineflags_get_module(index, NULL);
+
+    cmdlineflags = cmdlineflags_get_longoption(index, global, name, n);
+    if (cmdlineflags)
+        return cmdlineflags;
+
+    for (i = 1; i + 1 < n; ++i) {
+        if (name[i] != '_')
+            continue;
+
+        name[i] = '\0';
+        module = cmdlineflags_get_module(index, name);
+        name[i] = '_';
+
+        if ((module != NULL) && (module != global)) {
+            cmdlineflags = cmdlineflags_get_longoption(index, module, name + i + 1, n - i - 1);
+            if (cmdlineflags)
+                return cmdlineflags;
+        }
+    }
+
+    return cmdlineflags_find_env_option(index, name, n);
+}
+
+/* Same as above for the modules and options with upper case letters in their names, which are not hashed
+   as the lower cased name: compares it with every long option, which costs O(options) per unknown variable. */
+static const struct cmdlineflags* cmdlineflags_find_env_option(const struct cmdlineflags_index* index, const char* name, size_t n)
+{
+    const struct cmdlineflags_index_module* global;
+    const struct cmdlineflags_index_module* module;
+    const struct cmdlineflags* cmdlineflags;
+    const struct cmdlineflags* found = NULL;
+    size_t m;
+    size_t i;
+
+    global = cmdlineflags_get_module(index, NULL);
+
+    for (i = 0; i < index->n_longoptions; ++i) {
+        cmdlineflags = index->longoptions[i].cmdlineflags;
+        if (cmdlineflags == NULL)
+            continue;
+
+        module = &index->modules[index->longoptions[i].module];
+
+        /* Options of the global module go first. */
+        if (module == global) {
+            if (cmdlineflags_envnameequal(cmdlineflags->option.u.longoption, name, n))
+                return cmdlineflags;
+        } else if (found == NULL) {
+            m = strlen(module->name);
+            if ((m + 1 < n) && (name[m] == '_') && cmdlineflags_envnameequal(module->name, name, m) &&
+                cmdlineflags_envnameequal(cmdlineflags->option.u.longoption, name + m + 1, n - m - 1))
+                found = cmdlineflags;
+        }
+    }
+
+    return found;
+}
+
+/* Applies the values of all <prefix>_[<module>_]<longoption> variables in one pass over 'envp'.
+   Returns 0 on success, negative value when a handler fails. */
+static int cmdlineflags_parse_environ(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, char* const envp[])
+{
+    const char* prefix = parser->cfg.env_prefix;
+    size_t prefix_len = strlen(prefix);
+    char name[CMDLINEFLAGS_ENV_NAME_MAX];
+
+    for (; *envp != NULL; ++envp) {
+        const char* variable = *envp;
+        const char* value;
+        const struct cmdlineflags* cmdlineflags;
+        size_t n;
+        size_t i;
+        int status;
+
+        if (strncmp(variable, prefix, prefix_len) || (variable[prefix_len] != '_'))
+            continue;
+
+        variable += prefix_len + 1;
+
+        value = strchr(variable, '=');
+        if (value == NULL)
+            continue;
+
+        n = value++ - variable;
+        if ((n == 0) || (n >= sizeof(name)))
+            continue;
+
+        for (i = 0; i < n; ++i)
+            name[i] = cmdlineflags_tolower(variable[i]);
+        name[n] = '\0';
+
+        /* Variables of other tools sharing the prefix are not errors. */
+        cmdlineflags = cmdlineflags_get_env_option(index, name, n);
+        if (cmdlineflags == NULL)
+            continue;
+
+        if (!cmdlineflags_has_argument(cmdlineflags)) {
+            /* Options without an argument are booleans here. */
+            status = cmdlineflags_parse_bool(value);
+            if (status < 0) {
+                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT, 0);
+                PRINT_ERROR(parser, "%s_%.*s: '%s' is neither true nor false\n", prefix, (int)n, variable, value);
+            }
+
+            if (status <= 0)
+                continue;
+
+            value = NULL;
+        }
+
+        if (cmdlineflags_call(parser, cmdlineflags, value, 0) != 0) {
+            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, 0);
+            return CMDLINEFLAGS_FAILURE;
+        }
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Applies the options of a configuration file: 'key = value' lines (or just 'key' for options without
+   an argument) of the global module, followed by '[module]' sections. Empty lines and lines starting
+   with '#' or ';' are skipped. Values are null terminated in place, so the handlers get pointers into the file.
+   Returns 0 on success, negative value when a handler fails. */
+static int cmdlineflags_parse_config(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const char* path, char* text)
+{
+    const struct cmdlineflags_index_module* module;
+    unsigned line_number;
+    char* line;
+    char* next;
+
+    module = cmdlineflags_get_module(index, NULL);
+    line_number = 0;
+
+    for (line = text; *line != '\0'; line = next) {
+        const struct cmdlineflags* cmdlineflags;
+        char* end;
+        char* key_end;
+        char* value;
+        int status;
+
+        line_number++;
+
+        end = strchr(line, '\n');
+        if (end != NULL)
+            next = end + 1;
+        else
+            next = end = line + strlen(line);
+
+        while ((line < end) && cmdlineflags_is_space(*line))
+            line++;
+        while ((end > line) && cmdlineflags_is_space(end[-1]))
+            end--;
+        *end = '\0';
+
+        if ((line == end) || (*line == '#') || (*line == ';'))
+            continue;
+
+        if (*line == '[') {
+            if ((end[-1] != ']') || (end - line < 3)) {
+                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_CONFIG_FILE, 0);
+                PRINT_ERROR(parser, "%s:%u: malformed section '%s'\n", path, line_number, line);
+                continue;
+            }
+
+            end[-1] = '\0';
+
+            /* Options of an unknown module are skipped (the module is reported just once). */
+            module = cmdlineflags_get_module(index, line + 1);
+            if (module == NULL) {
+                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION, 0);
+                PRINT_ERROR(parser, "%s:%u: unrecognized module '%s'\n", path, line_number, line + 1);
+            }
+
+            continue;
+        }
+
+        if (module == NULL)
+            continue;
+
+        value = strchr(line, '=');
+        if (value != NULL) {
+            key_end = value++;
+
+            while (cmdlineflags_is_space(*value))
+                value++;
+
+            if ((end - value >= 2) && ((*value == '"') || (*value == '\'')) && (end[-1] == *value)) {
+                end[-1] = '\0';
+                value++;
+            }
+        } else
+            key_end = end;
+
+        while ((key_end > line) && cmdlineflags_is_space(key_end[-1]))
+            key_end--;
+
+        cmdlineflags = NULL;
+        if (key_end - line == 1)
+            cmdlineflags = cmdlineflags_get_shortoption(module, *line);
+        if (cmdlineflags == NULL)
+            cmdlineflags = cmdlineflags_get_longoption(index, module, line, key_end - line);
+
+        if (cmdlineflags == NULL) {
+            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION, 0);
+            PRINT_ERROR(parser, "%s:%u: unrecognized option '%.*s'\n", path, line_number, (int)(key_end - line), line);
+            continue;
+        }
+
+        if (cmdlineflags_has_argument(cmdlineflags)) {
+            if (value == NULL) {
+                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_MISSING_ARGUMENT, 0);
+                PRINT_ERROR(parser, "%s:%u: option '%.*s' requires a value\n", path, line_number, (int)(key_end - line), line);
+                continue;
+            }
+        } else if (value != NULL) {
+            /* Options without an argument are booleans here. */
+            status = cmdlineflags_parse_bool(value);
+            if (status < 0) {
+                cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT, 0);
+                PRINT_ERROR(parser, "%s:%u: '%s' is neither true nor false\n", path, line_number, value);
+            }
+
+            if (status <= 0)
+                continue;
+
+            value = NULL;
+        }
+
+        if (cmdlineflags_call(parser, cmdlineflags, value, 0) != 0) {
+            cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_HANDLER, 0);
+            return CMDLINEFLAGS_FAILURE;
+        }
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_parse_config_file(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const char* path)
+{
+    char* text;
+
+    if (cmdlineflags_map_file(parser, path, &text) != CMDLINEFLAGS_SUCCESS) {
+        cmdlineflags_set_error(parser, CMDLINEFLAGS_ERROR_CONFIG_FILE, 0);
+        PRINT_ERROR(parser, "%s: cannot read configuration file\n", path);
+        return CMDLINEFLAGS_FAILURE;
+    }
+
+    return cmdlineflags_parse_config(parser, index, path, text);
+}
+
+static int cmdlineflags_compare(const struct cmdlineflags* l, const struct cmdlineflags* r)
+{
+    int status;
+
+    /* Both options belong to the same module (shard). */
+    if ((l->option.type == CMDLINEFLAGS_SHORTOPTION) && ((r->option.type == CMDLINEFLAGS_LONGOPTION)))
+        status = l->option.u.shortoption - r->option.u.longoption[0];
+    else if ((l->option.type == CMDLINEFLAGS_LONGOPTION) && ((r->option.type == CMDLINEFLAGS_SHORTOPTION))) {
+        status = l->option.u.longoption[0] - r->option.u.shortoption;
+    } else if ((l->option.type == CMDLINEFLAGS_LONGOPTION) && ((r->option.type == CMDLINEFLAGS_LONGOPTION)))
+        status = strcmp(l->option.u.longoption, r->option.u.longoption);
+    else
+        status = l->option.u.shortoption - r->option.u.shortoption;
+
+    return status;
+}
+
+static int cmdlineflags_compare_entries(const void* l, const void* r)
+{
+    const struct cmdlineflags* lit = cmdlineflags_get_entry_option(*(const cmdlineflags_index_entry_t* const*)l);
+    const struct cmdlineflags* rit = cmdlineflags_get_entry_option(*(const cmdlineflags_index_entry_t* const*)r);
+    int status;
+
+    status = cmdlineflags_compare(lit, rit);
+    if (status == 0) /* e.g. '-d' and '--dry-run', short option goes first */
+        status = (int)lit->option.type - (int)rit->option.type;
+
+    return status;
+}
+
+static const cmdlineflags_index_entry_t** cmdlineflags_sort_options(const struct cmdlineflags_index* index)
+{
+    const cmdlineflags_index_entry_t** sorted;
+    size_t i;
+
+    sorted = cmdlineflags_malloc((index->n_options + 1) * sizeof(cmdlineflags_index_entry_t*));
+    if (sorted == NULL)
+        return NULL;
+
+    memcpy(sorted, index->options, index->n_options * sizeof(cmdlineflags_index_entry_t*));
+
+    for (i = 0; i < index->n_modules; ++i)
+        cmdlineflags_sort(sorted + index->modules[i].begin, index->modules[i].end - index->modules[i].begin,
+            sizeof(cmdlineflags_index_entry_t*), cmdlineflags_compare_entries);
+
+    return sorted;
+}
+
+/* Orders long options by module id and then by name (normalized). */
+static int cmdlineflags_compare_longoptions(const void* p1, const void* p2)
+{
+    const struct cmdlineflags_index_longoption* l1 = p1;
+    const struct cmdlineflags_index_longoption* l2 = p2;
+    const char* s1;
+    const char* s2;
+
+    if (l1->module != l2->module)
+        return l1->module < l2->module ? -1 : 1;
+
+    for (s1 = l1->cmdlineflags->option.u.longoption, s2 = l2->cmdlineflags->option.u.longoption;
+         (*s1 != '\0') && (cmdlineflags_normalize(*s1) == cmdlineflags_normalize(*s2)); ++s1, ++s2)
+        ;
+
+    return (unsigned char)cmdlineflags_normalize(*s1) - (unsigned char)cmdlineflags_normalize(*s2);
+}
+
+/* Fills the 'node' covering 'n' (at least one) sorted long options, all sharing the first 'depth' characters. */
+static void cmdlineflags_build_trie_node(struct cmdlineflags_trie* trie, size_t node, const struct cmdlineflags_index_longoption* longoptions, size_t n, size_t depth)
+{
+    struct cmdlineflags_trie_node* it = &trie->nodes[node];
+    const char* first = longoptions[0].cmdlineflags->option.u.longoption;
+    const char* last = longoptions[n - 1].cmdlineflags->option.u.longoption;
+    size_t length;
+    size_t i;
+    size_t j;
+
+    /* Options are sorted, so whatever the first and the last one have in common, all of them have. */
+    for (length = depth; (first[length] != '\0') && (cmdlineflags_normalize(first[length]) == cmdlineflags_normalize(last[length])); ++length)
+        ;
+
+    it->label = first + depth;
+    it->n_label = length - depth;
+    it->cmdlineflags = NULL;
+    it->n_options = n;
+    it->children = trie->n_nodes;
+    it->n_children = 0;
+
+    /* The option ending here (if any) sorts first. */
+    i = 0;
+    if (first[length] == '\0')
+        it->cmdlineflags = longoptions[i++].cmdlineflags;
+
+    for (j = i; j < n; ++j)
+        if ((j == i) || (cmdlineflags_normalize(longoptions[j].cmdlineflags->option.u.longoption[length]) !=
+                         cmdlineflags_normalize(longoptions[j - 1].cmdlineflags->option.u.longoption[length])))
+            it->n_children++;
+
+    trie->n_nodes += it->n_children;
+
+    for (node = it->children; i < n; i = j, ++node) {
+        char c = cmdlineflags_normalize(longoptions[i].cmdlineflags->option.u.longoption[length]);
+
+        for (j = i; (j < n) && (cmdlineflags_normalize(longoptions[j].cmdlineflags->option.u.longoption[length]) == c); ++j)
+            ;
+
+        cmdlineflags_build_trie_node(trie, node, longoptions + i, j - i, length);
+    }
+}
+
+static struct cmdlineflags_trie* cmdlineflags_build_trie(const struct cmdlineflags_index* index)
+{
+    struct cmdlineflags_trie* trie;
+    struct cmdlineflags_index_longoption* longoptions;
+    size_t n = 0;
+    size_t i;
+    size_t j;
+
+    longoptions = cmdlineflags_malloc((index->n_longoptions + 1) * sizeof(struct cmdlineflags_index_longoption));
+    trie = cmdlineflags_calloc(1, sizeof(struct cmdlineflags_trie));
+    if ((longoptions == NULL) || (trie == NULL)) {
+        cmdlineflags_free(trie);
+        cmdlineflags_free(longoptions);
+        return NULL;
+    }
+
+    for (i = 0; i < index->n_longoptions; ++i)
+        if (index->longoptions[i].cmdlineflags != NULL)
+            longoptions[n++] = index->longoptions[i];
+
+    cmdlineflags_sort(longoptions, n, sizeof(struct cmdlineflags_index_longoption), cmdlineflags_compare_longoptions);
+
+    /* Every node but the roots either ends an option or has at least two children. */
+    trie->nodes = cmdlineflags_malloc((2 * n + index->n_modules + 1) * sizeof(struct cmdlineflags_trie_node));
+    trie->roots = cmdlineflags_malloc((index->n_modules + 1) * sizeof(size_t));
+    if ((trie->nodes == NULL) || (trie->roots == NULL)) {
+        cmdlineflags_free_trie(trie);
+        cmdlineflags_free(longoptions);
+        return NULL;
+    }
+
+    for (i = 0; i < index->n_modules; ++i)
+        trie->roots[i] = SIZE_MAX;
+
+    for (i = 0; i < n; i = j) {
+        for (j = i; (j < n) && (longoptions[j].module == longoptions[i].module); ++j)
+            ;
+
+        trie->roots[longoptions[i].module] = trie->n_nodes++;
+        cmdlineflags_build_trie_node(trie, trie->roots[longoptions[i].module], longoptions + i, j - i, 0);
+    }
+
+    cmdlineflags_free(longoptions);
+
+    return trie;
+}
+
+static void cmdlineflags_free_trie(struct cmdlineflags_trie* trie)
+{
+    if (trie != NULL) {
+        cmdlineflags_free(trie->nodes);
+        cmdlineflags_free(trie->roots);
+        cmdlineflags_free(trie);
+    }
+}
+
+static int cmdlineflags_flush_fd(struct cmdlineflags_help_writer* writer)
+{
+    struct iovec* iov = writer->iov;
+    int iovcnt = writer->iovcnt;
+    ssize_t status;
+
+    while (iovcnt > 0) {
+        status = writev(writer->u.fd, iov, iovcnt);
+        if (status < 0) {
+            if (errno == EINTR)
+                continue;
+            return CMDLINEFLAGS_FAILURE;
+        }
+
+        /* Skip whatever has been written and retry with the rest. */
+        for (; (iovcnt > 0) && ((size_t)status >= iov->iov_len); ++iov, --iovcnt)
+            status -= iov->iov_len;
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + status;
+            iov->iov_len -= status;
+        }
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_flush_stream(struct cmdlineflags_help_writer* writer)
+{
+    int i;
+
+    for (i = 0; i < writer->iovcnt; ++i)
+        if (fwrite(writer->iov[i].iov_base, 1, writer->iov[i].iov_len, writer->u.stream) != writer->iov[i].iov_len)
+            return CMDLINEFLAGS_FAILURE;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Fills the caller's buffer as far as it goes, the rest is only counted. */
+static int cmdlineflags_flush_buffer(struct cmdlineflags_help_writer* writer)
+{
+    size_t len;
+    int i;
+
+    for (i = 0; (i < writer->iovcnt) && (writer->u.buffer.remaining > 0); ++i) {
+        len = writer->iov[i].iov_len < writer->u.buffer.remaining ? writer->iov[i].iov_len : writer->u.buffer.remaining;
+        memcpy(writer->u.buffer.msg, writer->iov[i].iov_base, len);
+        writer->u.buffer.msg += len;
+        writer->u.buffer.remaining -= len;
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_writer_flush(struct cmdlineflags_help_writer* writer)
+{
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (writer->iovcnt > 0)
+        status = writer->flush(writer);
+
+    writer->iovcnt = 0;
+    writer->used = 0;
+
+    return status;
+}
+
+static int cmdlineflags_writer_copy(struct cmdlineflags_help_writer* writer, const char* str, size_t len, bool underscore2dash)
+{
+    struct iovec* last;
+    char* dest;
+    size_t n;
+    size_t i;
+
+    while (len > 0) {
+        last = writer->iovcnt > 0 ? &writer->iov[writer->iovcnt - 1] : NULL;
+        dest = writer->chunk + writer->used;
+
+        /* Appending to the tail of the chunk does not need a new iovec. */
+        if ((last != NULL) && ((char*)last->iov_base + last->iov_len != dest))
+            last = NULL;
+
+        if ((writer->used == sizeof(writer->chunk)) || ((last == NULL) && (writer->iovcnt == CMDLINEFLAGS_HELP_IOVCNT))) {
+            if (cmdlineflags_writer_flush(writer) != CMDLINEFLAGS_SUCCESS)
+                return CMDLINEFLAGS_FAILURE;
+            continue;
+        }
+
+        n = sizeof(writer->chunk) - writer->used;
+        if (n > len)
+            n = len;
+
+        if (underscore2dash) {
+            for (i = 0; i < n; ++i)
+                dest[i] = str[i] != '_' ? str[i] : '-';
+        } else
+            memcpy(dest, str, n);
+
+        if (last != NULL)
+            last->iov_len += n;
+        else {
+            writer->iov[writer->iovcnt].iov_base = dest;
+            writer->iov[writer->iovcnt].iov_len = n;
+            writer->iovcnt++;
+        }
+
+        writer->used += n;
+        writer->n += n;
+        str += n;
+        len -= n;
+    }
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Emits 'len' characters of 'str' without copying them, so they shall stay valid until the writer is flushed. */
+static int cmdlineflags_writer_reference(struct cmdlineflags_help_writer* writer, const char* str, size_t len)
+{
+    if (writer->iovcnt == CMDLINEFLAGS_HELP_IOVCNT)
+        if (cmdlineflags_writer_flush(writer) != CMDLINEFLAGS_SUCCESS)
+            return CMDLINEFLAGS_FAILURE;
+
+    writer->iov[writer->iovcnt].iov_base = (void*)str;
+    writer->iov[writer->iovcnt].iov_len = len;
+    writer->iovcnt++;
+    writer->n += len;
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+/* Emits null terminated 'str' which shall stay valid until the writer is flushed. */
+static int cmdlineflags_writer_puts(struct cmdlineflags_help_writer* writer, const char* str)
+{
+    size_t len = strlen(str);
+
+    if (len < CMDLINEFLAGS_HELP_MIN_REFERENCE)
+        return cmdlineflags_writer_copy(writer, str, len, false);
+
+    return cmdlineflags_writer_reference(writer, str, len);
+}
+
+/* Emits the levels of the module's name as they are given on the command line. */
+static int cmdlineflags_writer_put_module(struct cmdlineflags_help_writer* writer, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module)
+{
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (module->parent != UINT_MAX) {
+        status |= cmdlineflags_writer_put_module(writer, index, &index->modules[module->parent]);
+        status |= cmdlineflags_writer_copy(writer, " ", 1, false);
+    }
+
+    return status | cmdlineflags_writer_puts(writer, module->level);
+}
+
+static int cmdlinefags_build_help_msg(struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* first, const struct cmdlineflags_index_module* last, struct cmdlineflags_help_writer* writer, bool sort)
+{
+    static const char spaces[CMDLINEFLAGS_HELP_PREFIX_WIDTH] = "                                        ";
+    char shortoption[2] = {'-', '\0'};
+    size_t prefix;
+    int status;
+    size_t i;
+    const struct cmdlineflags_index_module* module;
+    const cmdlineflags_index_entry_t* const* options;
+
+    status = CMDLINEFLAGS_SUCCESS;
+    options = snapshot->index->options;
+
+    if (sort) {
+        options = cmdlineflags_get_sorted_options(snapshot);
+        if (options == NULL)
+            return CMDLINEFLAGS_FAILURE;
+    }
+
+    for (module = first; (module < last) && (status == CMDLINEFLAGS_SUCCESS); ++module) {
+        const cmdlineflags_index_entry_t* const* cmdlineflags = options + module->begin;
+        size_t n_options = module->end - module->begin;
+
+        if (n_options == 0)
+            continue;
+
+        if (strcmp(module->name, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE))) {
+            status |= cmdlineflags_writer_copy(writer, "\n", 1, false);
+            status |= cmdlineflags_writer_put_module(writer, snapshot->index, module);
+            status |= cmdlineflags_writer_copy(writer, "\n", 1, false);
+        }
+
+        /* Every line reads "   <prefix padded to 40 characters> : <help>\n". */
+        for (i = 0; (i < n_options) && (status == CMDLINEFLAGS_SUCCESS); ++i) {
+            const cmdlineflags_index_entry_t* entry = cmdlineflags[i];
+            const struct cmdlineflags* it = cmdlineflags_get_entry_option(entry);
+            const char* longoption = NULL;
+
+            status |= cmdlineflags_writer_copy(writer, "   ", 3, false);
+            prefix = writer->n;
+
+            if (it->option.type == CMDLINEFLAGS_SHORTOPTION) {
+                shortoption[1] = it->option.u.shortoption;
+                status |= cmdlineflags_writer_copy(writer, shortoption, 2, false);
+                if (entry->sibbling != NULL) {
+                    status |= cmdlineflags_writer_copy(writer, ", ", 2, false);
+                    longoption = entry->sibbling->option.u.longoption;
+                }
+            } else
+                longoption = it->option.u.longoption;
+
+            if (longoption != NULL) {
+                status |= cmdlineflags_writer_copy(writer, "--", 2, false);
+                status |= cmdlineflags_writer_copy(writer, longoption, strlen(longoption), true);
+            }
+
+            if (cmdlineflags_has_argument(it))
+                status |= cmdlineflags_writer_copy(writer, " <arg>", 6, false);
+
+            prefix = writer->n - prefix;
+            if (prefix < sizeof(spaces))
+                status |= cmdlineflags_writer_copy(writer, spaces, sizeof(spaces) - prefix, false);
+
+            status |= cmdlineflags_writer_copy(writer, " : ", 3, false);
+            status |= cmdlineflags_writer_puts(writer, entry->help);
+            status |= cmdlineflags_writer_copy(writer, "\n", 1, false);
+        }
+    }
+
+    status |= cmdlineflags_writer_flush(writer);
+
+    if ((status != CMDLINEFLAGS_SUCCESS) || (writer->n > INT_MAX))
+        return CMDLINEFLAGS_FAILURE;
+
+    return writer->n;
+}
+
+static int cmdlineflags_write_help_msg(struct cmdlineflags_help_writer* writer, bool sort)
+{
+    const struct cmdlineflags_index_help* prebuilt = &cmdlineflags_prebuilt_help;
+    struct cmdlineflags_snapshot* snapshot;
+    unsigned long epoch;
+    int n = CMDLINEFLAGS_FAILURE;
+
+    writer->n = 0;
+    writer->iovcnt = 0;
+    writer->used = 0;
+
+    epoch = cmdlineflags_read_lock();
+
+    snapshot = cmdlineflags_get_snapshot();
+
+    /* The help message rendered at build time is only trusted when it describes exactly the same sections. */
+    if ((snapshot != NULL) &&
+        (snapshot->n_sections == 0) &&
+        sort &&
+        (prebuilt != NULL) &&
+        (prebuilt->version == CMDLINEFLAGS_INDEX_VERSION) &&
+        (prebuilt->n_shortoptions_entries == (size_t)(&CMDLINEFLAGS_SHORTOPTIONS_SECTION_END - &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START)) &&
+        (prebuilt->n_longoptions_entries == (size_t)(&CMDLINEFLAGS_LONGOPTIONS_SECTION_END - &CMDLINEFLAGS_LONGOPTIONS_SECTION_START)) &&
+        (prebuilt->size <= INT_MAX)) {
+        if ((cmdlineflags_writer_reference(writer, prebuilt->msg, prebuilt->size) == CMDLINEFLAGS_SUCCESS) &&
+            (cmdlineflags_writer_flush(writer) == CMDLINEFLAGS_SUCCESS))
+            n = writer->n;
+    } else if (snapshot != NULL) {
+        const struct cmdlineflags_index* index = snapshot->index;
+
+        n = cmdlinefags_build_help_msg(snapshot, index->modules, index->modules + index->n_modules, writer, sort);
+    }
+
+    cmdlineflags_read_unlock(epoch);
+
+    return n;
+}
+
+/* Walks the words preceding the 'cursor' as cmdlineflags_parse_argv() does, but without calling any handlers,
+   and sets the 'module' they select. Returns false when the word at the cursor is not to be completed,
+   i.e. when it is an argument of an option or it follows '--' or a non-option which does not name a module. */
+static bool cmdlineflags_select_module(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, char* const argv[], int cursor, const struct cmdlineflags_index_module** module, bool* has_module)
+{
+    const struct cmdlineflags_index* index = snapshot->index;
+    const struct cmdlineflags_index_module* global = cmdlineflags_get_module(index, NULL);
+    const struct cmdlineflags_index_module* nested;
+    const struct cmdlineflags* it;
+    int argv_index;
+
+    *module = global;
+    *has_module = false;
+
+    for (argv_index = 1; argv_index < cursor; argv_index++) {
+        const char* arg = argv[argv_index];
+
+        if ((arg == NULL) || !strcmp(arg, "--"))
+            return false;
+
+        if (cmdlineflags_is_nonoption(arg)) {
+            if (!*has_module) {
+                *has_module = true;
+                *module = cmdlineflags_get_child(index, NULL, arg);
+            } else if ((*module != NULL) && ((nested = cmdlineflags_get_child(index, *module, arg)) != NULL))
+                *module = nested;
+            else
+                return false;
+        } else if (cmdlineflags_is_longoption(arg)) {
+            const struct cmdlineflags_trie_node* ambiguous = NULL;
+            const char* longoption = arg + 2; /* Skip the initial '--' */
+            size_t n = strcspn(longoption, "=");
+
+            it = cmdlineflags_find_longoption(parser, snapshot, *module, global, longoption, n, &ambiguous);
+            if ((it != NULL) && cmdlineflags_has_argument(it) && (longoption[n] == '\0'))
+                argv_index++;
+        } else {
+            const char* nextchar;
+
+            for (nextchar = arg + 1; *nextchar != '\0'; ++nextchar) {
+                it = cmdlineflags_find_shortoption(parser, index, *module, global, *nextchar);
+                if ((it != NULL) && cmdlineflags_has_argument(it)) {
+                    /* The rest of the word is the argument, if there is no rest, the next word is. */
+                    if (nextchar[1] == '\0')
+                        argv_index++;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* Otherwise the word at the cursor is the argument of the last option. */
+    return argv_index == cursor;
+}
+
+/* Orders the 'name' against the concatenation of the 'n' strings of the 'prefix', as far as the prefix goes,
+   so zero means that the name starts with the prefix. */
+static int cmdlineflags_compare_prefix(const char* name, const char* const* prefix, size_t n)
+{
+    const char* it;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+        for (it = prefix[i]; *it != '\0'; ++it, ++name)
+            if (*name != *it)
+                return (unsigned char)*name - (unsigned char)*it;
+
+    return 0;
+}
+
+/* Modules (but the global one) are sorted by name, so the ones nested in the 'parent' (or the top level ones,
+   if the 'parent' is NULL) and named on the command line with a word starting with 'word' are all found
+   within the range of the names starting with the parent's name, the separator and the 'word'. */
+static int cmdlineflags_complete_modules(const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* parent, const char* word, struct cmdlineflags_help_writer* writer, size_t* n_candidates)
+{
+    unsigned parent_id = parent != NULL ? (unsigned)(parent - index->modules) : UINT_MAX;
+    const char* prefix[3];
+    size_t n_prefix = 0;
+    size_t first = 0;
+    size_t last = index->n_modules;
+    size_t middle;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (parent != NULL) {
+        prefix[n_prefix++] = parent->name;
+        prefix[n_prefix++] = CMDLINEFLAGS_MODULE_SEPARATOR;
+    }
+    prefix[n_prefix++] = word;
+
+    if ((last > 0) && !strcmp(index->modules[0].name, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE)))
+        first = 1;
+
+    while (first < last) {
+        middle = first + (last - first) / 2;
+        if (cmdlineflags_compare_prefix(index->modules[middle].name, prefix, n_prefix) < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    for (; (first < index->n_modules) && (status == CMDLINEFLAGS_SUCCESS) &&
+           (cmdlineflags_compare_prefix(index->modules[first].name, prefix, n_prefix) == 0); ++first)
+        if (index->modules[first].parent == parent_id) {
+            status |= cmdlineflags_writer_puts(writer, index->modules[first].level);
+            status |= cmdlineflags_writer_copy(writer, "\n", 1, false);
+            (*n_candidates)++;
+        }
+
+    return status;
+}
+
+/* Short options are looked up just as the parser looks them up, so the ones shadowed by the module are skipped. */
+static int cmdlineflags_complete_shortoptions(struct cmdlineflags_parser* parser, const struct cmdlineflags_index* index, const struct cmdlineflags_index_module* module, struct cmdlineflags_help_writer* writer, size_t* n_candidates)
+{
+    const struct cmdlineflags_index_module* global = cmdlineflags_get_module(index, NULL);
+    char shortoption[3] = {'-', '\0', '\n'};
+    int status = CMDLINEFLAGS_SUCCESS;
+    unsigned c;
+
+    for (c = 1; (c <= UCHAR_MAX) && (status == CMDLINEFLAGS_SUCCESS); ++c)
+        if (cmdlineflags_find_shortoption(parser, index, module, global, (char)c) != NULL) {
+            shortoption[1] = (char)c;
+            status |= cmdlineflags_writer_copy(writer, shortoption, sizeof(shortoption), false);
+            (*n_candidates)++;
+        }
+
+    return status;
+}
+
+/* Long options starting with the first 'n' characters of 'longoption' of the module and, if the options are inherited,
+   of its ancestors (nearest first). */
+static int cmdlineflags_complete_longoptions(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, const struct cmdlineflags_index_module* module, const char* longoption, size_t n, struct cmdlineflags_help_writer* writer, size_t* n_candidates)
+{
+    const struct cmdlineflags_index* index = snapshot->index;
+    const struct cmdlineflags_index_module* global = cmdlineflags_get_module(index, NULL);
+    const struct cmdlineflags_index_module* it;
+    const struct cmdlineflags_trie* trie;
+    const struct cmdlineflags_trie_node* node;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (module == NULL)
+        return CMDLINEFLAGS_SUCCESS;
+
+    trie = cmdlineflags_get_trie(snapshot);
+    if (trie == NULL)
+        return CMDLINEFLAGS_FAILURE;
+
+    for (it = module; (it != NULL) && (status == CMDLINEFLAGS_SUCCESS);
+         it = parser->cfg.inherit_options ? cmdlineflags_get_ancestor(index, it, global) : NULL) {
+        node = cmdlineflags_get_trie_node(trie, it - index->modules, longoption, n);
+        if (node != NULL)
+            status |= cmdlineflags_complete_trie_node(index, trie, node, module, it, writer, n_candidates);
+    }
+
+    return status;
+}
+
+/* Long options (of the 'owner') ending at the 'node' or below it, but the ones shadowed by the 'module'
+   or by the ancestors of the 'module' nearer than the 'owner'. */
+static int cmdlineflags_complete_trie_node(const struct cmdlineflags_index* index, const struct cmdlineflags_trie* trie, const struct cmdlineflags_trie_node* node, const struct cmdlineflags_index_module* module, const struct cmdlineflags_index_module* owner, struct cmdlineflags_help_writer* writer, size_t* n_candidates)
+{
+    const struct cmdlineflags_index_module* global = cmdlineflags_get_module(index, NULL);
+    const struct cmdlineflags_index_module* it;
+    const char* longoption;
+    int status = CMDLINEFLAGS_SUCCESS;
+    size_t i;
+
+    if (node->cmdlineflags != NULL) {
+        longoption = node->cmdlineflags->option.u.longoption;
+
+        for (it = module; (it != owner) && (cmdlineflags_get_longoption(index, it, longoption, strlen(longoption)) == NULL);)
+            it = cmdlineflags_get_ancestor(index, it, global);
+
+        if (it == owner) {
+            status |= cmdlineflags_writer_copy(writer, "--", 2, false);
+            status |= cmdlineflags_writer_copy(writer, longoption, strlen(longoption), true);
+            status |= cmdlineflags_writer_copy(writer, "\n", 1, false);
+            (*n_candidates)++;
+        }
+    }
+
+    for (i = 0; (i < node->n_children) && (status == CMDLINEFLAGS_SUCCESS); ++i)
+        status |= cmdlineflags_complete_trie_node(index, trie, &trie->nodes[node->children + i], module, owner, writer, n_candidates);
+
+    return status;
+}
+
+static int cmdlineflags_write_candidates(struct cmdlineflags_parser* parser, struct cmdlineflags_snapshot* snapshot, int argc, char* const argv[], int cursor, struct cmdlineflags_help_writer* writer)
+{
+    const struct cmdlineflags_index_module* module;
+    const char* word = (cursor < argc) && (argv[cursor] != NULL) ? argv[cursor] : "";
+    bool has_module;
+    size_t n_candidates = 0;
+    int status = CMDLINEFLAGS_SUCCESS;
+
+    if (cmdlineflags_select_module(parser, snapshot, argv, cursor, &module, &has_module)) {
+        if (word[0] != '-') {
+            /* Nothing is nested in a module which does not exist. */
+            if (!has_module || (module != NULL))
+                status = cmdlineflags_complete_modules(snapshot->index, has_module ? module : NULL, word, writer, &n_candidates);
+        } else if (word[1] == '\0') {
+            status |= cmdlineflags_complete_shortoptions(parser, snapshot->index, module, writer, &n_candidates);
+            status |= cmdlineflags_complete_longoptions(parser, snapshot, module, "", 0, writer, &n_candidates);
+        } else if ((word[1] == '-') && (strchr(word, '=') == NULL))
+            status = cmdlineflags_complete_longoptions(parser, snapshot, module, word + 2, strlen(word + 2), writer, &n_candidates);
+    }
+
+    status |= cmdlineflags_writer_flush(writer);
+
+    if ((status != CMDLINEFLAGS_SUCCESS) || (n_candidates > INT_MAX))
+        return CMDLINEFLAGS_FAILURE;
+
+    return n_candidates;
+}
+
+static int cmdlineflags_compare_module_names(const void* l, const void* r)
+{
+    const char* lname = ((const struct cmdlineflags_module_name*)l)->name;
+    const char* rname = ((const struct cmdlineflags_module_name*)r)->name;
+
+    if (!strcmp(lname, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE)))
+        return -1;
+    else if (!strcmp(rname, CMDLINEFLAGS_XSTR(CMDLINEFLAGS_GLOBAL_MODULE)))
+        return +1;
+    else
+        return strcmp(lname, rname);
+}
+
+/* Id of the module of the given 'name', which is added (with the next id) if not known yet. */
+static unsigned cmdlineflags_intern_module(struct cmdlineflags_index* index, unsigned* modules_hash, struct cmdlineflags_module_name* names, const char* name)
+{
+    unsigned id;
+    size_t i;
+
+    for (i = cmdlineflags_hash_string(CMDLINEFLAGS_FNV_OFFSET_BASIS, name) & index->modules_mask;
+         (id = modules_hash[i]) != UINT_MAX;
+         i = (i + 1) & index->modules_mask)
+        if (!strcmp(names[id].name, name))
+            return id;
+
+    id = index->n_modules++;
+    names[id].name = name;
+    names[id].id = id;
+    modules_hash[i] = id;
+
+    return id;
+}
+
+static void cmdlineflags_free_index(struct cmdlineflags_index* index)
+{
+    if (index != NULL) {
+        if (index->modules != NULL)
+            cmdlineflags_free((void*)index->modules[0].shortoptions);
+        cmdlineflags_free((void*)index->modules);
+        cmdlineflags_free((void*)index->modules_hash);
+        cmdlineflags_free((void*)index->children_hash);
+        cmdlineflags_free(index->names);
+        cmdlineflags_free((void*)index->options);
+        cmdlineflags_free((void*)index->longoptions);
+        cmdlineflags_free((void*)index->displacements);
+        cmdlineflags_free(index);
+    }
+}
+
+/* Entries of all the 'sections' are numbered one after another, each sections starting at its offset. */
+static struct cmdlineflags_index* cmdlineflags_build_dynamic_index(const struct cmdlineflags_sections* sections, size_t n_sections)
+{
+    size_t n_shortoptions = 0;
+    size_t n_longoptions = 0;
+    size_t n_entries;
+    size_t* offsets;
+    struct cmdlineflags_index* index;
+    struct cmdlineflags_index_module* modules = NULL;
+    unsigned* modules_hash = NULL;
+    unsigned* children_hash = NULL;
+    const cmdlineflags_index_entry_t** options = NULL;
+    const struct cmdlineflags** shortoptions = NULL;
+    struct cmdlineflags_index_longoption* longoptions = NULL;
+    struct cmdlineflags_module_name* names = NULL;
+    unsigned* ids = NULL;
+    unsigned* ranks = NULL;
+    bool done = false;
+    unsigned* parents = NULL;
+    char* pool = NULL;
+    size_t n_pool = 0;
+    size_t n_ancestors = 0;
+    size_t n_slots;
+    size_t n_options;
+    size_t e;
+    size_t i;
+    size_t j;
+    size_t k;
+
+    offsets = cmdlineflags_malloc(n_sections * sizeof(size_t));
+    if (offsets == NULL)
+        return NULL;
+
+    for (k = 0; k < n_sections; ++k) {
+        offsets[k] = n_shortoptions + n_longoptions;
+        n_shortoptions += cmdlineflags_get_n_shortoptions(&sections[k]);
+        n_longoptions += cmdlineflags_get_n_positions(&sections[k]) - cmdlineflags_get_n_shortoptions(&sections[k]);
+
+        /* Bound the number (and the names) of the ancestors nested modules bring in. */
+        for (j = 0; j < cmdlineflags_get_n_positions(&sections[k]); ++j) {
+            const char* module = cmdlineflags_get_option(&sections[k], j)->module;
+            const char* separator;
+
+            if (module != NULL)
+                for (separator = module; (separator = strstr(separator, CMDLINEFLAGS_MODULE_SEPARATOR)) != NULL; ++separator) {
+                    n_ancestors++;
+                    n_pool += separator - module + 1;
+                }
+        }
+    }
+
+    n_entries = n_shortoptions + n_longoptions;
+
+    index = cmdlineflags_calloc(1, sizeof(struct cmdlineflags_index));
+    if (index == NULL) {
+        cmdlineflags_free(offsets);
+        return NULL;
+    }
+
+    index->version = CMDLINEFLAGS_INDEX_VERSION;
+    index->n_shortoptions_entries = n_shortoptions;
+    index->n_longoptions_entries = n_longoptions;
+
+    do {
+        /* Every module owns at least one option or is an ancestor of one which does. */
+        for (n_slots = 16; n_slots < 2 * (n_entries + n_ancestors); n_slots <<= 1)
+            ;
+
+        index->modules_hash = modules_hash = cmdlineflags_malloc(n_slots * sizeof(unsigned));
+        names = cmdlineflags_malloc((n_entries + n_ancestors) * sizeof(struct cmdlineflags_module_name));
+        parents = cmdlineflags_malloc((n_entries + n_ancestors) * sizeof(unsigned));
+        ids = cmdlineflags_malloc(n_entries * sizeof(unsigned));
+        index->names = pool = cmdlineflags_malloc(n_pool + 1);
+        if ((modules_hash == NULL) || (names == NULL) || (parents == NULL) || (ids == NULL) || (pool == NULL))
+            break;
+
+        memset(modules_hash, 0xff, n_slots * sizeof(unsigned));
+        index->modules_mask = n_slots - 1;
+
+        /* Intern the module names, ids are given in order of appearance for now. */
+        for (e = 0, k = 0; k < n_sections; ++k)
+            for (j = 0; j < cmdlineflags_get_n_positions(&sections[k]); ++j, ++e) {
+                const struct cmdlineflags* it = cmdlineflags_get_option(&sections[k], j);
+
+                ids[e] = it->module != NULL ? cmdlineflags_intern_module(index, modules_hash, names, it->module) : UINT_MAX;
             }
-        } else if (it->option.type == CMDLINEFLAGS_LONGOPTION) {
-            cmdlineflags_underscore2dash(longoption, it->option.u.longoption, sizeof(longoption));
-            if (it->flags == CMDLINEFLAGS_NO_ARGUMENT)
-                status = snprintf(prefix, sizeof(prefix), "--%s", longoption);
-            else
-                status = snprintf(prefix, sizeof(prefix), "--%s <arg>", longoption);
-        } else {
-            /* do nothing */
+
+        /* Nested modules bring their ancestors in (appended, so these are visited as well). */
+        for (i = 0, n_pool = 0; i < index->n_modules; ++i) {
+            const char* separator = cmdlineflags_get_parent_separator(names[i].name);
+            size_t n;
+
+            parents[i] = UINT_MAX;
+            if (separator == NULL)
+                continue;
+
+            n = separator - names[i].name;
+            memcpy(pool + n_pool, names[i].name, n);
+            pool[n_pool + n] = '\0';
+
+            j = index->n_modules;
+            parents[i] = cmdlineflags_intern_module(index, modules_hash, names, pool + n_pool);
+            if (parents[i] == j)
+                n_pool += n + 1;
+        }
+
+        /* Renumber the modules so that ids follow the order of the help message. */
+        cmdlineflags_sort(names, index->n_modules, sizeof(struct cmdlineflags_module_name), cmdlineflags_compare_module_names);
+
+        ranks = cmdlineflags_malloc((index->n_modules + 1) * sizeof(unsigned));
+        index->modules = modules = cmdlineflags_calloc(index->n_modules + 1, sizeof(struct cmdlineflags_index_module));
+        for (n_slots = 16; n_slots < 2 * index->n_modules; n_slots <<= 1)
+            ;
+        index->children_hash = children_hash = cmdlineflags_malloc(n_slots * sizeof(unsigned));
+        if ((ranks == NULL) || (modules == NULL) || (children_hash == NULL))
+            break;
+
+        memset(children_hash, 0xff, n_slots * sizeof(unsigned));
+        index->children_mask = n_slots - 1;
+
+        shortoptions = cmdlineflags_calloc((index->n_modules + 1) * (UCHAR_MAX + 1), sizeof(struct cmdlineflags*));
+        if (shortoptions == NULL)
+            break;
+
+        modules[0].shortoptions = shortoptions;
+
+        for (i = 0; i < index->n_modules; ++i) {
+            ranks[names[i].id] = i;
+            modules[i].name = names[i].name;
+            modules[i].shortoptions = shortoptions + i * (UCHAR_MAX + 1);
+        }
+
+        for (i = 0; i < index->n_modules; ++i) {
+            unsigned parent = parents[names[i].id];
+
+            modules[i].parent = parent != UINT_MAX ? ranks[parent] : UINT_MAX;
+            modules[i].level = parent != UINT_MAX ? modules[i].name + strlen(modules[ranks[parent]].name) + 2 : modules[i].name;
+
+            for (j = cmdlineflags_hash_child(modules[i].parent, modules[i].level) & index->children_mask;
+                 children_hash[j] != UINT_MAX;
+                 j = (j + 1) & index->children_mask)
+                ;
+
+            children_hash[j] = i;
+        }
+
+        for (i = 0; i <= index->modules_mask; ++i)
+            if (modules_hash[i] != UINT_MAX)
+                modules_hash[i] = ranks[modules_hash[i]];
+
+        for (e = 0; e < n_entries; ++e)
+            if (ids[e] != UINT_MAX)
+                ids[e] = ranks[ids[e]];
+
+        /* Count the listed entries of each module and lay the shards out one after another. */
+        n_options = 0;
+        for (k = 0; k < n_sections; ++k)
+            for (j = 0; j < cmdlineflags_get_n_entries(&sections[k]); ++j) {
+                const cmdlineflags_index_entry_t* it = cmdlineflags_get_entry(&sections[k], j);
+
+                if (cmdlineflags_is_listed(it)) {
+                    modules[ids[offsets[k] + cmdlineflags_get_position(&sections[k], cmdlineflags_get_entry_option(it))]].end++;
+                    n_options++;
+                }
+            }
+
+        for (i = 0, e = 0; i < index->n_modules; ++i) {
+            size_t shard_size = modules[i].end;
+
+            modules[i].begin = modules[i].end = e;
+            e += shard_size;
         }
 
-        if (status < 0)
+        index->options = options = cmdlineflags_malloc((n_options + 1) * sizeof(cmdlineflags_index_entry_t*));
+        if (options == NULL)
+            break;
+
+        index->n_options = n_options;
+
+        /* Walk backwards, unsorted help messages have always listed the sections in reverse. */
+        for (k = 0; k < n_sections; ++k)
+            for (j = cmdlineflags_get_n_entries(&sections[k]); j-- > 0;) {
+                const cmdlineflags_index_entry_t* it = cmdlineflags_get_entry(&sections[k], j);
+
+                if (cmdlineflags_is_listed(it))
+                    options[modules[ids[offsets[k] + cmdlineflags_get_position(&sections[k], cmdlineflags_get_entry_option(it))]].end++] = it;
+            }
+
+        for (n_slots = 16; n_slots < 2 * n_longoptions; n_slots <<= 1)
+            ;
+
+        index->longoptions = longoptions = cmdlineflags_calloc(n_slots, sizeof(struct cmdlineflags_index_longoption));
+        if (longoptions == NULL)
+            break;
+
+        index->n_longoptions = n_slots;
+
+        for (e = 0, k = 0; k < n_sections; ++k)
+            for (j = 0; j < cmdlineflags_get_n_positions(&sections[k]); ++j, ++e) {
+                const struct cmdlineflags* it = cmdlineflags_get_option(&sections[k], j);
+
+                if (ids[e] == UINT_MAX)
+                    continue;
+
+                /* Options of the registered sections shall not redefine any of the options defined before. */
+                if (it->option.type == CMDLINEFLAGS_SHORTOPTION) {
+                    const struct cmdlineflags** slot = &shortoptions[ids[e] * (UCHAR_MAX + 1) + (unsigned char)it->option.u.shortoption];
+
+                    if ((k > 0) && (*slot != NULL))
+                        break;
+
+                    *slot = it;
+                } else {
+                    const char* longoption = it->option.u.longoption;
+                    size_t n = strlen(longoption);
+
+                    for (i = cmdlineflags_hash_key(ids[e], longoption, n) & (n_slots - 1);
+                         longoptions[i].cmdlineflags != NULL;
+                         i = (i + 1) & (n_slots - 1))
+                        if ((k > 0) && (longoptions[i].module == ids[e]) && cmdlineflags_longoptionsequal(longoptions[i].cmdlineflags->option.u.longoption, longoption, n))
+                            break;
+
+                    if (longoptions[i].cmdlineflags != NULL)
+                        break;
+
+                    longoptions[i].cmdlineflags = it;
+                    longoptions[i].module = ids[e];
+                }
+            }
+
+        done = (e == n_entries);
+    } while (0);
+
+    if (!done) {
+        cmdlineflags_free_index(index);
+        index = NULL;
+    }
+
+    cmdlineflags_free(ranks);
+    cmdlineflags_free(ids);
+    cmdlineflags_free(parents);
+    cmdlineflags_free(names);
+    cmdlineflags_free(offsets);
+
+    return index;
+}
+
+static void cmdlineflags_build_index(void)
+{
+    const struct cmdlineflags_index* prebuilt = &cmdlineflags_prebuilt_index;
+
+    /* The prebuilt index is only trusted when it describes exactly the same sections. */
+    if ((prebuilt != NULL) &&
+        (prebuilt->version == CMDLINEFLAGS_INDEX_VERSION) &&
+        (prebuilt->n_shortoptions_entries == (size_t)(&CMDLINEFLAGS_SHORTOPTIONS_SECTION_END - &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START)) &&
+        (prebuilt->n_longoptions_entries == (size_t)(&CMDLINEFLAGS_LONGOPTIONS_SECTION_END - &CMDLINEFLAGS_LONGOPTIONS_SECTION_START)))
+        cmdlineflags_main_snapshot.index = prebuilt;
+    else
+        cmdlineflags_main_snapshot.index = cmdlineflags_build_dynamic_index(&cmdlineflags_main_sections, 1);
+
+    if (cmdlineflags_main_snapshot.index != NULL)
+        __atomic_store_n(&cmdlineflags_snapshot, &cmdlineflags_main_snapshot, __ATOMIC_RELEASE);
+}
+
+/* Waits for all the readers which might have seen the snapshot replaced just before.
+   Shall be called with cmdlineflags_registry_mutex held. */
+static void cmdlineflags_synchronize(void)
+{
+    unsigned long epoch = __atomic_fetch_add(&cmdlineflags_epoch, 1, __ATOMIC_SEQ_CST);
+
+    /* The flag is raised before the readers are checked and a reader checks the flag after leaving,
+       so either the writer sees no readers or the last reader sees the writer (and signals it under the mutex). */
+    pthread_mutex_lock(&cmdlineflags_readers_mutex);
+    __atomic_store_n(&cmdlineflags_writer_waiting, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&cmdlineflags_readers[epoch & 1], __ATOMIC_SEQ_CST) != 0)
+        pthread_cond_wait(&cmdlineflags_readers_gone, &cmdlineflags_readers_mutex);
+
+    __atomic_store_n(&cmdlineflags_writer_waiting, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&cmdlineflags_readers_mutex);
+}
+
+static void cmdlineflags_free_snapshot(struct cmdlineflags_snapshot* snapshot)
+{
+    if ((snapshot != NULL) && (snapshot != &cmdlineflags_main_snapshot)) {
+        cmdlineflags_free_index((struct cmdlineflags_index*)snapshot->index);
+        cmdlineflags_free((void*)snapshot->sorted);
+        cmdlineflags_free_trie(snapshot->trie);
+        cmdlineflags_free((void*)snapshot->sections);
+        cmdlineflags_free(snapshot);
+    }
+}
+
+/* Replaces the current snapshot with the one of the main image's sections followed by the given ones
+   and retires the previous one. Shall be called with cmdlineflags_registry_mutex held. */
+static int cmdlineflags_publish(const struct cmdlineflags_sections* sections, size_t n_sections)
+{
+    struct cmdlineflags_snapshot* previous = __atomic_load_n(&cmdlineflags_snapshot, __ATOMIC_ACQUIRE);
+    struct cmdlineflags_snapshot* snapshot = &cmdlineflags_main_snapshot;
+    struct cmdlineflags_sections* all;
+
+    if (n_sections > 0) {
+        snapshot = cmdlineflags_calloc(1, sizeof(struct cmdlineflags_snapshot));
+        all = cmdlineflags_malloc((n_sections + 1) * sizeof(struct cmdlineflags_sections));
+        if ((snapshot == NULL) || (all == NULL)) {
+            cmdlineflags_free(all);
+            cmdlineflags_free(snapshot);
             return CMDLINEFLAGS_FAILURE;
+        }
 
-        status = snprintf(msg, remaining, "   %-40s : %s\n", prefix, it->help);
-        if (status < 0)
+        all[0] = cmdlineflags_main_sections;
+        memcpy(all + 1, sections, n_sections * sizeof(struct cmdlineflags_sections));
+
+        /* The snapshot keeps the registered sections only. */
+        snapshot->index = cmdlineflags_build_dynamic_index(all, n_sections + 1);
+        snapshot->sections = memmove(all, all + 1, n_sections * sizeof(struct cmdlineflags_sections));
+        snapshot->n_sections = n_sections;
+
+        if (snapshot->index == NULL) {
+            cmdlineflags_free_snapshot(snapshot);
             return CMDLINEFLAGS_FAILURE;
+        }
+    }
 
-        n += status;
-        if (n < size) {
-            remaining -= status;
-            msg += status;
-        } else
-            remaining = 0;
+    __atomic_store_n(&cmdlineflags_snapshot, snapshot, __ATOMIC_RELEASE);
+
+    cmdlineflags_synchronize();
+    cmdlineflags_free_snapshot(previous);
+
+    return CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_fprint_symbol(FILE* file, const char* prefix, const struct cmdlineflags* it)
+{
+    if (it->option.type == CMDLINEFLAGS_SHORTOPTION)
+        return fprintf(file, "%sshortoptions_%s_%c", prefix, it->module, it->option.u.shortoption);
+    else
+        return fprintf(file, "%slongoptions_%s_%s", prefix, it->module, it->option.u.longoption);
+}
+
+/* Tells whether 'address' is reachable by the symbol the generated index would refer to the record 'it' with.
+   Works in the generator twins only, which export their symbols (see cmdlineflags-generate.cmake). */
+static bool cmdlineflags_is_named(const char* prefix, const struct cmdlineflags* it, const void* address)
+{
+    char* symbol;
+    bool named = false;
+    int n;
+
+    if (it->option.type == CMDLINEFLAGS_SHORTOPTION)
+        n = snprintf(NULL, 0, "%sshortoptions_%s_%c", prefix, it->module, it->option.u.shortoption);
+    else
+        n = snprintf(NULL, 0, "%slongoptions_%s_%s", prefix, it->module, it->option.u.longoption);
+
+    symbol = n >= 0 ? cmdlineflags_malloc(n + 1) : NULL;
+    if (symbol != NULL) {
+        if (it->option.type == CMDLINEFLAGS_SHORTOPTION)
+            snprintf(symbol, n + 1, "%sshortoptions_%s_%c", prefix, it->module, it->option.u.shortoption);
+        else
+            snprintf(symbol, n + 1, "%slongoptions_%s_%s", prefix, it->module, it->option.u.longoption);
+
+        named = dlsym(RTLD_DEFAULT, symbol) == address;
+        cmdlineflags_free(symbol);
     }
 
-    return n;
+    return named;
 }
 
-static const struct cmdlineflags** cmdlineflags_combine_options(size_t* n_options, bool sort)
+static int cmdlineflags_fprint_entry(FILE* file, const cmdlineflags_index_entry_t* entry)
 {
-    const struct cmdlineflags* const shortoptions_start_addr = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START;
-    const struct cmdlineflags* const shortoptions_end_addr = &CMDLINEFLAGS_SHORTOPTIONS_SECTION_END;
-    ptrdiff_t n_shortoptions_distance = shortoptions_end_addr - shortoptions_start_addr;
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    return cmdlineflags_fprint_symbol(file, "&cmdlineflags_help_", entry->cmdlineflags);
+#else
+    return cmdlineflags_fprint_symbol(file, "cmdlineflags_", entry);
+#endif
+}
 
-    const struct cmdlineflags* const longoptions_start_addr = &CMDLINEFLAGS_LONGOPTIONS_SECTION_START;
-    const struct cmdlineflags* const longoptions_end_addr = &CMDLINEFLAGS_LONGOPTIONS_SECTION_END;
-    ptrdiff_t n_longoptions_distance = longoptions_end_addr - longoptions_start_addr;
+static int cmdlineflags_compare_mph_buckets(const void* l, const void* r)
+{
+    size_t lsize = ((const struct cmdlineflags_mph_bucket*)l)->size;
+    size_t rsize = ((const struct cmdlineflags_mph_bucket*)r)->size;
 
-    if (--n_shortoptions_distance < 0)
-        return NULL;
+    /* The biggest buckets go first. */
+    return (lsize < rsize) - (lsize > rsize);
+}
 
-    if (--n_longoptions_distance < 0)
-        return NULL;
+/* Computes minimal perfect hash (hash and displace) of all long options of the 'index'. */
+static int cmdlineflags_build_mph(const struct cmdlineflags_index* index,
+                                  struct cmdlineflags_index_longoption* longoptions,
+                                  size_t n_keys,
+                                  unsigned* displacements,
+                                  size_t n_buckets)
+{
+    int retval = CMDLINEFLAGS_FAILURE;
+    uint64_t* hashes;
+    size_t* sources;
+    size_t* keys;
+    size_t* slots;
+    struct cmdlineflags_mph_bucket* buckets;
+    size_t i;
+    size_t j;
+    size_t k;
+    size_t b;
 
-    size_t distance = n_shortoptions_distance + n_longoptions_distance;
-    size_t n = 0;
+    hashes = cmdlineflags_malloc(n_keys * sizeof(uint64_t));
+    sources = cmdlineflags_malloc(n_keys * sizeof(size_t));
+    keys = cmdlineflags_malloc(n_keys * sizeof(size_t));
+    slots = cmdlineflags_malloc(n_keys * sizeof(size_t));
+    buckets = cmdlineflags_calloc(n_buckets, sizeof(struct cmdlineflags_mph_bucket));
+
+    do {
+        if ((hashes == NULL) || (sources == NULL) || (keys == NULL) || (slots == NULL) || (buckets == NULL))
+            break;
+
+        for (i = 0, k = 0; i < index->n_longoptions; ++i) {
+            const struct cmdlineflags_index_longoption* slot = &index->longoptions[i];
+
+            if (slot->cmdlineflags != NULL) {
+                const char* longoption = slot->cmdlineflags->option.u.longoption;
+
+                hashes[k] = cmdlineflags_hash_key(slot->module, longoption, strlen(longoption));
+                sources[k] = i;
+                buckets[cmdlineflags_mph_bucket(hashes[k], n_buckets)].size++;
+                k++;
+            }
+        }
+
+        /* Group the keys by buckets. */
+        for (b = 0, k = 0; b < n_buckets; ++b) {
+            buckets[b].id = b;
+            buckets[b].first = k;
+            k += buckets[b].size;
+            buckets[b].size = 0;
+        }
+
+        for (k = 0; k < n_keys; ++k) {
+            struct cmdlineflags_mph_bucket* bucket = &buckets[cmdlineflags_mph_bucket(hashes[k], n_buckets)];
+            keys[bucket->first + bucket->size++] = k;
+        }
+
+        cmdlineflags_sort(buckets, n_buckets, sizeof(struct cmdlineflags_mph_bucket), cmdlineflags_compare_mph_buckets);
+
+        for (i = 0; i < n_keys; ++i)
+            longoptions[i].cmdlineflags = NULL;
+
+        /* Place the biggest buckets first, while there are still plenty of free slots. */
+        for (b = 0; (b < n_buckets) && (buckets[b].size > 0); ++b) {
+            const size_t* bucket_keys = keys + buckets[b].first;
+            size_t size = buckets[b].size;
+            unsigned displacement;
+            bool separable = true;
+
+            /* Keys of identical hashes can never be separated. */
+            for (j = 0; j < size; ++j)
+                for (k = 0; k < j; ++k)
+                    if (hashes[bucket_keys[j]] == hashes[bucket_keys[k]])
+                        separable = false;
+
+            if (!separable)
+                break;
+
+            for (displacement = 0; displacement < UINT_MAX; ++displacement) {
+                for (j = 0; j < size; ++j) {
+                    slots[j] = cmdlineflags_mph_slot(hashes[bucket_keys[j]], displacement, n_keys);
+                    if (longoptions[slots[j]].cmdlineflags != NULL)
+                        break;
+
+                    for (k = 0; (k < j) && (slots[k] != slots[j]); ++k)
+                        ;
+
+                    if (k < j)
+                        break;
+                }
+
+                if (j == size)
+                    break;
+            }
+
+            if (displacement == UINT_MAX)
+                break;
+
+            for (j = 0; j < size; ++j)
+                longoptions[slots[j]] = index->longoptions[sources[bucket_keys[j]]];
+
+            displacements[buckets[b].id] = displacement;
+        }
+
+        if ((b == n_buckets) || (buckets[b].size == 0))
+            retval = CMDLINEFLAGS_SUCCESS;
+    } while (0);
+
+    cmdlineflags_free(buckets);
+    cmdlineflags_free(slots);
+    cmdlineflags_free(keys);
+    cmdlineflags_free(sources);
+    cmdlineflags_free(hashes);
+
+    return retval;
+}
+
+static bool cmdlineflags_has_shortoptions(const struct cmdlineflags_index_module* module)
+{
+    size_t i;
+
+    for (i = 0; i <= UCHAR_MAX; ++i)
+        if (module->shortoptions[i] != NULL)
+            return true;
+
+    return false;
+}
+
+/* Returns the first record the generated index could not refer to (e.g. defined in C++, where the records
+   are static and their names need not be identifiers) or NULL if all of them have their symbols. */
+static const struct cmdlineflags* cmdlineflags_find_unnamed(const struct cmdlineflags_index* index)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < index->n_modules; ++i)
+        for (j = 0; j <= UCHAR_MAX; ++j)
+            if ((index->modules[i].shortoptions[j] != NULL) &&
+                !cmdlineflags_is_named("cmdlineflags_", index->modules[i].shortoptions[j], index->modules[i].shortoptions[j]))
+                return index->modules[i].shortoptions[j];
+
+    for (i = 0; i < index->n_longoptions; ++i)
+        if ((index->longoptions[i].cmdlineflags != NULL) &&
+            !cmdlineflags_is_named("cmdlineflags_", index->longoptions[i].cmdlineflags, index->longoptions[i].cmdlineflags))
+            return index->longoptions[i].cmdlineflags;
+
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+    for (i = 0; i < index->n_options; ++i)
+        if (!cmdlineflags_is_named("cmdlineflags_help_", index->options[i]->cmdlineflags, index->options[i]))
+            return index->options[i]->cmdlineflags;
+#endif
+
+    return NULL;
+}
+
+static int cmdlineflags_write_index(FILE* file, const struct cmdlineflags_index* index)
+{
+    struct cmdlineflags_index_longoption* longoptions;
+    unsigned* displacements;
+    unsigned* modules_hash;
+    size_t modules_mask;
+    size_t n_longoptions;
+    size_t n_buckets;
+    size_t i;
+    size_t j;
+    int status;
+
+    for (i = 0, n_longoptions = 0; i < index->n_longoptions; ++i)
+        if (index->longoptions[i].cmdlineflags != NULL)
+            n_longoptions++;
+
+    n_buckets = (n_longoptions + CMDLINEFLAGS_MPH_BUCKET_SIZE - 1) / CMDLINEFLAGS_MPH_BUCKET_SIZE;
+
+    /* The index built at runtime sizes the modules hash table for the worst case, here it can be made tight. */
+    for (modules_mask = 1; modules_mask < 2 * index->n_modules; modules_mask <<= 1)
+        ;
+
+    longoptions = cmdlineflags_calloc(n_longoptions + 1, sizeof(struct cmdlineflags_index_longoption));
+    displacements = cmdlineflags_calloc(n_buckets + 1, sizeof(unsigned));
+    modules_hash = cmdlineflags_malloc(modules_mask * sizeof(unsigned));
+
+    modules_mask -= 1;
+
+    do {
+        status = CMDLINEFLAGS_FAILURE;
+
+        if ((longoptions == NULL) || (displacements == NULL) || (modules_hash == NULL))
+            break;
+
+        memset(modules_hash, 0xff, (modules_mask + 1) * sizeof(unsigned));
+
+        for (i = 0; i < index->n_modules; ++i) {
+            for (j = cmdlineflags_hash_string(CMDLINEFLAGS_FNV_OFFSET_BASIS, index->modules[i].name) & modules_mask;
+                 modules_hash[j] != UINT_MAX;
+                 j = (j + 1) & modules_mask)
+                ;
+
+            modules_hash[j] = i;
+        }
+
+        if ((n_longoptions > 0) && (cmdlineflags_build_mph(index, longoptions, n_longoptions, displacements, n_buckets) != CMDLINEFLAGS_SUCCESS))
+            break;
+
+        fprintf(file, "/* Generated by cmdlineflags %s, do not edit. */\n", PROJECT_VER);
+        fprintf(file, "#include <cmdlineflags/cmdlineflags_index.h>\n\n");
+
+        for (i = 0; i < index->n_modules; ++i) {
+            for (j = 0; j <= UCHAR_MAX; ++j) {
+                if (index->modules[i].shortoptions[j] != NULL) {
+                    fprintf(file, "LTS_EXTERN const struct cmdlineflags ");
+                    cmdlineflags_fprint_symbol(file, "cmdlineflags_", index->modules[i].shortoptions[j]);
+                    fprintf(file, "[];\n");
+                }
+            }
+        }
 
-    const struct cmdlineflags** cmdlineflags = calloc(distance, sizeof(struct cmdlineflags*));
-    if (cmdlineflags != NULL) {
-        const struct cmdlineflags* it;
+        for (i = 0; i < n_longoptions; ++i) {
+            fprintf(file, "LTS_EXTERN const struct cmdlineflags ");
+            cmdlineflags_fprint_symbol(file, "cmdlineflags_", longoptions[i].cmdlineflags);
+            fprintf(file, "[];\n");
+        }
 
-        for (it = shortoptions_start_addr; it < shortoptions_end_addr; ++it) {
-            if (it->module != NULL) {
-                if (sort)
-                    cmdlinefags_add(cmdlineflags, n++, it);
-                else
-                    cmdlineflags[n++] = it;
+#if defined(CMDLINEFLAGS_COMPACT_LAYOUT)
+        for (i = 0; i < index->n_modules; ++i) {
+            for (j = index->modules[i].begin; j < index->modules[i].end; ++j) {
+                fprintf(file, "LTS_EXTERN const struct cmdlineflags_help ");
+                cmdlineflags_fprint_symbol(file, "cmdlineflags_help_", index->options[j]->cmdlineflags);
+                fprintf(file, ";\n");
             }
         }
+#endif
+
+        for (i = 0; i < index->n_modules; ++i) {
+            if (!cmdlineflags_has_shortoptions(&index->modules[i])) {
+                fprintf(file, "\nstatic const struct cmdlineflags* const cmdlineflags_prebuilt_shortoptions_%zu[UCHAR_MAX + 1] = {0};\n", i);
+                continue;
+            }
 
-        for (it = longoptions_start_addr; it < longoptions_end_addr; ++it) {
-            if ((it->module != NULL) && (it->sibbling != it)) {
-                if (sort)
-                    cmdlinefags_add(cmdlineflags, n++, it);
-                else
-                    cmdlineflags[n++] = it;
+            fprintf(file, "\nstatic const struct cmdlineflags* const cmdlineflags_prebuilt_shortoptions_%zu[UCHAR_MAX + 1] = {\n", i);
+            for (j = 0; j <= UCHAR_MAX; ++j) {
+                if (index->modules[i].shortoptions[j] != NULL) {
+                    fprintf(file, "    [%zu] = ", j);
+                    cmdlineflags_fprint_symbol(file, "cmdlineflags_", index->modules[i].shortoptions[j]);
+                    fprintf(file, ",\n");
+                }
             }
+            fprintf(file, "};\n");
+        }
+
+        fprintf(file, "\nstatic const struct cmdlineflags_index_module cmdlineflags_prebuilt_modules[] = {\n");
+        for (i = 0; i < index->n_modules; ++i) {
+            fprintf(file, "    {\"%s\", %zu, %zu, cmdlineflags_prebuilt_shortoptions_%zu, ",
+                index->modules[i].name, index->modules[i].begin, index->modules[i].end, i);
+            if (index->modules[i].parent != UINT_MAX)
+                fprintf(file, "%uU, \"%s\"},\n", index->modules[i].parent, index->modules[i].level);
+            else
+                fprintf(file, "UINT_MAX, \"%s\"},\n", index->modules[i].level);
         }
+        fprintf(file, "    {0}\n};\n");
+
+        fprintf(file, "\nstatic const unsigned cmdlineflags_prebuilt_modules_hash[] = {\n");
+        for (i = 0; i <= modules_mask; ++i)
+            if (modules_hash[i] != UINT_MAX)
+                fprintf(file, "    %uU,\n", modules_hash[i]);
+            else
+                fprintf(file, "    UINT_MAX,\n");
+        fprintf(file, "};\n");
+
+        fprintf(file, "\nstatic const unsigned cmdlineflags_prebuilt_children_hash[] = {\n");
+        for (i = 0; i <= index->children_mask; ++i)
+            if (index->children_hash[i] != UINT_MAX)
+                fprintf(file, "    %uU,\n", index->children_hash[i]);
+            else
+                fprintf(file, "    UINT_MAX,\n");
+        fprintf(file, "};\n");
 
-        if (!sort) {
-            size_t i;
-            for (i = 0; i < n / 2; ++i) {
-                const struct cmdlineflags* it = cmdlineflags[i];
-                cmdlineflags[i] = cmdlineflags[n - i - 1];
-                cmdlineflags[n - i - 1] = it;
+        fprintf(file, "\nstatic const cmdlineflags_index_entry_t* const cmdlineflags_prebuilt_options[] = {\n");
+        for (i = 0; i < index->n_modules; ++i) {
+            for (j = index->modules[i].begin; j < index->modules[i].end; ++j) {
+                fprintf(file, "    ");
+                cmdlineflags_fprint_entry(file, index->options[j]);
+                fprintf(file, ",\n");
             }
         }
+        fprintf(file, "    0\n};\n");
+
+        fprintf(file, "\nstatic const struct cmdlineflags_index_longoption cmdlineflags_prebuilt_longoptions[] = {\n");
+        for (i = 0; i < n_longoptions; ++i) {
+            fprintf(file, "    {");
+            cmdlineflags_fprint_symbol(file, "cmdlineflags_", longoptions[i].cmdlineflags);
+            fprintf(file, ", %u},\n", longoptions[i].module);
+        }
+        fprintf(file, "    {0}\n};\n");
+
+        /* Referenced (and thus emitted) only when there are long options, the unused one would break -Werror builds. */
+        if (n_longoptions > 0) {
+            fprintf(file, "\nstatic const unsigned cmdlineflags_prebuilt_displacements[] = {\n");
+            for (i = 0; i < n_buckets; ++i)
+                fprintf(file, "    %uU,\n", displacements[i]);
+            fprintf(file, "    0\n};\n");
+        }
+
+        fprintf(file, "\nconst struct cmdlineflags_index cmdlineflags_prebuilt_index = {\n");
+        fprintf(file, "    .version = %u,\n", (unsigned)CMDLINEFLAGS_INDEX_VERSION);
+        fprintf(file, "    .n_shortoptions_entries = %zu,\n", index->n_shortoptions_entries);
+        fprintf(file, "    .n_longoptions_entries = %zu,\n", index->n_longoptions_entries);
+        fprintf(file, "    .modules = cmdlineflags_prebuilt_modules,\n");
+        fprintf(file, "    .n_modules = %zu,\n", index->n_modules);
+        fprintf(file, "    .modules_hash = cmdlineflags_prebuilt_modules_hash,\n");
+        fprintf(file, "    .modules_mask = %zu,\n", modules_mask);
+        fprintf(file, "    .options = cmdlineflags_prebuilt_options,\n");
+        fprintf(file, "    .n_options = %zu,\n", index->n_options);
+        fprintf(file, "    .longoptions = cmdlineflags_prebuilt_longoptions,\n");
+        if (n_longoptions > 0) {
+            fprintf(file, "    .n_longoptions = %zu,\n", n_longoptions);
+            fprintf(file, "    .displacements = cmdlineflags_prebuilt_displacements,\n");
+            fprintf(file, "    .n_buckets = %zu,\n", n_buckets);
+        } else {
+            /* One empty slot of an open addressing table. */
+            fprintf(file, "    .n_longoptions = 1,\n");
+        }
+        fprintf(file, "    .children_hash = cmdlineflags_prebuilt_children_hash,\n");
+        fprintf(file, "    .children_mask = %zu,\n", index->children_mask);
+        status = fprintf(file, "};\n");
+    } while (0);
+
+    cmdlineflags_free(modules_hash);
+    cmdlineflags_free(displacements);
+    cmdlineflags_free(longoptions);
+
+    return status < 0 ? CMDLINEFLAGS_FAILURE : CMDLINEFLAGS_SUCCESS;
+}
+
+static int cmdlineflags_write_help_source(FILE* file, const char* msg, size_t size)
+{
+    size_t i;
+
+    fprintf(file, "/* Generated by cmdlineflags %s, do not edit. */\n", PROJECT_VER);
+    fprintf(file, "#include <cmdlineflags/cmdlineflags_index.h>\n\n");
+    fprintf(file, "#pragma GCC diagnostic ignored \"-Woverlength-strings\"\n\n");
+
+    fprintf(file, "static const char cmdlineflags_prebuilt_help_msg[] =\n    \"");
+    for (i = 0; i < size; ++i) {
+        unsigned char c = msg[i];
+
+        if (c == '\n')
+            fprintf(file, (i + 1 < size) ? "\\n\"\n    \"" : "\\n");
+        else if ((c == '\\') || (c == '"') || (c == '?')) /* '?' because of trigraphs */
+            fprintf(file, "\\%c", c);
+        else if ((c < ' ') || (c > '~'))
+            fprintf(file, "\\%03o", c);
+        else
+            fputc(c, file);
     }
+    fprintf(file, "\";\n");
+
+    fprintf(file, "\nconst struct cmdlineflags_index_help cmdlineflags_prebuilt_help = {\n");
+    fprintf(file, "    .version = %u,\n", (unsigned)CMDLINEFLAGS_INDEX_VERSION);
+    fprintf(file, "    .n_shortoptions_entries = %zu,\n", (size_t)(&CMDLINEFLAGS_SHORTOPTIONS_SECTION_END - &CMDLINEFLAGS_SHORTOPTIONS_SECTION_START));
+    fprintf(file, "    .n_longoptions_entries = %zu,\n", (size_t)(&CMDLINEFLAGS_LONGOPTIONS_SECTION_END - &CMDLINEFLAGS_LONGOPTIONS_SECTION_START));
+    fprintf(file, "    .msg = cmdlineflags_prebuilt_help_msg,\n");
+    fprintf(file, "    .size = %zu,\n", size);
 
-    return *n_options = n, cmdlineflags;
+    return fprintf(file, "};\n") < 0 ? CMDLINEFLAGS_FAILURE : CMDLINEFLAGS_SUCCESS;
 }
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_abbreviation_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct abbreviation_test {
+    const char* module;
+    const char* option;
+    /* Long option the abbreviation stands for or NULL if it is ambiguous (or unrecognized if 'error' says so). */
+    const char* expected;
+    enum cmdlineflags_error error;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_option(const struct cmdlineflags_option* option);
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument);
+static int run_abbreviation_test(const struct abbreviation_test* test);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, version, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "prints version");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "sets log level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_file, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "sets log file");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, list, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "lists");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, listen, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "listens");
+
+CMDLINEFLAGS_DEFINE(module_name, j, jobs, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "sets number of jobs");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, jitter, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "adds jitter");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, verbatim, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "keeps the output verbatim");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+/* Long option of the last handled option. */
+static const char* handled = NULL;
+
+static const struct abbreviation_test abbreviation_tests[] = {
+    {NULL, "--verbose", "verbose", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--verbo", "verbose", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--versi", "version", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--ver", NULL, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION},
+    {NULL, "--v", NULL, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION},
+    {NULL, "--log-l=info", "log_level", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--log_f=file", "log_file", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--log", NULL, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION},
+    {NULL, "--list", "list", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--liste", "listen", CMDLINEFLAGS_ERROR_NONE},
+    {NULL, "--lis", NULL, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION},
+    {NULL, "--verbosely", NULL, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION},
+    {NULL, "--jo=1", NULL, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION},
+    {NULL, "--", NULL, CMDLINEFLAGS_ERROR_NONE},
+    {"module_name", "--jo=1", "jobs", CMDLINEFLAGS_ERROR_NONE},
+    {"module_name", "--ji", "jitter", CMDLINEFLAGS_ERROR_NONE},
+    {"module_name", "--j", NULL, CMDLINEFLAGS_ERROR_AMBIGUOUS_OPTION},
+    /* Global options are not looked at once the module is given. */
+    {"module_name", "--verb", "verbatim", CMDLINEFLAGS_ERROR_NONE},
+    {"module_name", "--log", NULL, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION},
+    {"unknown_module", "--verb", NULL, CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION},
+};
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const test_argv[] = {"program", "--verbo", NULL};
+        size_t i;
+        int index;
+
+        for (i = 0; i < ARRAY_SIZE(abbreviation_tests); ++i)
+            if (run_abbreviation_test(&abbreviation_tests[i]) != 0)
+                break;
+
+        if (i != ARRAY_SIZE(abbreviation_tests))
+            break;
+
+        /* Abbreviations are not accepted unless asked for. */
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        handled = NULL;
+
+        index = cmdlineflags_parse_r(&parser, 2, test_argv);
+        if ((index != 2) || (parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (handled != NULL))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_option(const struct cmdlineflags_option* option)
+{
+    handled = option->u.longoption;
+    return 0;
+}
+
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument)
+{
+    handled = option->u.longoption;
+    return 0;
+}
+
+static int run_abbreviation_test(const struct abbreviation_test* test)
+{
+    struct cmdlineflags_parser parser;
+    char* const argv[] = {"program", (char*)(test->module != NULL ? test->module : test->option), (char*)test->option, NULL};
+    int argc = test->module != NULL ? 3 : 2;
+    int index;
+
+    if (cmdlineflags_parser_init(&parser, NULL) != 0)
+        return -1;
+
+    parser.cfg.allow_abbreviations = 1;
+    handled = NULL;
+
+    index = cmdlineflags_parse_r(&parser, argc, argv);
+    fprintf(stdout, "%s %s: index: %d, error: %d, handled: %s\n",
+        test->module != NULL ? test->module : "-", test->option, index, parser.error, handled != NULL ? handled : "-");
+
+    if ((index != argc) || (parser.error != test->error))
+        return -1;
+
+    if (test->error != CMDLINEFLAGS_ERROR_NONE)
+        return ((parser.error_index == argc - 1) && (handled == NULL)) ? 0 : -1;
+
+    if (test->expected == NULL)
+        return handled == NULL ? 0 : -1;
+
+    return ((handled != NULL) && !strcmp(handled, test->expected)) ? 0 : -1;
+}
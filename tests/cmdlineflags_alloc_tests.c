@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_alloc_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static int handle_option(const struct cmdlineflags_option* option);
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "sets log level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, dry_run, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "does not apply any changes");
+
+CMDLINEFLAGS_DEFINE(module_name, c, configuration, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "configuration file");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int n_allocations = 0;
+static int n_handled_options = 0;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+void* malloc(size_t size)
+{
+    n_allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    n_allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    n_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        int index;
+        int n_handled_options_first;
+        int n_allocations_second;
+
+        /* The first call is allowed to allocate (i.e. to build the lookup index). */
+        index = cmdlineflags_parse(argc, argv);
+        n_handled_options_first = n_handled_options;
+
+        n_allocations = 0;
+        n_handled_options = 0;
+
+        if (cmdlineflags_parse(argc, argv) != index)
+            break;
+
+        n_allocations_second = n_allocations;
+
+        fprintf(stdout, "cmdlineflags_parse: first nonoption argument: %d\n", index);
+        fprintf(stdout, "cmdlineflags_parse: handled options: %d\n", n_handled_options);
+        fprintf(stdout, "cmdlineflags_parse: allocations: %d\n", n_allocations_second);
+
+        if (n_handled_options == 0)
+            break;
+
+        if (n_handled_options != n_handled_options_first)
+            break;
+
+        if (n_allocations_second != 0)
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_option(const struct cmdlineflags_option* option)
+{
+    n_handled_options++;
+    return 0;
+}
+
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument)
+{
+    n_handled_options++;
+    return 0;
+}
@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_allocator_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* More than the occurrences initially made room for, so they are moved at least once. */
+#define N_INCLUDES 40
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct counters {
+    unsigned n_allocations;
+    unsigned n_live;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static void* counting_alloc(void* ctx, size_t size);
+static void counting_free(void* ctx, void* ptr);
+static int parse(unsigned* n_includes);
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, I, include, \
+   CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT, handle_include_option, "adds include directory");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static unsigned n_heap_allocations = 0;
+static unsigned include_count = 0;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+void* malloc(size_t size)
+{
+    n_heap_allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    n_heap_allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    n_heap_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct counters counters = {0};
+        /* No 'realloc', so the memory is moved whenever it grows. */
+        struct cmdlineflags_allocator allocator = {
+            .alloc = counting_alloc,
+            .free = counting_free,
+            .ctx = &counters,
+        };
+        struct cmdlineflags_allocator invalid = {0};
+        unsigned n_allocations;
+        unsigned n_live;
+        unsigned n_includes;
+        int n;
+
+        /* Allocates the buffer of the stdout, before the heap allocations are counted. */
+        fprintf(stdout, "cmdlineflags_set_allocator\n");
+
+        if (cmdlineflags_set_allocator(&invalid) == 0)
+            break;
+
+        if (cmdlineflags_set_allocator(&allocator) != 0)
+            break;
+
+        n_heap_allocations = 0;
+
+        /* The first parse keeps the lookup index for good. */
+        if (parse(&n_includes) != 0)
+            break;
+
+        n = cmdlineflags_get_help_msg(NULL, 0, true);
+
+        n_allocations = counters.n_allocations;
+        n_live = counters.n_live;
+
+        if (parse(&n_includes) != 0)
+            break;
+
+        fprintf(stdout, "help: %d, includes: %u, allocations: %u (%u), live: %u (%u), heap allocations: %u\n",
+            n, n_includes, n_allocations, counters.n_allocations, n_live, counters.n_live, n_heap_allocations);
+
+        if ((n <= 0) || (n_includes != N_INCLUDES) || (n_heap_allocations != 0))
+            break;
+
+        /* Everything allocated by a parse is given back. */
+        if ((counters.n_allocations <= n_allocations) || (counters.n_live != n_live))
+            break;
+
+        /* The memory kept so far comes from the heap anyway, so the default allocator may take over. */
+        if (cmdlineflags_set_allocator(NULL) != 0)
+            break;
+
+        n_allocations = counters.n_allocations;
+
+        if (parse(&n_includes) != 0)
+            break;
+
+        fprintf(stdout, "includes: %u, allocations: %u, heap allocations: %u\n", n_includes, counters.n_allocations, n_heap_allocations);
+
+        if ((n_includes != N_INCLUDES) || (counters.n_allocations != n_allocations) || (n_heap_allocations == 0))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static void* counting_alloc(void* ctx, size_t size)
+{
+    struct counters* counters = ctx;
+
+    counters->n_allocations++;
+    counters->n_live++;
+
+    return __libc_malloc(size);
+}
+
+static void counting_free(void* ctx, void* ptr)
+{
+    struct counters* counters = ctx;
+
+    counters->n_live--;
+
+    __libc_free(ptr);
+}
+
+static int parse(unsigned* n_includes)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[2 * N_INCLUDES + 4];
+    int argc = 0;
+    int index;
+    int i;
+
+    test_argv[argc++] = "program";
+    test_argv[argc++] = "-v";
+    for (i = 0; i < N_INCLUDES; ++i) {
+        test_argv[argc++] = "-I";
+        test_argv[argc++] = "include";
+    }
+    test_argv[argc++] = "--verb";
+    test_argv[argc] = NULL;
+
+    if (cmdlineflags_parser_init(&parser, NULL) != 0)
+        return -1;
+
+    parser.cfg.allow_abbreviations = 1;
+
+    include_count = 0;
+
+    index = cmdlineflags_parse_r(&parser, argc, test_argv);
+    cmdlineflags_parser_release(&parser);
+
+    *n_includes = include_count;
+
+    return ((index == argc) && (parser.n_errors == 0)) ? 0 : -1;
+}
+
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    return 0;
+}
+
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count)
+{
+    include_count = count;
+    return 0;
+}
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_batch_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option, unsigned count);
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count);
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_q_option(const struct cmdlineflags_option* option);
+static int handle_setting_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_x_option(const struct cmdlineflags_option* option);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_BATCH_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, I, include, \
+   CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT, handle_include_option, "adds include directory");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT, handle_log_level_option, "sets log level");
+
+CMDLINEFLAGS_DEFINE_SHORT_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, q, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_q_option, "decreases verbosity level");
+
+CMDLINEFLAGS_DEFINE_SHORT_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, x, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_x_option, "fails");
+
+/* Distinct options sharing the handler are delivered separately. */
+CMDLINEFLAGS_DEFINE(settings, o, output, \
+   CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT, handle_setting_option, "sets output file");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(settings, log_file, \
+   CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT, handle_setting_option, "sets log file");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static unsigned v_calls = 0;
+static unsigned v_count = 0;
+static unsigned include_calls = 0;
+static char includes[64];
+static unsigned log_level_calls = 0;
+static const char* log_level = NULL;
+/* Order in which the handlers have been called. */
+static char calls[16];
+/* Settings delivered to handle_setting_option(), in order. */
+static char settings[64];
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const test_argv[] = {"program", "--log-level=info", "-vv", "-Ia", "-q", "--include", "b", "-v",
+            "--log-level", "debug", "-I", "c", "remaining", NULL};
+        int index;
+
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        index = cmdlineflags_parse_r(&parser, 13, test_argv);
+        fprintf(stdout, "index: %d, n_errors: %u, v: %u/%u, include: %u/%s, log_level: %u/%s, calls: %s\n",
+            index, parser.n_errors, v_calls, v_count, include_calls, includes, log_level_calls, log_level, calls);
+
+        if ((index != 13) || (parser.n_errors != 0))
+            break;
+
+        /* Ordinary options are called right away, the others in the order of their first occurrences. */
+        if (strcmp(calls, "qlvI"))
+            break;
+
+        if ((v_calls != 1) || (v_count != 3) || (include_calls != 1) || strcmp(includes, "a,b,c"))
+            break;
+
+        if ((log_level_calls != 1) || (log_level != test_argv[9]))
+            break;
+
+        {
+            char* const settings_argv[] = {"program", "settings", "-o", "a", "--log-file=x", "--output", "b", "--log-file", "y", NULL};
+
+            if (cmdlineflags_parser_init(&parser, NULL) != 0)
+                break;
+
+            index = cmdlineflags_parse_r(&parser, 9, settings_argv);
+            fprintf(stdout, "index: %d, n_errors: %u, settings: %s\n", index, parser.n_errors, settings);
+
+            /* Short and long names of an option are still delivered together, with the first one given. */
+            if ((index != 9) || (parser.n_errors != 0) || strcmp(settings, "-o=b;--log_file=y;"))
+                break;
+        }
+
+        {
+            char* const failing_argv[] = {"program", "-v", "-x", "-v", NULL};
+
+            if (cmdlineflags_parser_init(&parser, NULL) != 0)
+                break;
+
+            v_calls = 0;
+            index = cmdlineflags_parse_r(&parser, 4, failing_argv);
+            fprintf(stdout, "index: %d, n_errors: %u, error: %d at %d, v: %u\n", index, parser.n_errors, parser.error, parser.error_index, v_calls);
+
+            /* Nothing is delivered once a handler has failed. */
+            if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_HANDLER) || (parser.error_index != 2) || (v_calls != 0))
+                break;
+        }
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option, unsigned count)
+{
+    strcat(calls, "v");
+    v_calls++;
+    v_count = count;
+    return 0;
+}
+
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count)
+{
+    unsigned i;
+
+    strcat(calls, "I");
+    include_calls++;
+
+    if (arguments[count] != NULL)
+        return -1;
+
+    for (i = 0; i < count; ++i) {
+        if (i > 0)
+            strcat(includes, ",");
+        strcat(includes, arguments[i]);
+    }
+
+    return 0;
+}
+
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    strcat(calls, "l");
+    log_level_calls++;
+    log_level = argument;
+    return 0;
+}
+
+static int handle_q_option(const struct cmdlineflags_option* option)
+{
+    strcat(calls, "q");
+    return 0;
+}
+
+static int handle_setting_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    size_t n = strlen(settings);
+
+    if (option->type == CMDLINEFLAGS_SHORTOPTION)
+        snprintf(settings + n, sizeof(settings) - n, "-%c=%s;", option->u.shortoption, argument);
+    else
+        snprintf(settings + n, sizeof(settings) - n, "--%s=%s;", option->u.longoption, argument);
+
+    return 0;
+}
+
+static int handle_x_option(const struct cmdlineflags_option* option)
+{
+    return -1;
+}
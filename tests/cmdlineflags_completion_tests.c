@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_completion_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define MAX_WORDS 8
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+/* Command line to be completed. */
+struct completion {
+    int argc;
+    char** argv;
+    int cursor;
+};
+
+/* Completion script to be written. */
+struct script {
+    enum cmdlineflags_shell shell;
+    const char* program;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int read_output(int (*producer)(int fd, void* ctx), void* ctx, char* output, size_t size);
+static int write_completions(int fd, void* ctx);
+static int write_script(int fd, void* ctx);
+static int complete(const char* expected, int cursor, ...);
+static int check_script(enum cmdlineflags_shell shell, const char* program, const char* expected);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static bool verbose = false;
+static bool print_version = false;
+static const char* configuration = NULL;
+static int log_level = 0;
+static const char* cluster_name = NULL;
+static int node_timeout = 0;
+static bool drain_force = false;
+static bool drain_now = false;
+static bool list_all = false;
+
+CMDLINEFLAGS_DEFINE_BOOL(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, verbose, "increases verbosity level");
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, version, \
+   CMDLINEFLAGS_BOOL, &print_version, "prints version");
+CMDLINEFLAGS_DEFINE_STRING(CMDLINEFLAGS_GLOBAL_MODULE, c, configuration, configuration, "sets configuration file");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(cache, log_level, \
+   CMDLINEFLAGS_INT, &log_level, "sets log level of the cache");
+
+CMDLINEFLAGS_DEFINE_STRING(cluster, n, name, cluster_name, "sets name of the cluster");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(cluster__node, timeout, \
+   CMDLINEFLAGS_INT, &node_timeout, "sets timeout of the node");
+
+CMDLINEFLAGS_DEFINE_BOOL(cluster__node__drain, f, force, drain_force, "drains the node forcefully");
+
+/* Shadows the short option of the 'cluster' module. */
+CMDLINEFLAGS_DEFINE_BOOL(cluster__node__drain, n, now, drain_now, "drains the node now");
+
+CMDLINEFLAGS_DEFINE_BOOL(fleet__region__list, a, all, list_all, "lists all the regions");
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_cfg cfg;
+        char* words[] = {"program", "cluster", "node", "d", NULL};
+
+        if (cmdlineflags_get_cfg(&cfg) != 0)
+            break;
+
+        /* Modules. */
+        if ((complete("cache\ncluster\nfleet\n", 1, NULL) != 3) ||
+            (complete("cache\ncluster\n", 1, "c", NULL) != 2) ||
+            (complete("cluster\n", 1, "cl", NULL) != 1) ||
+            (complete("node\n", 2, "cluster", "", NULL) != 1) ||
+            (complete("drain\n", 3, "cluster", "node", "d", NULL) != 1) ||
+            (complete("region\n", 2, "fleet", "", NULL) != 1) ||
+            (complete("", 1, "x", NULL) != 0))
+            break;
+
+        /* Options. */
+        if ((complete("--verbose\n--version\n", 1, "--ver", NULL) != 2) ||
+            (complete("-c\n-v\n--configuration\n--verbose\n--version\n", 1, "-", NULL) != 5) ||
+            (complete("--log-level\n", 2, "cache", "--log", NULL) != 1) ||
+            (complete("--log-level\n", 2, "cache", "--log_l", NULL) != 1) ||
+            (complete("--force\n--now\n", 4, "cluster", "node", "drain", "--", NULL) != 2) ||
+            (complete("", 2, "cluster", "--x", NULL) != 0) ||
+            (complete("", 1, "--verbose=", NULL) != 0) ||
+            (complete("", 1, "-vc", NULL) != 0))
+            break;
+
+        /* Arguments of the options and the words following the end of the options. */
+        if ((complete("", 2, "-c", "", NULL) != 0) ||
+            (complete("", 2, "--configuration", "c", NULL) != 0) ||
+            (complete("cluster\n", 3, "--configuration", "file", "cl", NULL) != 1) ||
+            (complete("cluster\n", 2, "-cfile", "cl", NULL) != 1) ||
+            (complete("cluster\n", 3, "-vc", "file", "cl", NULL) != 1) ||
+            (complete("", 2, "--", "c", NULL) != 0) ||
+            (complete("", 3, "cache", "x", "", NULL) != 0) ||
+            (complete("", 2, "unknown", "", NULL) != 0))
+            break;
+
+        /* Options of the ancestors (but the shadowed ones) and abbreviations. */
+        cfg.inherit_options = 1;
+        cfg.allow_abbreviations = 1;
+        if (cmdlineflags_set_cfg(&cfg) != 0)
+            break;
+
+        if ((complete("--now\n--name\n", 4, "cluster", "node", "drain", "--n", NULL) != 2) ||
+            (complete("-c\n-f\n-n\n-v\n--force\n--now\n--timeout\n--name\n--configuration\n--verbose\n--version\n",
+                 4, "cluster", "node", "drain", "-", NULL) != 11) ||
+            (complete("cache\ncluster\n", 3, "--conf", "file", "c", NULL) != 2))
+            break;
+
+        /* Invalid cursors. */
+        if ((cmdlineflags_write_completions(STDOUT_FILENO, 4, words, 0) >= 0) ||
+            (cmdlineflags_write_completions(STDOUT_FILENO, 4, words, 5) >= 0))
+            break;
+
+        if (cmdlineflags_complete(4, words, 3) != 1)
+            break;
+
+        /* Completion scripts. */
+        if ((check_script(CMDLINEFLAGS_SHELL_BASH, "/usr/bin/my-tool", "complete -o default -F _cmdlineflags_my_tool my-tool\n") != 0) ||
+            (check_script(CMDLINEFLAGS_SHELL_ZSH, "my-tool", "compdef _cmdlineflags_my_tool my-tool\n") != 0) ||
+            (check_script(CMDLINEFLAGS_SHELL_FISH, "my.tool", "complete -c my.tool -a '(_cmdlineflags_my_tool)'\n") != 0))
+            break;
+
+        if ((cmdlineflags_write_completion_script(STDOUT_FILENO, CMDLINEFLAGS_SHELL_BASH, "my tool") >= 0) ||
+            (cmdlineflags_write_completion_script(STDOUT_FILENO, CMDLINEFLAGS_SHELL_BASH, "bin/") >= 0) ||
+            (cmdlineflags_write_completion_script(STDOUT_FILENO, (enum cmdlineflags_shell)3, "tool") >= 0))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+/* Runs the 'producer' with the write end of a pipe and reads back whatever it has written. */
+static int read_output(int (*producer)(int fd, void* ctx), void* ctx, char* output, size_t size)
+{
+    int fds[2];
+    int n;
+    ssize_t length = 0;
+    ssize_t status;
+
+    if (pipe(fds) != 0)
+        return -1;
+
+    n = producer(fds[1], ctx);
+    close(fds[1]);
+
+    while ((size_t)length < size - 1) {
+        status = read(fds[0], output + length, size - 1 - length);
+        if (status <= 0)
+            break;
+        length += status;
+    }
+
+    output[length] = '\0';
+    close(fds[0]);
+
+    return n;
+}
+
+static int write_completions(int fd, void* ctx)
+{
+    struct completion* completion = ctx;
+
+    return cmdlineflags_write_completions(fd, completion->argc, completion->argv, completion->cursor);
+}
+
+static int write_script(int fd, void* ctx)
+{
+    struct script* script = ctx;
+
+    return cmdlineflags_write_completion_script(fd, script->shell, script->program);
+}
+
+/* Completes the word at the 'cursor' of the command line given as the remaining arguments (following the program),
+   terminated with NULL. Returns the number of candidates if they are the 'expected' ones, -1 otherwise. */
+static int complete(const char* expected, int cursor, ...)
+{
+    char* argv[MAX_WORDS + 1] = {"program"};
+    struct completion completion = {1, argv, cursor};
+    char output[1024];
+    va_list ap;
+    int n;
+
+    va_start(ap, cursor);
+    while ((completion.argc < MAX_WORDS) && ((argv[completion.argc] = va_arg(ap, char*)) != NULL))
+        completion.argc++;
+    va_end(ap);
+
+    n = read_output(write_completions, &completion, output, sizeof(output));
+
+    fprintf(stdout, "cursor: %d, word: '%s', candidates: %d\n%s", cursor,
+        cursor < completion.argc ? argv[cursor] : "", n, output);
+
+    return strcmp(output, expected) == 0 ? n : -1;
+}
+
+/* The script shall be written in full and shall contain the 'expected' line. */
+static int check_script(enum cmdlineflags_shell shell, const char* program, const char* expected)
+{
+    struct script script = {shell, program};
+    char output[2048];
+    int n;
+
+    n = read_output(write_script, &script, output, sizeof(output));
+
+    fprintf(stdout, "%s", output);
+
+    if ((n < 0) || ((size_t)n != strlen(output)) || (strstr(output, expected) == NULL))
+        return -1;
+
+    return strstr(output, CMDLINEFLAGS_COMPLETE_ENV "=") != NULL ? 0 : -1;
+}
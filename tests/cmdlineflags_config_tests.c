@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_config_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_name_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_j_option(const struct cmdlineflags_option* option, const char* argument);
+static int write_file(const char* path, const char* content);
+static int run_tests(const char* good, const char* bad);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_log_level_option, "sets log level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, name, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_name_option, "sets name");
+
+CMDLINEFLAGS_DEFINE(module_name, j, jobs, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_j_option, "sets number of jobs");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int verbosity = 0;
+static char log_level[32];
+/* Not copied, points into the configuration file for as long as it is kept. */
+static const char* name = NULL;
+/* All the values the jobs were set to, in order. */
+static char jobs[32];
+
+static const char good_config[] =
+    "# global options\n"
+    "verbose\n"
+    "  v = yes  \n"
+    "log-level = info\n"
+    "name = 'net dev'\n"
+    "\n"
+    "[module_name]\n"
+    "; jobs\n"
+    "j=2\r\n"
+    "jobs = \"3\"";
+
+static const char bad_config[] =
+    "verbose = maybe\n"
+    "unknown = 1\n"
+    "log_level\n"
+    "[unknown_module]\n"
+    "jobs = 1\n"
+    "[module_name\n"
+    "[module_name]\n"
+    "jobs = 5\n";
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    char directory[] = "/tmp/cmdlineflags_config_tests.XXXXXX";
+    char good[128];
+    char bad[128];
+
+    if (mkdtemp(directory) == NULL)
+        return retval;
+
+    snprintf(good, sizeof(good), "%s/good.conf", directory);
+    snprintf(bad, sizeof(bad), "%s/bad.conf", directory);
+
+    if ((write_file(good, good_config) == 0) && (write_file(bad, bad_config) == 0))
+        retval = run_tests(good, bad);
+
+    unlink(good);
+    unlink(bad);
+    rmdir(directory);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    verbosity++;
+    return 0;
+}
+
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    snprintf(log_level, sizeof(log_level), "%s", argument);
+    return 0;
+}
+
+static int handle_name_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    name = argument;
+    return 0;
+}
+
+static int handle_j_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    size_t n = strlen(jobs);
+
+    snprintf(jobs + n, sizeof(jobs) - n, "%s%s", n > 0 ? "," : "", argument);
+    return 0;
+}
+
+static int write_file(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "w");
+    int status;
+
+    if (file == NULL)
+        return -1;
+
+    status = fputs(content, file) < 0 ? -1 : 0;
+
+    if (fclose(file) != 0)
+        status = -1;
+
+    return status;
+}
+
+static int run_tests(const char* good, const char* bad)
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const argv[] = {"program", "-v", "module_name", "--jobs", "8", NULL};
+        int index;
+
+        if (setenv("TESTS_LOG_LEVEL", "debug", 1) != 0)
+            break;
+
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        parser.cfg.config_file = good;
+        parser.cfg.env_prefix = "TESTS";
+
+        /* Configuration file first, then the environment and the command line last. */
+        index = cmdlineflags_parse_r(&parser, 5, argv);
+        fprintf(stdout, "good: index: %d, n_errors: %u, verbosity: %d, log_level: %s, name: %s, jobs: %s\n",
+            index, parser.n_errors, verbosity, log_level, name, jobs);
+
+        if ((index != 5) || (parser.n_errors != 0) || (verbosity != 3) || strcmp(log_level, "debug"))
+            break;
+
+        if (strcmp(name, "net dev") || strcmp(jobs, "2,3,8"))
+            break;
+
+        cmdlineflags_parser_release(&parser);
+
+        parser.cfg.config_file = bad;
+        parser.cfg.env_prefix = NULL;
+        parser.cfg.emit_debug_messages = 0;
+        jobs[0] = '\0';
+
+        index = cmdlineflags_parse_r(&parser, 1, argv);
+        fprintf(stdout, "bad: index: %d, error: %d, error_index: %d, n_errors: %u, jobs: %s\n",
+            index, parser.error, parser.error_index, parser.n_errors, jobs);
+
+        if ((index != 1) || (parser.error != CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT) || (parser.error_index != 0))
+            break;
+
+        if ((parser.n_errors != 5) || strcmp(jobs, "5"))
+            break;
+
+        cmdlineflags_parser_release(&parser);
+
+        parser.cfg.config_file = "/nonexistent/cmdlineflags.conf";
+
+        index = cmdlineflags_parse_r(&parser, 1, argv);
+        if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_CONFIG_FILE))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_cxx_options.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Options defined in C, of the same module as the ones of cmdlineflags_cxx_tests.cpp.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+int build_level = 0;
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+CMDLINEFLAGS_DEFINE_INT(build, l, level, build_level, "sets optimization level");
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
@@ -0,0 +1,201 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_cxx_tests.cpp
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.hpp>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+/* Defined in cmdlineflags_cxx_options.c, along with the option of the 'build' module. */
+extern "C" int build_level;
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int parse(int argc, char* argv[], struct cmdlineflags_parser* parser);
+static void reset();
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static bool verbose = false;
+static int jobs = 0;
+static bool dry_run = false;
+static std::string_view target_name;
+static const char* output = nullptr;
+static uint64_t timeout_ns = 0;
+static double ratio = 0.0;
+static int n_arguments = -1;
+
+namespace lcf = lts::cmdlineflags;
+
+constexpr lcf::option verbose_option{lcf::global_module, 'v', "verbose", &verbose, "increases verbosity level"};
+constexpr lcf::option jobs_option{"build", 'j', "jobs", &jobs, "sets number of jobs"};
+constexpr lcf::option dry_run_option{"build", "dry-run", [] { dry_run = true; }, "does not apply any changes"};
+constexpr lcf::option name_option{"build", "name",
+    [](std::string_view name) { target_name = name; return name.empty() ? -1 : 0; }, "sets name of the target"};
+constexpr lcf::option output_option{"build", 'o', &output, "sets output file"};
+constexpr lcf::option timeout_option{"build", "timeout", lcf::duration{&timeout_ns}, "sets timeout"};
+constexpr lcf::option ratio_option{"build", 'r', "ratio", &ratio, "sets ratio"};
+constexpr lcf::option argc_option{"build", "argc",
+    [](struct cmdlineflags_parser& parser) { n_arguments = parser.argc; }, "counts all the arguments"};
+
+CMDLINEFLAGS_REGISTER(verbose_option);
+CMDLINEFLAGS_REGISTER(jobs_option);
+CMDLINEFLAGS_REGISTER(dry_run_option);
+CMDLINEFLAGS_REGISTER(name_option);
+CMDLINEFLAGS_REGISTER(output_option);
+CMDLINEFLAGS_REGISTER(timeout_option);
+CMDLINEFLAGS_REGISTER(ratio_option);
+CMDLINEFLAGS_REGISTER(argc_option);
+
+constexpr lcf::table<jobs_option, dry_run_option, name_option, output_option, timeout_option, ratio_option, argc_option> build_options;
+
+static_assert(build_options.module() == "build");
+static_assert(build_options.size() == 7);
+static_assert(build_options[0].shortoption == 'o');
+static_assert(build_options[1].longoption == "argc");
+static_assert(build_options[6].longoption == "timeout");
+static_assert(build_options.find("jobs") == 3);
+static_assert(build_options.find("dry_run") == 2);
+static_assert(build_options.find("job") == build_options.npos);
+static_assert(build_options.find("") == build_options.npos);
+static_assert(build_options.find('o') == 0);
+static_assert(build_options.find('r') == 5);
+static_assert(build_options.find('x') == build_options.npos);
+static_assert(build_options.find('\0') == build_options.npos);
+static_assert(build_options[build_options.find("name")].flags == CMDLINEFLAGS_REQUIRED_ARGUMENT);
+static_assert(build_options[build_options.find("argc")].flags == CMDLINEFLAGS_NO_ARGUMENT_R);
+static_assert(build_options[build_options.find("timeout")].flags == CMDLINEFLAGS_DURATION);
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char program[] = "program";
+        char v[] = "-v";
+        char build[] = "build";
+        char j[] = "-j";
+        char four[] = "4";
+        char dry_run_arg[] = "--dry_run";
+        char name_arg[] = "--name=target";
+        char o[] = "-o";
+        char out[] = "out";
+        char timeout_arg[] = "--timeout=2ms";
+        char ratio_arg[] = "--ratio";
+        char half[] = "0.5";
+        char level_arg[] = "--level=3";
+        char argc_arg[] = "--argc";
+        char empty_name_arg[] = "--name=";
+        char remaining[] = "remaining";
+        char* test_argv[] = {program, v, build, j, four, dry_run_arg, name_arg, o, out, timeout_arg,
+            ratio_arg, half, level_arg, argc_arg, remaining, nullptr};
+        char* failing_argv[] = {program, build, empty_name_arg, nullptr};
+        char help[4096];
+        int index;
+        int n;
+
+        reset();
+
+        index = parse(15, test_argv, &parser);
+
+        std::fprintf(stdout, "index: %d, errors: %u, verbose: %d, jobs: %d, dry_run: %d, name: %.*s, output: %s, "
+            "timeout: %llu, ratio: %g, level: %d, arguments: %d\n",
+            index, parser.n_errors, verbose, jobs, dry_run, static_cast<int>(target_name.size()), target_name.data(),
+            output != nullptr ? output : "(null)", static_cast<unsigned long long>(timeout_ns), ratio, build_level,
+            n_arguments);
+
+        if ((index != 14) || (parser.n_errors != 0))
+            break;
+
+        if (!verbose || (jobs != 4) || !dry_run || (target_name != "target") || (output == nullptr) || (std::strcmp(output, "out") != 0))
+            break;
+
+        if ((timeout_ns != 2000000) || (ratio != 0.5) || (build_level != 3) || (n_arguments != 15))
+            break;
+
+        reset();
+
+        /* The handler returns non zero value. */
+        parse(3, failing_argv, &parser);
+
+        std::fprintf(stdout, "errors: %u, error: %d\n", parser.n_errors, parser.error);
+
+        if ((parser.n_errors != 1) || (parser.error != CMDLINEFLAGS_ERROR_HANDLER))
+            break;
+
+        n = cmdlineflags_get_help_msg(help, sizeof(help), true);
+        if ((n <= 0) || (static_cast<size_t>(n) >= sizeof(help)))
+            break;
+
+        std::fprintf(stdout, "%s", help);
+
+        if ((std::strstr(help, "--dry-run") == nullptr) || (std::strstr(help, "sets number of jobs") == nullptr) ||
+            (std::strstr(help, "--level") == nullptr) || (std::strstr(help, "sets output file") == nullptr))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int parse(int argc, char* argv[], struct cmdlineflags_parser* parser)
+{
+    int index;
+
+    if (cmdlineflags_parser_init(parser, nullptr) != 0)
+        return -1;
+
+    index = cmdlineflags_parse_r(parser, argc, argv);
+    cmdlineflags_parser_release(parser);
+
+    return index;
+}
+
+static void reset()
+{
+    verbose = false;
+    jobs = 0;
+    dry_run = false;
+    target_name = std::string_view();
+    output = nullptr;
+    timeout_ns = 0;
+    ratio = 0.0;
+    build_level = 0;
+    n_arguments = -1;
+}
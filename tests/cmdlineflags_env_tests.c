@@ -0,0 +1,197 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_env_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_q_option(const struct cmdlineflags_option* option);
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_j_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_fail_option(const struct cmdlineflags_option* option);
+static int handle_dry_run_option(const struct cmdlineflags_option* option);
+static int handle_timeout_option(const struct cmdlineflags_option* option, const char* argument);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, q, quiet, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_q_option, "decreases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_log_level_option, "sets log level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, fail, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_fail_option, "fails");
+
+CMDLINEFLAGS_DEFINE(module_name, j, jobs, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_j_option, "sets number of jobs");
+
+/* Names with upper case letters are matched case insensitively too. */
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, dryRun, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_dry_run_option, "does not apply any changes");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(Net, Timeout, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_timeout_option, "sets timeout");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int verbosity = 0;
+static int jobs = 0;
+static char log_level[32];
+static int dry_run = 0;
+static int timeout = 0;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const test_argv[] = {"program", "-v", "module_name", "--jobs", "8", "remaining", NULL};
+        int index;
+
+        if ((setenv("TESTS_VERBOSE", "yes", 1) != 0) ||
+            (setenv("TESTS_QUIET", "off", 1) != 0) ||
+            (setenv("TESTS_Log_Level", "debug", 1) != 0) ||
+            (setenv("TESTS_MODULE_NAME_JOBS", "4", 1) != 0) ||
+            (setenv("TESTS_DRYRUN", "1", 1) != 0) ||
+            (setenv("TESTS_NET_TIMEOUT", "5", 1) != 0) ||
+            (setenv("TESTS_UNKNOWN", "1", 1) != 0) ||
+            (setenv("TESTSVERBOSE", "1", 1) != 0) ||
+            (setenv("OTHER_VERBOSE", "1", 1) != 0))
+            break;
+
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        parser.cfg.env_prefix = "TESTS";
+
+        /* Command line comes after the environment, so the last jobs are taken from it. */
+        index = cmdlineflags_parse_r(&parser, 6, test_argv);
+        fprintf(stdout, "index: %d, verbosity: %d, jobs: %d, log_level: %s, dry_run: %d, timeout: %d, n_errors: %u\n",
+            index, verbosity, jobs, log_level, dry_run, timeout, parser.n_errors);
+
+        if ((index != 5) || (parser.n_errors != 0) || (verbosity != 2) || (jobs != 8) || strcmp(log_level, "debug"))
+            break;
+
+        if ((dry_run != 1) || (timeout != 5))
+            break;
+
+        /* Without the prefix the environment is not looked at. */
+        parser.cfg.env_prefix = NULL;
+        verbosity = 0;
+
+        index = cmdlineflags_parse_r(&parser, 2, test_argv);
+        if ((index != 2) || (verbosity != 1))
+            break;
+
+        parser.cfg.env_prefix = "TESTS";
+        parser.cfg.emit_debug_messages = 0;
+
+        jobs = 0;
+
+        if (setenv("TESTS_QUIET", "maybe", 1) != 0)
+            break;
+
+        index = cmdlineflags_parse_r(&parser, 2, test_argv);
+        fprintf(stdout, "error: %d, error_index: %d\n", parser.error, parser.error_index);
+
+        /* Options of the modules are taken from the environment even if the module is not given. */
+        if ((index != 2) || (parser.error != CMDLINEFLAGS_ERROR_UNEXPECTED_ARGUMENT) || (parser.error_index != 0) || (jobs != 4))
+            break;
+
+        if ((setenv("TESTS_QUIET", "0", 1) != 0) || (setenv("TESTS_FAIL", "on", 1) != 0))
+            break;
+
+        index = cmdlineflags_parse_r(&parser, 2, test_argv);
+        fprintf(stdout, "error: %d, error_index: %d\n", parser.error, parser.error_index);
+
+        if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_HANDLER) || (parser.error_index != 0))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    verbosity++;
+    return 0;
+}
+
+static int handle_q_option(const struct cmdlineflags_option* option)
+{
+    verbosity--;
+    return 0;
+}
+
+static int handle_log_level_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    snprintf(log_level, sizeof(log_level), "%s", argument);
+    return 0;
+}
+
+static int handle_j_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    jobs = atoi(argument);
+    return 0;
+}
+
+static int handle_fail_option(const struct cmdlineflags_option* option)
+{
+    return -1;
+}
+
+static int handle_dry_run_option(const struct cmdlineflags_option* option)
+{
+    dry_run++;
+    return 0;
+}
+
+static int handle_timeout_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    timeout = atoi(argument);
+    return 0;
+}
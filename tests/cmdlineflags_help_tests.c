@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_help_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_option(const struct cmdlineflags_option* option);
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument);
+static int check_help(bool sort);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_SHORT_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, q, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "decreases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, log_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument, "sets log level");
+
+CMDLINEFLAGS_DEFINE(module_name, c, configuration, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_option_with_argument,
+   "reads configuration from the given file instead of the default one, which is looked up in the current directory");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, dry_run, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "does not apply any changes");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, option_name_which_does_not_fit_into_the_prefix_column, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_option, "is listed anyway");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        if (check_help(false) != 0)
+            break;
+
+        if (check_help(true) != 0)
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_option(const struct cmdlineflags_option* option)
+{
+    return 0;
+}
+
+static int handle_option_with_argument(const struct cmdlineflags_option* option, const char* argument)
+{
+    return 0;
+}
+
+/* All the ways of getting help message shall produce exactly the same text. */
+static int check_help(bool sort)
+{
+    int retval = -1;
+    char* help_message = NULL;
+    char* written_message = NULL;
+    FILE* file = NULL;
+    char truncated_message[16];
+
+    do {
+        int n;
+        int status;
+
+        n = cmdlineflags_get_help_msg(NULL, 0, sort);
+        if (n <= 0)
+            break;
+
+        help_message = malloc(n + 1);
+        written_message = malloc(n + 1);
+        if ((help_message == NULL) || (written_message == NULL))
+            break;
+
+        status = cmdlineflags_get_help_msg(help_message, n + 1, sort);
+        if ((status != n) || (strlen(help_message) != (size_t)n))
+            break;
+
+        fprintf(stdout, "%s", help_message);
+
+        if (strstr(help_message, "   -v, --verbose                            : increases verbosity level\n") == NULL)
+            break;
+
+        if (strstr(help_message, "   --option-name-which-does-not-fit-into-the-prefix-column : is listed anyway\n") == NULL)
+            break;
+
+        status = cmdlineflags_get_help_msg(truncated_message, sizeof(truncated_message), sort);
+        if ((status != n) || (strncmp(truncated_message, help_message, sizeof(truncated_message) - 1)) ||
+            (truncated_message[sizeof(truncated_message) - 1] != '\0'))
+            break;
+
+        file = tmpfile();
+        if (file == NULL)
+            break;
+
+        status = cmdlineflags_write_help(fileno(file), sort);
+        if (status != n)
+            break;
+
+        status = cmdlineflags_fwrite_help(file, sort);
+        if (status != n)
+            break;
+
+        rewind(file);
+
+        if ((fread(written_message, 1, n, file) != (size_t)n) || memcmp(written_message, help_message, n))
+            break;
+
+        if ((fread(written_message, 1, n, file) != (size_t)n) || memcmp(written_message, help_message, n))
+            break;
+
+        if (cmdlineflags_write_help(-1, sort) >= 0)
+            break;
+
+        retval = 0;
+    } while (0);
+
+    if (file != NULL)
+        fclose(file);
+
+    free(written_message);
+    free(help_message);
+
+    return retval;
+}
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_line_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct tokenize_test {
+    const char* line;
+    int argc;
+    const char* argv[8];
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_module_option(const struct cmdlineflags_option* option, const char* argument);
+static int run_tokenize_test(const struct tokenize_test* test);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(stats, module, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_module_option, "selects module");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int v_option_actual_cnt = 0;
+static char module_option_argument[64];
+
+static const struct tokenize_test tokenize_tests[] = {
+    {"", 0, {NULL}},
+    {" \t ", 0, {NULL}},
+    {"stats --module=net -v", 3, {"stats", "--module=net", "-v"}},
+    {"  stats   -v  ", 2, {"stats", "-v"}},
+    {"cmd 'single quoted' \"double quoted\"", 3, {"cmd", "single quoted", "double quoted"}},
+    {"cmd a\\ b 'it'\\''s' \"\\\"\\\\\\n\"", 4, {"cmd", "a b", "it's", "\"\\\\n"}},
+    {"cmd '' \"\" x\"y\"'z'", 4, {"cmd", "", "", "xyz"}},
+    {"cmd 'unterminated", -1, {NULL}},
+    {"cmd \"unterminated", -1, {NULL}},
+    {"cmd trailing\\", -1, {NULL}},
+    {"a b c d e f g h", -1, {NULL}},
+};
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        char line[] = "stats -v -v 'stats' --module \"net dev\" remaining 'arguments'";
+        char* line_argv[16];
+        size_t i;
+        int index;
+
+        for (i = 0; i < ARRAY_SIZE(tokenize_tests); ++i)
+            if (run_tokenize_test(&tokenize_tests[i]) != 0)
+                break;
+
+        if (i != ARRAY_SIZE(tokenize_tests))
+            break;
+
+        index = cmdlineflags_parse_line(NULL, line, line_argv, ARRAY_SIZE(line_argv));
+        fprintf(stdout, "cmdlineflags_parse_line: first nonoption argument: %d\n", index);
+        fprintf(stdout, "cmdlineflags_parse_line: v_option_actual_cnt: %d\n", v_option_actual_cnt);
+        fprintf(stdout, "cmdlineflags_parse_line: module: %s\n", module_option_argument);
+
+        if ((index != 6) || strcmp(line_argv[index], "remaining") || strcmp(line_argv[index + 1], "arguments"))
+            break;
+
+        if ((v_option_actual_cnt != 2) || strcmp(module_option_argument, "net dev"))
+            break;
+
+        /* Without the argv only the options are handled, nothing is left pointing to the internal one. */
+        {
+            struct cmdlineflags_parser parser;
+            char options_line[] = "prog -v stats --module=disk remaining";
+            char global_line[] = "prog -v stats remaining";
+            char* const* args;
+
+            if (cmdlineflags_parser_init(&parser, NULL) != 0)
+                break;
+
+            index = cmdlineflags_parse_line(&parser, options_line, NULL, 0);
+            cmdlineflags_parser_release(&parser);
+
+            if ((index != 4) || (parser.argv != NULL) || (parser.argc != 0) || strcmp(module_option_argument, "disk"))
+                break;
+
+            index = cmdlineflags_parse_line(NULL, global_line, NULL, 0);
+
+            if ((index != 3) || (cmdlineflags_get_args(&args) != 0) || (args != NULL) || (v_option_actual_cnt != 4))
+                break;
+
+            cmdlineflags_release();
+        }
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    v_option_actual_cnt++;
+    return 0;
+}
+
+static int handle_module_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    snprintf(module_option_argument, sizeof(module_option_argument), "%s", argument);
+    return 0;
+}
+
+static int run_tokenize_test(const struct tokenize_test* test)
+{
+    char line[128];
+    char* argv[ARRAY_SIZE(test->argv)];
+    int argc;
+    int i;
+
+    snprintf(line, sizeof(line), "%s", test->line);
+
+    argc = cmdlineflags_tokenize_line(line, argv, ARRAY_SIZE(argv));
+    fprintf(stdout, "cmdlineflags_tokenize_line(%s): %d\n", test->line, argc);
+
+    if (argc != test->argc)
+        return -1;
+
+    for (i = 0; i < argc; ++i)
+        if (strcmp(argv[i], test->argv[i]))
+            return -1;
+
+    if ((argc >= 0) && (argv[argc] != NULL))
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_nested_module_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_now_option(const struct cmdlineflags_option* option);
+static int parse(int argc, char* const argv[], int inherit_options, struct cmdlineflags_parser* parser);
+static void reset(void);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int verbosity = 0;
+static const char* cluster_name = NULL;
+static int node_timeout = 0;
+static bool drain_force = false;
+static bool drain_now = false;
+static bool list_all = false;
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_STRING(cluster, n, name, cluster_name, "sets name of the cluster");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(cluster__node, timeout, \
+   CMDLINEFLAGS_INT, &node_timeout, "sets timeout of the node");
+
+CMDLINEFLAGS_DEFINE_BOOL(cluster__node__drain, f, force, drain_force, "drains the node forcefully");
+
+/* Shadows the option of the 'cluster' module. */
+CMDLINEFLAGS_DEFINE(cluster__node__drain, n, now, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_now_option, "drains the node now");
+
+/* Neither 'fleet' nor 'fleet region' owns any options. */
+CMDLINEFLAGS_DEFINE_BOOL(fleet__region__list, a, all, list_all, "lists all the regions");
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const drain_argv[] = {"program", "-v", "cluster", "--name", "c1", "node", "--timeout=5", "drain", "-f", "--verbose", "-n", "--", "node", NULL};
+        char* const list_argv[] = {"program", "fleet", "region", "list", "-av", "extra", NULL};
+        char* const sibling_argv[] = {"program", "cluster", "drain", "-f", NULL};
+        char* const path_argv[] = {"program", "cluster__node", "--timeout=1", NULL};
+        char help[2048];
+        int index;
+
+        index = parse(ARRAY_SIZE(drain_argv) - 1, drain_argv, 1, &parser);
+        fprintf(stdout, "drain: index: %d, n_errors: %u, verbosity: %d, name: %s, timeout: %d, force: %d, now: %d\n",
+            index, parser.n_errors, verbosity, cluster_name, node_timeout, drain_force, drain_now);
+
+        if ((index != 12) || (parser.n_errors != 0) || (verbosity != 2) || (cluster_name != drain_argv[4]) ||
+            (node_timeout != 5) || !drain_force || !drain_now)
+            break;
+
+        index = parse(ARRAY_SIZE(list_argv) - 1, list_argv, 1, &parser);
+        fprintf(stdout, "list: index: %d, n_errors: %u, verbosity: %d, all: %d\n", index, parser.n_errors, verbosity, list_all);
+
+        if ((index != 5) || (parser.n_errors != 0) || (verbosity != 1) || !list_all)
+            break;
+
+        /* Options of the ancestors are not inherited unless asked for. */
+        index = parse(ARRAY_SIZE(list_argv) - 1, list_argv, 0, &parser);
+        if ((index != 5) || (parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (parser.error_index != 4) || (verbosity != 0))
+            break;
+
+        /* Modules nested in other modules are not top level modules, nor the siblings of their parents. */
+        index = parse(ARRAY_SIZE(sibling_argv) - 1, sibling_argv, 1, &parser);
+        if ((index != 2) || (parser.n_errors != 0) || drain_force)
+            break;
+
+        index = parse(ARRAY_SIZE(path_argv) - 1, path_argv, 1, &parser);
+        if ((index != 3) || (parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (node_timeout != 0))
+            break;
+
+        if (cmdlineflags_get_help_msg(help, sizeof(help), true) < 0)
+            break;
+
+        fprintf(stdout, "%s", help);
+
+        if ((strstr(help, "\ncluster node drain\n") == NULL) || (strstr(help, "\nfleet region list\n") == NULL) ||
+            (strstr(help, "\nfleet\n") != NULL))
+            break;
+
+        if (cmdlineflags_get_module_help_msg("cluster__node__drain", help, sizeof(help), true) <= 0)
+            break;
+
+        if ((strstr(help, "--force") == NULL) || (strstr(help, "--name") != NULL))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    verbosity++;
+    return 0;
+}
+
+static int handle_now_option(const struct cmdlineflags_option* option)
+{
+    drain_now = true;
+    return 0;
+}
+
+static int parse(int argc, char* const argv[], int inherit_options, struct cmdlineflags_parser* parser)
+{
+    reset();
+
+    if (cmdlineflags_parser_init(parser, NULL) != 0)
+        return -1;
+
+    parser->cfg.emit_debug_messages = 0;
+    parser->cfg.inherit_options = inherit_options;
+
+    return cmdlineflags_parse_r(parser, argc, argv);
+}
+
+static void reset(void)
+{
+    verbosity = 0;
+    cluster_name = NULL;
+    node_timeout = 0;
+    drain_force = false;
+    drain_now = false;
+    list_all = false;
+}
@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_no_malloc_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Built along with the library compiled with CMDLINEFLAGS_NO_MALLOC.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define N_PARSES 1000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static int write_file(const char* path, const char* content);
+static int run_tests(const char* response_file);
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, I, include, \
+   CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT, handle_include_option, "adds include directory");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static unsigned n_heap_allocations = 0;
+static unsigned include_count = 0;
+static double ratio = 0.0;
+static bool verbose = false;
+
+CMDLINEFLAGS_DEFINE_DOUBLE(CMDLINEFLAGS_GLOBAL_MODULE, r, ratio, ratio, "sets ratio");
+CMDLINEFLAGS_DEFINE_BOOL(module_name, v, verbose, verbose, "increases verbosity level");
+
+/* Everything the library needs, the lookup index included. */
+static char scratch[64 * 1024];
+static char help[4096];
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+void* malloc(size_t size)
+{
+    n_heap_allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    n_heap_allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    n_heap_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    char directory[] = "/tmp/cmdlineflags_no_malloc_tests.XXXXXX";
+    char path[128];
+
+    if (mkdtemp(directory) == NULL)
+        return retval;
+
+    snprintf(path, sizeof(path), "%s/args", directory);
+
+    if (write_file(path, "-I b\n--include=c -r 1e-300\n") == 0)
+        retval = run_tests(path);
+
+    unlink(path);
+    rmdir(directory);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int write_file(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "w");
+    int status;
+
+    if (file == NULL)
+        return -1;
+
+    status = fputs(content, file) < 0 ? -1 : 0;
+
+    if (fclose(file) != 0)
+        status = -1;
+
+    return status;
+}
+
+static int run_tests(const char* response_file)
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char at_file[160];
+        char* test_argv[] = {"program", "-Ia", at_file, "--rat", "0.25", "module_name", "--verb", "remaining", NULL};
+        int index = -1;
+        int n;
+        int i;
+
+        snprintf(at_file, sizeof(at_file), "@%s", response_file);
+
+        /* Allocates the buffer of the stdout, before the heap allocations are counted. */
+        fprintf(stdout, "cmdlineflags_set_scratch\n");
+
+        n_heap_allocations = 0;
+
+        if (cmdlineflags_set_scratch(NULL, sizeof(scratch)) == 0)
+            break;
+
+        if (cmdlineflags_set_scratch(scratch, sizeof(scratch)) != 0)
+            break;
+
+        /* All but the lookup index is given back to the scratch, so it is never used up. */
+        for (i = 0; i < N_PARSES; ++i) {
+            if (cmdlineflags_parser_init(&parser, NULL) != 0)
+                break;
+
+            parser.cfg.expand_response_files = 1;
+            parser.cfg.allow_abbreviations = 1;
+
+            include_count = 0;
+            ratio = 0.0;
+            verbose = false;
+
+            index = cmdlineflags_parse_r(&parser, 8, test_argv);
+            cmdlineflags_parser_release(&parser);
+
+            if ((index != 11) || (parser.n_errors != 0) || (include_count != 3) || (ratio != 0.25) || !verbose)
+                break;
+        }
+
+        n = cmdlineflags_get_help_msg(help, sizeof(help), true);
+
+        fprintf(stdout, "parses: %d, index: %d, includes: %u, ratio: %g, verbose: %d, help: %d, heap allocations: %u\n",
+            i, index, include_count, ratio, verbose, n, n_heap_allocations);
+
+        if ((i != N_PARSES) || (n <= 0) || ((size_t)n >= sizeof(help)) || (strstr(help, "--include") == NULL))
+            break;
+
+        if (n_heap_allocations != 0)
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count)
+{
+    include_count = count;
+    return 0;
+}
@@ -0,0 +1,349 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_parallel_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* How long the handlers wait for each other before giving up. */
+#define RENDEZVOUS_TIMEOUT_S 5
+
+#define N_REPEATS 20
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int parse(int argc, char* argv[], struct cmdlineflags_parser* parser);
+static int test_concurrency(void);
+static int test_ordering(void);
+static int test_failures(void);
+static int test_first_failure(void);
+static int test_fork(void);
+static int test_register(void);
+static int handle_load_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_check_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_step_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_output_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_fork_option(const struct cmdlineflags_option* option);
+static int handle_x_option(const struct cmdlineflags_option* option);
+static int handle_register_option(const struct cmdlineflags_option* option, const char* argument);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, l, load, \
+   CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT, handle_load_option, "loads the file (waiting for the other loads)");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, c, check, \
+   CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT, handle_check_option, "checks the file");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, s, step, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_step_option, "adds the step");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, o, output, \
+   CMDLINEFLAGS_LAST_REQUIRED_ARGUMENT, handle_output_option, "sets the output");
+
+CMDLINEFLAGS_DEFINE_SHORT_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, x, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_x_option, "fails");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, f, fork, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_fork_option, "forks the process");
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, r, register, \
+   CMDLINEFLAGS_PARALLEL_REQUIRED_ARGUMENT, handle_register_option, "registers the sections (which shall be refused)");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static unsigned n_loads;
+static unsigned n_expected_loads;
+
+static unsigned n_checks;
+static char steps[16];
+static size_t n_steps;
+/* Number of the checks done when the output was delivered or -1 if it was not. */
+static int checks_at_output;
+/* Process forked by the fork option (0 in the child itself). */
+static pid_t forked = -1;
+static const struct cmdlineflags_sections no_sections;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+static inline void sleep_ms(long ms)
+{
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+
+    nanosleep(&ts, NULL);
+}
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        if (test_concurrency() != 0)
+            break;
+
+        if (test_ordering() != 0)
+            break;
+
+        if (test_failures() != 0)
+            break;
+
+        if (test_first_failure() != 0)
+            break;
+
+        if (test_fork() != 0)
+            break;
+
+        if (test_register() != 0)
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int parse(int argc, char* argv[], struct cmdlineflags_parser* parser)
+{
+    int index;
+
+    n_loads = 0;
+    n_checks = 0;
+    n_steps = 0;
+    steps[0] = '\0';
+    checks_at_output = -1;
+
+    if (cmdlineflags_parser_init(parser, NULL) != 0)
+        return -2;
+
+    parser->cfg.emit_debug_messages = 0;
+
+    index = cmdlineflags_parse_r(parser, argc, argv);
+    cmdlineflags_parser_release(parser);
+
+    return index;
+}
+
+/* None of the loads is done until all of them have started, which takes more than one thread. */
+static int test_concurrency(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "--load", "a", "-l", "b", "--load=c", NULL};
+    int index;
+
+    n_expected_loads = 3;
+
+    index = parse(6, test_argv, &parser);
+
+    fprintf(stdout, "index: %d, errors: %u, loads: %u\n", index, parser.n_errors, n_loads);
+
+    return ((index == 6) && (parser.n_errors == 0) && (n_loads == 3)) ? 0 : -1;
+}
+
+/* Other handlers are called in order, the deferred ones after all the parallel ones are done. */
+static int test_ordering(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "-s1", "--check", "x", "--output", "o", "-s", "2", "-cy", "--step=3", "-c", "z", NULL};
+    int index;
+    int i;
+
+    for (i = 0; i < N_REPEATS; ++i) {
+        index = parse(12, test_argv, &parser);
+
+        if ((index != 12) || (parser.n_errors != 0) || strcmp(steps, "123") || (n_checks != 3) || (checks_at_output != 3)) {
+            fprintf(stdout, "index: %d, errors: %u, steps: '%s', checks: %u (%d)\n", index, parser.n_errors, steps, n_checks, checks_at_output);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* The first of the failed handlers (in order of the options) is reported, whichever finished first. */
+static int test_failures(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "-c", "ok", "--check", "bad-slow", "--output", "o", "-s1", "--check=bad", NULL};
+    int index;
+    int i;
+
+    for (i = 0; i < N_REPEATS; ++i) {
+        index = parse(9, test_argv, &parser);
+
+        if ((index != CMDLINEFLAGS_FAILURE) || (parser.n_errors != 2) || (parser.error != CMDLINEFLAGS_ERROR_HANDLER) ||
+            (parser.error_index != 4) || (n_checks != 3) || strcmp(steps, "1") || (checks_at_output != -1)) {
+            fprintf(stdout, "index: %d, errors: %u, error: %d at %d, checks: %u (%d)\n",
+                index, parser.n_errors, parser.error, parser.error_index, n_checks, checks_at_output);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* The failed parallel handler goes first, even though it is known to have failed after the ordinary one. */
+static int test_first_failure(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "-c", "bad-slow", "-x", NULL};
+    int index;
+
+    index = parse(4, test_argv, &parser);
+
+    if ((index != CMDLINEFLAGS_FAILURE) || (parser.n_errors != 2) || (parser.error != CMDLINEFLAGS_ERROR_HANDLER) ||
+        (parser.error_index != 2) || (n_checks != 1)) {
+        fprintf(stdout, "index: %d, errors: %u, error: %d at %d, checks: %u\n",
+            index, parser.n_errors, parser.error, parser.error_index, n_checks);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* The child, with the slow check running (or not yet taken) at the time of fork(), finishes the parsing too,
+   with that check failed (or run by itself). */
+static int test_fork(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "-c", "ok-slow", "-c", "x", "--fork", "-c", "y", NULL};
+    int index;
+    int status;
+
+    index = parse(8, test_argv, &parser);
+
+    if (forked == 0)
+        _exit(((index == 8) || ((index == CMDLINEFLAGS_FAILURE) && (parser.error == CMDLINEFLAGS_ERROR_HANDLER) &&
+            (parser.error_index == 2))) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if ((forked < 0) || (waitpid(forked, &status, 0) != forked)) {
+        fprintf(stdout, "cannot fork or wait for the child\n");
+        return -1;
+    }
+
+    if ((index != 8) || (parser.n_errors != 0) || (n_checks != 3) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        fprintf(stdout, "index: %d, errors: %u, checks: %u, child status: 0x%x\n", index, parser.n_errors, n_checks, status);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Registration from within a parallel handler is refused, as it would wait for the parser waiting for the handler. */
+static int test_register(void)
+{
+    struct cmdlineflags_parser parser;
+    char* test_argv[] = {"program", "--register", "x", NULL};
+    int index;
+
+    index = parse(3, test_argv, &parser);
+
+    fprintf(stdout, "index: %d, errors: %u\n", index, parser.n_errors);
+
+    return ((index == 3) && (parser.n_errors == 0)) ? 0 : -1;
+}
+
+static int handle_load_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    struct timespec deadline;
+    int status = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RENDEZVOUS_TIMEOUT_S;
+
+    pthread_mutex_lock(&mutex);
+
+    if (++n_loads == n_expected_loads)
+        pthread_cond_broadcast(&cond);
+
+    while ((n_loads < n_expected_loads) && (status == 0))
+        status = pthread_cond_timedwait(&cond, &mutex, &deadline);
+
+    pthread_mutex_unlock(&mutex);
+
+    return status;
+}
+
+static int handle_check_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    if (strstr(argument, "slow") != NULL)
+        sleep_ms(20);
+
+    __atomic_fetch_add(&n_checks, 1, __ATOMIC_RELAXED);
+
+    return strncmp(argument, "bad", 3) ? 0 : -1;
+}
+
+static int handle_step_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    if (n_steps + 1 < sizeof(steps)) {
+        steps[n_steps++] = argument[0];
+        steps[n_steps] = '\0';
+    }
+
+    return 0;
+}
+
+static int handle_output_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    checks_at_output = __atomic_load_n(&n_checks, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+static int handle_fork_option(const struct cmdlineflags_option* option)
+{
+    forked = fork();
+
+    /* A child stuck waiting for the jobs is killed. */
+    if (forked == 0)
+        alarm(RENDEZVOUS_TIMEOUT_S);
+
+    return forked < 0 ? -1 : 0;
+}
+
+static int handle_register_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    /* Would never return if it was not refused. */
+    return cmdlineflags_register(&no_sections) == CMDLINEFLAGS_FAILURE ? 0 : -1;
+}
+
+static int handle_x_option(const struct cmdlineflags_option* option)
+{
+    return -1;
+}
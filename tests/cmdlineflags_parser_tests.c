@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_parser_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define N_THREADS    8
+#define N_ITERATIONS 1000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct context {
+    int id;
+    int verbosity;
+    int jobs;
+    int n_failures;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option);
+static int handle_j_option(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option, const char* argument);
+static void* parse(void* arg);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT_R, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE(module_name, j, jobs, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT_R, handle_j_option, "sets number of jobs");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        pthread_t threads[N_THREADS];
+        struct context contexts[N_THREADS];
+        struct cmdlineflags_parser parser;
+        char* invalid_argv[] = {"program", "-v", "--unknown", "module_name", "--jobs", NULL};
+        int i;
+
+        memset(contexts, 0, sizeof(contexts));
+
+        for (i = 0; i < N_THREADS; ++i) {
+            contexts[i].id = i;
+            if (pthread_create(&threads[i], NULL, parse, &contexts[i]) != 0)
+                break;
+        }
+
+        if (i != N_THREADS)
+            break;
+
+        for (i = 0; i < N_THREADS; ++i)
+            pthread_join(threads[i], NULL);
+
+        for (i = 0; i < N_THREADS; ++i) {
+            fprintf(stdout, "thread %d: verbosity: %d, jobs: %d, failures: %d\n",
+                i, contexts[i].verbosity, contexts[i].jobs, contexts[i].n_failures);
+            if ((contexts[i].n_failures != 0) || (contexts[i].verbosity != (i % 3) * N_ITERATIONS) || (contexts[i].jobs != i))
+                break;
+        }
+
+        if (i != N_THREADS)
+            break;
+
+        /* Errors are recorded in the parser, the first one wins. */
+        if (cmdlineflags_parser_init(&parser, &contexts[0]) != 0)
+            break;
+
+        parser.cfg.emit_debug_messages = 0;
+
+        if (cmdlineflags_parse_r(&parser, 5, invalid_argv) != 5)
+            break;
+
+        fprintf(stdout, "error: %d, error_index: %d, n_errors: %u\n", parser.error, parser.error_index, parser.n_errors);
+
+        if ((parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (parser.error_index != 2) || (parser.n_errors != 2))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option)
+{
+    struct context* context = parser->user;
+
+    context->verbosity++;
+    return 0;
+}
+
+static int handle_j_option(struct cmdlineflags_parser* parser, const struct cmdlineflags_option* option, const char* argument)
+{
+    struct context* context = parser->user;
+
+    context->jobs = atoi(argument);
+    return 0;
+}
+
+/* Every thread parses its own command line (-v repeated id % 3 times, then '--jobs <id>') over and over again. */
+static void* parse(void* arg)
+{
+    static char* const verbosity[] = {NULL, "-v", "-vv"};
+    struct context* context = arg;
+    struct cmdlineflags_parser parser;
+    char jobs[16];
+    char* argv[8];
+    int argc = 0;
+    int i;
+
+    snprintf(jobs, sizeof(jobs), "%d", context->id);
+
+    argv[argc++] = "program";
+    if (verbosity[context->id % 3] != NULL)
+        argv[argc++] = verbosity[context->id % 3];
+    argv[argc++] = "module_name";
+    argv[argc++] = "--jobs";
+    argv[argc++] = jobs;
+    argv[argc++] = "next";
+    argv[argc] = NULL;
+
+    for (i = 0; i < N_ITERATIONS; ++i) {
+        if ((cmdlineflags_parser_init(&parser, context) != 0) ||
+            (cmdlineflags_parse_r(&parser, argc, argv) != argc - 1) ||
+            (parser.n_errors != 0))
+            context->n_failures++;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_plugin.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * Plugin loaded with dlopen() by cmdlineflags_plugin_tests, defining options of its own.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdlib.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+int plugin_level = 0;
+int plugin_pings = 0;
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_plugin_level_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_p_option(const struct cmdlineflags_option* option);
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, plugin_level, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_plugin_level_option, "sets level of the plugin");
+
+CMDLINEFLAGS_DEFINE(plugin, p, ping, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_p_option, "pings the plugin");
+
+CMDLINEFLAGS_DEFINE_SECTIONS(plugin_sections);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int plugin_init(void)
+{
+    return cmdlineflags_register(&plugin_sections);
+}
+
+int plugin_exit(void)
+{
+    return cmdlineflags_unregister(&plugin_sections);
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_plugin_level_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    plugin_level = atoi(argument);
+    return 0;
+}
+
+static int handle_p_option(const struct cmdlineflags_option* option)
+{
+    __atomic_add_fetch(&plugin_pings, 1, __ATOMIC_RELAXED);
+    return 0;
+}
@@ -0,0 +1,256 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_plugin_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * usage: cmdlineflags_plugin_tests <path of cmdlineflags_plugin>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define N_THREADS 4
+#define N_PARSES 2000
+#define N_REGISTRATIONS 200
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct plugin {
+    void* handle;
+    int (*init)(void);
+    int (*exit)(void);
+    int* level;
+    int* pings;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_register_option(const struct cmdlineflags_option* option);
+static int parse(int argc, char* const argv[], struct cmdlineflags_parser* parser);
+static void* parse_thread(void* arg);
+static int run_tests(struct plugin* plugin);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, register, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_register_option, "registers the plugin from within the handler");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int verbosity = 0;
+static struct plugin* the_plugin = NULL;
+static int register_status = 0;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    struct plugin plugin;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <path of cmdlineflags_plugin>\n", argv[0]);
+        return retval;
+    }
+
+    plugin.handle = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+    if (plugin.handle == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return retval;
+    }
+
+    *(void**)&plugin.init = dlsym(plugin.handle, "plugin_init");
+    *(void**)&plugin.exit = dlsym(plugin.handle, "plugin_exit");
+    plugin.level = dlsym(plugin.handle, "plugin_level");
+    plugin.pings = dlsym(plugin.handle, "plugin_pings");
+
+    if ((plugin.init != NULL) && (plugin.exit != NULL) && (plugin.level != NULL) && (plugin.pings != NULL))
+        retval = run_tests(&plugin);
+
+    dlclose(plugin.handle);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    __atomic_add_fetch(&verbosity, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static int handle_register_option(const struct cmdlineflags_option* option)
+{
+    register_status = the_plugin->init();
+    return 0;
+}
+
+static int parse(int argc, char* const argv[], struct cmdlineflags_parser* parser)
+{
+    if (cmdlineflags_parser_init(parser, NULL) != 0)
+        return -1;
+
+    parser->cfg.emit_debug_messages = 0;
+
+    return cmdlineflags_parse_r(parser, argc, argv);
+}
+
+static void* parse_thread(void* arg)
+{
+    char* const argv[] = {"program", "-v", "plugin", "--ping", NULL};
+    int* failures = arg;
+    int i;
+
+    /* Depending on the moment, the plugin module is either known or not, but the parsing always completes. */
+    for (i = 0; i < N_PARSES; ++i) {
+        struct cmdlineflags_parser parser;
+        int index = parse(4, argv, &parser);
+
+        if ((index != 4) || ((parser.n_errors != 0) && (parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION)))
+            (*failures)++;
+    }
+
+    return NULL;
+}
+
+static int run_tests(struct plugin* plugin)
+{
+    int retval = -1;
+
+    the_plugin = plugin;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const argv[] = {"program", "-v", "--plugin-level=3", "plugin", "-p", "--ping", NULL};
+        char* const register_argv[] = {"program", "--register", NULL};
+        pthread_t threads[N_THREADS];
+        int failures[N_THREADS] = {0};
+        char* help;
+        int index;
+        int pings;
+        int n;
+        int i;
+
+        index = parse(6, argv, &parser);
+        fprintf(stdout, "before: index: %d, error: %d, error_index: %d\n", index, parser.error, parser.error_index);
+
+        if ((parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (parser.error_index != 2) || (*plugin->pings != 0))
+            break;
+
+        if (plugin->init() != 0)
+            break;
+
+        /* The same sections cannot be registered twice. */
+        if (plugin->init() == 0)
+            break;
+
+        index = parse(6, argv, &parser);
+        fprintf(stdout, "registered: index: %d, n_errors: %u, level: %d, pings: %d\n",
+            index, parser.n_errors, *plugin->level, *plugin->pings);
+
+        if ((index != 6) || (parser.n_errors != 0) || (*plugin->level != 3) || (*plugin->pings != 2))
+            break;
+
+        n = cmdlineflags_get_help_msg(NULL, 0, true);
+        if (n <= 0)
+            break;
+
+        help = malloc(n + 1);
+        if (help == NULL)
+            break;
+
+        if (cmdlineflags_get_help_msg(help, n + 1, true) != n) {
+            free(help);
+            break;
+        }
+
+        fprintf(stdout, "%s", help);
+
+        if ((strstr(help, "--plugin-level") == NULL) || (strstr(help, "--ping") == NULL) || (strstr(help, "--verbose") == NULL)) {
+            free(help);
+            break;
+        }
+
+        free(help);
+
+        /* Handlers run while the registry is being read, so it cannot be changed from within them. */
+        index = parse(2, register_argv, &parser);
+        if ((index != 2) || (register_status == 0))
+            break;
+
+        for (i = 0; i < N_THREADS; ++i)
+            if (pthread_create(&threads[i], NULL, parse_thread, &failures[i]) != 0)
+                break;
+
+        if (i == N_THREADS) {
+            int j;
+
+            for (j = 0; j < N_REGISTRATIONS; ++j)
+                if ((plugin->exit() != 0) || (plugin->init() != 0))
+                    break;
+
+            if (j != N_REGISTRATIONS)
+                failures[0]++;
+        }
+
+        while (i-- > 0)
+            pthread_join(threads[i], NULL);
+
+        for (i = 0; i < N_THREADS; ++i)
+            if (failures[i] != 0)
+                break;
+
+        if (i != N_THREADS)
+            break;
+
+        if (plugin->exit() != 0)
+            break;
+
+        /* Already unregistered. */
+        if (plugin->exit() == 0)
+            break;
+
+        pings = *plugin->pings;
+
+        index = parse(6, argv, &parser);
+        fprintf(stdout, "unregistered: index: %d, error: %d, error_index: %d\n", index, parser.error, parser.error_index);
+
+        if ((parser.error != CMDLINEFLAGS_ERROR_UNRECOGNIZED_OPTION) || (parser.error_index != 2) || (*plugin->pings != pings))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
@@ -0,0 +1,269 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_response_file_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_module_option(const struct cmdlineflags_option* option, const char* argument);
+static int write_file(const char* path, const char* content);
+static int run_tests(const char* directory);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, module, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_module_option, "selects module");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int v_option_actual_cnt = 0;
+/* Not copied, points into the response file for as long as it is kept. */
+static const char* module_option_argument = NULL;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+    char directory[] = "/tmp/cmdlineflags_response_file_tests.XXXXXX";
+
+    if (mkdtemp(directory) == NULL)
+        return retval;
+
+    retval = run_tests(directory);
+
+    /* Best effort clean up. */
+    {
+        static const char* const names[] = {"outer", "inner", "self", "bad"};
+        char path[256];
+        size_t i;
+
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+            snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+            unlink(path);
+        }
+
+        rmdir(directory);
+    }
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    v_option_actual_cnt++;
+    return 0;
+}
+
+static int handle_module_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    module_option_argument = argument;
+    return 0;
+}
+
+static int write_file(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "w");
+    int status;
+
+    if (file == NULL)
+        return -1;
+
+    status = fputs(content, file) < 0 ? -1 : 0;
+
+    if (fclose(file) != 0)
+        status = -1;
+
+    return status;
+}
+
+static int run_tests(const char* directory)
+{
+    int retval = -1;
+
+    do {
+        char outer[256];
+        char inner[256];
+        char self[256];
+        char bad[256];
+        char content[512];
+        struct cmdlineflags_parser parser;
+        struct cmdlineflags_cfg cfg;
+        char* const* expanded_argv;
+        int index;
+
+        snprintf(outer, sizeof(outer), "@%s/outer", directory);
+        snprintf(inner, sizeof(inner), "@%s/inner", directory);
+        snprintf(self, sizeof(self), "@%s/self", directory);
+        snprintf(bad, sizeof(bad), "@%s/bad", directory);
+
+        /* The inner file has no trailing new line, so its last token ends right at the end of the file. */
+        snprintf(content, sizeof(content), "-v --module 'net dev'\n%s\n", inner);
+        if ((write_file(outer + 1, content) != 0) || (write_file(inner + 1, "-v\t-v") != 0))
+            break;
+
+        snprintf(content, sizeof(content), "-v %s\n", self);
+        if ((write_file(self + 1, content) != 0) || (write_file(bad + 1, "-v 'unterminated\n") != 0))
+            break;
+
+        {
+            char* const argv[] = {"program", outer, "-v", "--", "remaining", NULL};
+
+            if (cmdlineflags_parser_init(&parser, NULL) != 0)
+                break;
+
+            parser.cfg.expand_response_files = 1;
+
+            index = cmdlineflags_parse_r(&parser, 5, argv);
+            fprintf(stdout, "nested: index: %d, argc: %d, v_option_actual_cnt: %d, module: %s\n",
+                index, parser.argc, v_option_actual_cnt, module_option_argument);
+
+            if ((index != 8) || (parser.argc != 9) || (parser.argv[9] != NULL) || strcmp(parser.argv[index], "remaining"))
+                break;
+
+            if ((parser.n_errors != 0) || (v_option_actual_cnt != 4) || strcmp(module_option_argument, "net dev"))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+
+            if ((parser.argv != NULL) || (parser.resources != NULL))
+                break;
+        }
+
+        {
+            char missing[300];
+            char* argv[] = {"program", "-v", "--", missing, NULL};
+
+            /* Files which cannot be read are ordinary arguments. */
+            snprintf(missing, sizeof(missing), "@%s/missing", directory);
+
+            index = cmdlineflags_parse_r(&parser, 4, argv);
+            fprintf(stdout, "missing: index: %d, error: %d\n", index, parser.error);
+
+            if ((index != 3) || (parser.n_errors != 0) || strcmp(parser.argv[index], missing))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+        }
+
+        {
+            char* argv[] = {"program", self, NULL};
+
+            parser.cfg.emit_debug_messages = 0;
+
+            index = cmdlineflags_parse_r(&parser, 2, argv);
+            fprintf(stdout, "self: index: %d, error: %d, error_index: %d\n", index, parser.error, parser.error_index);
+
+            if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_RESPONSE_FILE) || (parser.error_index != 1))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+        }
+
+        {
+            char* argv[] = {"program", bad, NULL};
+
+            index = cmdlineflags_parse_r(&parser, 2, argv);
+            fprintf(stdout, "bad: index: %d, error: %d\n", index, parser.error);
+
+            if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_RESPONSE_FILE))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+        }
+
+        {
+            char* argv[] = {"program", outer, NULL};
+
+            /* Along with the program, outer expands to 6 arguments. */
+            parser.cfg.max_expanded_args = 5;
+
+            index = cmdlineflags_parse_r(&parser, 2, argv);
+            fprintf(stdout, "bounded: index: %d, error: %d\n", index, parser.error);
+
+            if ((index >= 0) || (parser.error != CMDLINEFLAGS_ERROR_RESPONSE_FILE))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+
+            parser.cfg.max_expanded_args = 6;
+
+            index = cmdlineflags_parse_r(&parser, 2, argv);
+            if ((index != 6) || (parser.n_errors != 0))
+                break;
+
+            cmdlineflags_parser_release(&parser);
+        }
+
+        {
+            char* argv[] = {"program", inner, "--", "remaining", NULL};
+
+            if (cmdlineflags_get_cfg(&cfg) != 0)
+                break;
+
+            cfg.expand_response_files = 1;
+
+            if (cmdlineflags_set_cfg(&cfg) != 0)
+                break;
+
+            v_option_actual_cnt = 0;
+
+            index = cmdlineflags_parse(4, argv);
+            fprintf(stdout, "global: index: %d, argc: %d\n", index, cmdlineflags_get_args(NULL));
+
+            if ((index != 4) || (cmdlineflags_get_args(&expanded_argv) != 5) || strcmp(expanded_argv[index], "remaining"))
+                break;
+
+            if (v_option_actual_cnt != 2)
+                break;
+
+            cmdlineflags_release();
+
+            if (cmdlineflags_get_args(&expanded_argv) != 0)
+                break;
+        }
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
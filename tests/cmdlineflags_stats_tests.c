@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_stats_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define SLOW_HANDLER_NS 2000000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option);
+static int handle_slow_option(const struct cmdlineflags_option* option, const char* argument);
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count);
+static void spin(uint64_t ns);
+static int check_stats(const struct cmdlineflags* it, uint64_t hits, uint64_t min_handler_ns);
+
+CMDLINEFLAGS_DEFINE(CMDLINEFLAGS_GLOBAL_MODULE, v, verbose, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "increases verbosity level");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, slow, \
+   CMDLINEFLAGS_REQUIRED_ARGUMENT, handle_slow_option, "takes a while");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(CMDLINEFLAGS_GLOBAL_MODULE, include, \
+   CMDLINEFLAGS_BATCH_REQUIRED_ARGUMENT, handle_include_option, "adds include directories");
+
+CMDLINEFLAGS_DEFINE_LONG_OPTION(module_name, unused, \
+   CMDLINEFLAGS_NO_ARGUMENT, handle_v_option, "never given");
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static int verbosity = 0;
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        struct cmdlineflags_stats stats = {0};
+        char* const test_argv[] = {"program", "-v", "--verbose", "-v", "--slow", "x", "--include=a", "--include", "b", NULL};
+        unsigned n_options = 0;
+        int index;
+
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        /* Nothing is collected unless asked to. */
+        index = cmdlineflags_parse_r(&parser, 9, test_argv);
+        if ((index != 9) || (check_stats(cmdlineflags_shortoptions___v, 0, 0) != 0))
+            break;
+
+        parser.cfg.collect_stats = 1;
+
+        index = cmdlineflags_parse_r(&parser, 9, test_argv);
+        fprintf(stdout, "index: %d, n_errors: %u, verbosity: %d\n", index, parser.n_errors, verbosity);
+
+        if ((index != 9) || (parser.n_errors != 0) || (verbosity != 6))
+            break;
+
+        /* Short and long options are counted separately. */
+        if ((check_stats(cmdlineflags_shortoptions___v, 2, 0) != 0) ||
+            (check_stats(cmdlineflags_longoptions___verbose, 1, 0) != 0) ||
+            (check_stats(cmdlineflags_longoptions___slow, 1, SLOW_HANDLER_NS) != 0) ||
+            (check_stats(cmdlineflags_longoptions___include, 2, SLOW_HANDLER_NS) != 0) ||
+            (check_stats(cmdlineflags_longoptions_module_name_unused, 0, 0) != 0))
+            break;
+
+        while (cmdlineflags_next_stats(stats.cmdlineflags, &stats) == 0) {
+            fprintf(stdout, "%s %c%s: hits: %" PRIu64 ", handler_ns: %" PRIu64 "\n", stats.cmdlineflags->module,
+                stats.cmdlineflags->option.type == CMDLINEFLAGS_SHORTOPTION ? stats.cmdlineflags->option.u.shortoption : '-',
+                stats.cmdlineflags->option.type == CMDLINEFLAGS_SHORTOPTION ? "" : stats.cmdlineflags->option.u.longoption,
+                stats.hits, stats.handler_ns);
+            n_options++;
+        }
+
+        if (n_options != 5)
+            break;
+
+        if ((cmdlineflags_get_stats(NULL, &stats) == 0) || (cmdlineflags_get_stats((const struct cmdlineflags*)&stats, &stats) == 0))
+            break;
+
+        cmdlineflags_reset_stats();
+
+        if ((check_stats(cmdlineflags_shortoptions___v, 0, 0) != 0) || (check_stats(cmdlineflags_longoptions___slow, 0, 0) != 0))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int handle_v_option(const struct cmdlineflags_option* option)
+{
+    verbosity++;
+    return 0;
+}
+
+static void spin(uint64_t ns)
+{
+    struct timespec start;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((uint64_t)(now.tv_sec - start.tv_sec) * 1000000000 + now.tv_nsec - start.tv_nsec < ns);
+}
+
+static int handle_slow_option(const struct cmdlineflags_option* option, const char* argument)
+{
+    spin(SLOW_HANDLER_NS);
+    return 0;
+}
+
+static int handle_include_option(const struct cmdlineflags_option* option, const char* const* arguments, unsigned count)
+{
+    spin(SLOW_HANDLER_NS);
+    return count == 2 ? 0 : -1;
+}
+
+static int check_stats(const struct cmdlineflags* it, uint64_t hits, uint64_t min_handler_ns)
+{
+    struct cmdlineflags_stats stats;
+
+    if (cmdlineflags_get_stats(it, &stats) != 0)
+        return -1;
+
+    if ((stats.cmdlineflags != it) || (stats.hits != hits) || (stats.handler_ns < min_handler_ns))
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cmdlineflags_typed_tests.c
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include <cmdlineflags/cmdlineflags.h>
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+struct typed_test {
+    const char* option;
+    const char* argument;
+    /* Expected value (as printed with %d, %" PRIu64 ", %.17g or %s) or NULL if the argument is invalid. */
+    const char* value;
+};
+
+/*===========================================================================*\
+ * global (external linkage) object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local (internal linkage) function declarations
+\*===========================================================================*/
+static int run_typed_test(const struct typed_test* test);
+
+/*===========================================================================*\
+ * local (internal linkage) object definitions
+\*===========================================================================*/
+static bool dry_run = false;
+static int jobs = 0;
+static uint64_t size = 0;
+static double ratio = 0.0;
+static const char* name = NULL;
+static uint64_t timeout = 0;
+
+CMDLINEFLAGS_DEFINE_BOOL(CMDLINEFLAGS_GLOBAL_MODULE, n, dry_run, dry_run, "does not apply any changes");
+CMDLINEFLAGS_DEFINE_INT(CMDLINEFLAGS_GLOBAL_MODULE, j, jobs, jobs, "sets number of jobs");
+CMDLINEFLAGS_DEFINE_UINT64(CMDLINEFLAGS_GLOBAL_MODULE, s, size, size, "sets size");
+CMDLINEFLAGS_DEFINE_DOUBLE(CMDLINEFLAGS_GLOBAL_MODULE, r, ratio, ratio, "sets ratio");
+CMDLINEFLAGS_DEFINE_STRING(CMDLINEFLAGS_GLOBAL_MODULE, N, name, name, "sets name");
+CMDLINEFLAGS_DEFINE_DURATION(CMDLINEFLAGS_GLOBAL_MODULE, t, timeout, timeout, "sets timeout");
+
+static const struct typed_test typed_tests[] = {
+    {"--jobs", "42", "42"},
+    {"--jobs", "-2147483648", "-2147483648"},
+    {"--jobs", "+2147483647", "2147483647"},
+    {"--jobs", "0x10", "16"},
+    {"--jobs", "2147483648", NULL},
+    {"--jobs", "-2147483649", NULL},
+    {"--jobs", "", NULL},
+    {"--jobs", "12abc", NULL},
+    {"--jobs", " 1", NULL},
+    {"--size", "18446744073709551615", "18446744073709551615"},
+    {"--size", "0xFFFFFFFFFFFFFFFF", "18446744073709551615"},
+    {"--size", "18446744073709551616", NULL},
+    {"--size", "-1", NULL},
+    {"--size", "0x", NULL},
+    {"--ratio", "0.1", "0.10000000000000001"},
+    {"--ratio", "-1.5e3", "-1500"},
+    {"--ratio", "2.5E-3", "0.0025000000000000001"},
+    {"--ratio", "12345678901234567890123", "1.2345678901234568e+22"},
+    {"--ratio", "1e-300", "1e-300"},
+    {"--ratio", ".5", "0.5"},
+    {"--ratio", "1e400", NULL},
+    {"--ratio", "1,5", NULL},
+    {"--ratio", "1e", NULL},
+    {"--ratio", "", NULL},
+    {"--ratio", " 1", NULL},
+    {"--name", "net dev", "net dev"},
+    {"--timeout", "250ms", "250000000"},
+    {"--timeout", "1h30m", "5400000000000"},
+    {"--timeout", "1.5s", "1500000000"},
+    {"--timeout", "2", "2000000000"},
+    {"--timeout", "10us5ns", "10005"},
+    {"--timeout", "1d", "86400000000000"},
+    {"--timeout", "1x", NULL},
+    {"--timeout", "1h30", NULL},
+    {"--timeout", "s", NULL},
+    {"--timeout", "300000d", NULL},
+};
+
+/*===========================================================================*\
+ * static inline (internal linkage) function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global (external linkage) function definitions
+\*===========================================================================*/
+int main(int argc, char* argv[])
+{
+    int retval = -1;
+
+    do {
+        struct cmdlineflags_parser parser;
+        char* const test_argv[] = {"program", "-n", "-j8", "--timeout=5m", "-N", "name", "--", "remaining", NULL};
+        size_t i;
+        int index;
+
+        for (i = 0; i < ARRAY_SIZE(typed_tests); ++i)
+            if (run_typed_test(&typed_tests[i]) != 0)
+                break;
+
+        if (i != ARRAY_SIZE(typed_tests))
+            break;
+
+        if (cmdlineflags_parser_init(&parser, NULL) != 0)
+            break;
+
+        index = cmdlineflags_parse_r(&parser, 8, test_argv);
+        fprintf(stdout, "index: %d, n_errors: %u, dry_run: %d, jobs: %d, timeout: %" PRIu64 ", name: %s\n",
+            index, parser.n_errors, dry_run, jobs, timeout, name);
+
+        if ((index != 7) || (parser.n_errors != 0) || !dry_run || (jobs != 8) || (timeout != UINT64_C(300000000000)) ||
+            (name != test_argv[5]))
+            break;
+
+        retval = 0;
+    } while (0);
+
+    return retval;
+}
+
+/*===========================================================================*\
+ * local (internal linkage) function definitions
+\*===========================================================================*/
+static int run_typed_test(const struct typed_test* test)
+{
+    struct cmdlineflags_parser parser;
+    char* const argv[] = {"program", (char*)test->option, (char*)test->argument, NULL};
+    char value[64];
+    int index;
+
+    if (cmdlineflags_parser_init(&parser, NULL) != 0)
+        return -1;
+
+    parser.cfg.emit_debug_messages = 0;
+
+    index = cmdlineflags_parse_r(&parser, 3, argv);
+
+    if (!strcmp(test->option, "--jobs"))
+        snprintf(value, sizeof(value), "%d", jobs);
+    else if (!strcmp(test->option, "--size"))
+        snprintf(value, sizeof(value), "%" PRIu64, size);
+    else if (!strcmp(test->option, "--ratio"))
+        snprintf(value, sizeof(value), "%.17g", ratio);
+    else if (!strcmp(test->option, "--name"))
+        snprintf(value, sizeof(value), "%s", name);
+    else
+        snprintf(value, sizeof(value), "%" PRIu64, timeout);
+
+    fprintf(stdout, "%s '%s': index: %d, error: %d, value: %s\n", test->option, test->argument, index, parser.error, value);
+
+    if (index != 3)
+        return -1;
+
+    if (test->value == NULL)
+        return ((parser.error == CMDLINEFLAGS_ERROR_INVALID_ARGUMENT) && (parser.error_index == 2)) ? 0 : -1;
+
+    return ((parser.n_errors == 0) && !strcmp(value, test->value)) ? 0 : -1;
+}